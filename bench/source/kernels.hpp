@@ -0,0 +1,186 @@
+#pragma once
+
+#include <projgeom/pg_canonical.hpp>       // for canonical_coord
+#include <projgeom/pg_compress.hpp>        // for CompressedCoords
+#include <projgeom/pg_concurrent_set.hpp>  // for ConcurrentCoordSet
+#include <projgeom/pg_incidence_join.hpp>  // for incidence_join
+#include <projgeom/pg_object.hpp>          // for PgPoint, PgLine
+#include <projgeom/pg_perspective.hpp>     // for perspective_pairs
+#include <projgeom/pg_polygon.hpp>         // for PolygonIndex, within_polygon_range
+#include <projgeom/pg_validate.hpp>        // for IncidenceClaims, validate_incidences
+#include <projgeom/pg_wide.hpp>            // for cross_wide, narrow_reduced, dot_wide
+#include <projgeom/pg_workload.hpp>        // for Workload, WorkloadSpec, generate_coords
+
+#include <array>       // for array
+#include <cmath>       // for cos, sin
+#include <cstddef>     // for size_t
+#include <cstdint>     // for int64_t, uint64_t
+#include <functional>  // for function
+#include <stdexcept>   // for overflow_error
+#include <string>      // for string
+#include <utility>     // for pair
+#include <vector>      // for vector
+
+/**
+ * @brief A benchmark kernel: `run` does `elements` units of work
+ *
+ * Inputs are built when the kernel is made, outside the measurement; `run`
+ * folds its result into `sink` so the work cannot be optimized away.
+ */
+struct Kernel {
+    std::string name;
+    std::size_t elements;
+    std::function<void(uint64_t &sink)> run;
+};
+
+namespace bench_detail {
+    using Coord = std::array<int64_t, 3>;
+
+    inline auto random_coords(fun::Workload kind, std::size_t n, int64_t range, uint64_t seed)
+        -> std::vector<Coord> {
+        auto spec = fun::WorkloadSpec{};
+        spec.kind = kind;
+        spec.count = n;
+        spec.seed = seed;
+        spec.range = range;
+        return fun::generate_coords(spec);
+    }
+
+    /// exact collinearity test, false if the join does not fit int64
+    inline auto collinear(const Coord &a, const Coord &b, const Coord &c) -> bool {
+        try {
+            return fun::sign_of(fun::dot_wide(fun::narrow_reduced<3>(fun::cross_wide(a, b)), c))
+                   == 0;
+        } catch (const std::overflow_error &) {
+            return true;
+        }
+    }
+
+    template <class Object> auto to_objects(const std::vector<Coord> &coords)
+        -> std::vector<Object> {
+        auto result = std::vector<Object>{};
+        result.reserve(coords.size());
+        for (const auto &c : coords) result.emplace_back(Object(c));
+        return result;
+    }
+}  // namespace bench_detail
+
+/**
+ * @brief The library kernels at a given scale
+ *
+ * The query lines of the incidence join and the polygon are fixed; every
+ * other input is drawn from `kind`. The polygon kernel skips points at
+ * infinity and points whose reduced coordinates reach 2^20, where its int64
+ * arithmetic stops being exact; the perspective setup tests collinearity in
+ * 128 bits, so huge coordinates are safe there too.
+ *
+ * @param[in] n elements per kernel (the perspective kernel uses about
+ *            sqrt(2n) triangles, so that it tests about n pairs)
+ * @param[in] kind input distribution
+ * @param[in] seed
+ * @return std::vector<Kernel>
+ */
+inline auto make_kernels(std::size_t n, fun::Workload kind = fun::Workload::Uniform,
+                         uint64_t seed = 1) -> std::vector<Kernel> {
+    auto coords_of = [kind, seed](std::size_t count, int64_t range, uint64_t stream) {
+        return bench_detail::random_coords(kind, count, range, seed * 16 + stream);
+    };
+    auto kernels = std::vector<Kernel>{};
+
+    {
+        auto coords = coords_of(n, 1 << 20, 1);
+        kernels.push_back({"canonical", n, [coords](uint64_t &sink) {
+                               for (const auto &c : coords) {
+                                   sink += static_cast<uint64_t>(fun::canonical_coord(c)[0]);
+                               }
+                           }});
+    }
+    {
+        auto a = coords_of(n, 1 << 20, 2);
+        auto b = coords_of(n, 1 << 20, 3);
+        kernels.push_back({"meet", n, [a, b](uint64_t &sink) {
+                               for (std::size_t i = 0; i != a.size(); ++i) {
+                                   const auto m
+                                       = fun::narrow_reduced<3>(fun::cross_wide(a[i], b[i]));
+                                   sink += static_cast<uint64_t>(m[2]);
+                               }
+                           }});
+    }
+    {
+        // small coordinates, so that many points lie on the lines
+        auto points = bench_detail::to_objects<PgPoint>(coords_of(n, 64, 4));
+        auto lines = bench_detail::to_objects<PgLine>(
+            bench_detail::random_coords(fun::Workload::Uniform, 256, 4, 5));
+        kernels.push_back({"incidence_join", n, [points, lines](uint64_t &sink) {
+                               sink += fun::incidence_join(points, lines).size();
+                           }});
+
+        auto claims = std::vector<std::pair<uint32_t, uint32_t>>{};
+        for (const auto &pair : fun::incidence_join(points, lines)) {
+            claims.emplace_back(static_cast<uint32_t>(pair.point),
+                                static_cast<uint32_t>(pair.line));
+        }
+        const auto grouped = fun::IncidenceClaims::group_by_line(claims, lines.size());
+        kernels.push_back({"validate", grouped.size(), [points, lines, grouped](uint64_t &sink) {
+                               sink += fun::validate_incidences(points, lines, grouped).failures();
+                           }});
+    }
+    {
+        auto ring = std::vector<PgPoint>{};
+        for (int k = 0; k != 64; ++k) {  // a star, so that slabs hold several edges
+            const auto r = k % 2 == 0 ? 1000000.0 : 400000.0;
+            const auto t = 6.283185307179586 * k / 64;
+            ring.emplace_back(PgPoint({static_cast<int64_t>(r * std::cos(t)),
+                                       static_cast<int64_t>(r * std::sin(t)), 1}));
+        }
+        auto index = fun::PolygonIndex<PgPoint>(ring);
+        // the winding kernel is exact below 2^20: skip points outside that range
+        auto points = std::vector<PgPoint>{};
+        for (const auto &c : coords_of(n, (1 << 20) - 1, 6)) {
+            const auto reduced = fun::canonical_coord(c);
+            if (reduced[2] != 0 && fun::within_polygon_range(reduced)) {
+                points.emplace_back(PgPoint(reduced));
+            }
+        }
+        kernels.push_back({"locate", points.size(), [index, points](uint64_t &sink) {
+                               for (const auto where : fun::locate_points(index, points)) {
+                                   sink += static_cast<uint64_t>(where);
+                               }
+                           }});
+    }
+    {
+        auto coords = coords_of(n, 1 << 20, 7);
+        kernels.push_back({"compress_encode", n, [coords](uint64_t &sink) {
+                               sink += fun::CompressedCoords::encode(coords).bytes();
+                           }});
+        auto packed = fun::CompressedCoords::encode(coords);
+        kernels.push_back({"compress_decode", n, [packed](uint64_t &sink) {
+                               const auto coords = packed.to_vector();
+                               if (!coords.empty()) sink += static_cast<uint64_t>(coords[0][0]);
+                           }});
+    }
+    {
+        auto coords = coords_of(n, 1 << 10, 8);  // many repeats
+        kernels.push_back({"coord_set", n, [coords](uint64_t &sink) {
+                               auto set = fun::ConcurrentCoordSet{};
+                               for (const auto &c : coords) set.insert(fun::canonical_coord(c));
+                               sink += set.size();
+                           }});
+    }
+    {
+        auto triangles = std::vector<std::array<PgPoint, 3>>{};
+        auto coords = coords_of(3 * 4096, 1 << 10, 9);
+        auto pairs = std::size_t{0};
+        for (std::size_t i = 0; i + 2 < coords.size() && pairs < n; i += 3) {
+            if (bench_detail::collinear(coords[i], coords[i + 1], coords[i + 2])) continue;
+            const auto tri = std::array<PgPoint, 3>{PgPoint(coords[i]), PgPoint(coords[i + 1]),
+                                                    PgPoint(coords[i + 2])};
+            pairs += triangles.size();
+            triangles.push_back(tri);
+        }
+        kernels.push_back({"perspective", pairs, [triangles](uint64_t &sink) {
+                               sink += fun::perspective_pairs(triangles).size();
+                           }});
+    }
+    return kernels;
+}
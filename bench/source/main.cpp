@@ -0,0 +1,181 @@
+#include <projgeom/pg_workload.hpp>  // for parse_workload, workload_name
+#include <projgeom/version.h>        // for PROJGEOM_VERSION
+
+#include <algorithm>    // for max
+#include <chrono>       // for steady_clock, duration
+#include <cstddef>      // for size_t
+#include <cstdint>      // for uint64_t
+#include <cstdio>       // for FILE, fopen, fprintf, fclose
+#include <cxxopts.hpp>  // for value, OptionAdder, Options, OptionValue
+#include <exception>    // for exception
+#include <iostream>     // for cout, cerr, endl
+#include <stdexcept>    // for runtime_error
+#include <string>       // for string
+#include <vector>       // for vector
+
+#include "kernels.hpp"        // for Kernel, make_kernels
+#include "perf_counters.hpp"  // for PerfCounters
+
+namespace {
+    volatile uint64_t kernel_sink = 0;  // keeps the kernel results alive
+
+    struct Result {
+        std::string name;
+        std::size_t elements;
+        std::size_t repeats;
+        double ns;                      // per element, fastest repeat
+        PerfCounters::Values counters;  // per element, same repeat; negative if unavailable
+    };
+
+    /**
+     * @brief Run a kernel once to warm up, then `repeats` times under the counters
+     *
+     */
+    auto measure(const Kernel &kernel, std::size_t repeats, PerfCounters &counters,
+                 uint64_t &sink) -> Result {
+        auto result = Result{kernel.name, kernel.elements, repeats, 0.0, {}};
+        const auto per = kernel.elements == 0 ? 1.0 : static_cast<double>(kernel.elements);
+        kernel.run(sink);
+        auto best = -1.0;
+        for (std::size_t r = 0; r != repeats; ++r) {
+            counters.start();
+            const auto begin = std::chrono::steady_clock::now();
+            kernel.run(sink);
+            const auto end = std::chrono::steady_clock::now();
+            auto values = counters.stop();
+            const auto ns = std::chrono::duration<double, std::nano>(end - begin).count();
+            if (best >= 0.0 && ns >= best) continue;
+            best = ns;
+            for (auto &v : values) v = v < 0.0 ? v : v / per;
+            result.counters = values;
+        }
+        result.ns = best / per;
+        return result;
+    }
+
+    void print(const Result &result) {
+        std::printf("%-16s %10zu %10.2f", result.name.c_str(), result.elements, result.ns);
+        for (const auto v : result.counters) {
+            if (v < 0.0) {
+                std::printf(" %12s", "-");
+            } else {
+                std::printf(" %12.3f", v);
+            }
+        }
+        const auto cycles = result.counters[PerfCounters::Cycles];
+        const auto instructions = result.counters[PerfCounters::Instructions];
+        if (cycles > 0.0 && instructions >= 0.0) {
+            std::printf(" %6.2f\n", instructions / cycles);
+        } else {
+            std::printf(" %6s\n", "-");
+        }
+    }
+
+    void write_escaped(std::FILE *file, const std::string &text) {
+        for (const auto ch : text) {
+            if (ch == '"' || ch == '\\') std::fputc('\\', file);
+            std::fputc(ch, file);
+        }
+    }
+
+    struct RunInfo {
+        std::string label;
+        std::size_t size;
+        std::string workload;
+        uint64_t seed;
+    };
+
+    void write_json(const std::string &path, const RunInfo &run, const PerfCounters &counters,
+                    const std::vector<Result> &results) {
+        auto *file = std::fopen(path.c_str(), "w");
+        if (file == nullptr) throw std::runtime_error("cannot open " + path);
+        std::fprintf(file, "{\n  \"version\": \"%s\",\n  \"label\": \"", PROJGEOM_VERSION);
+        write_escaped(file, run.label);
+        std::fprintf(file, "\",\n  \"size\": %zu,\n  \"workload\": \"%s\",\n", run.size,
+                     run.workload.c_str());
+        std::fprintf(file, "  \"seed\": %llu,\n  \"counters\": %s,\n",
+                     static_cast<unsigned long long>(run.seed), counters.any() ? "true" : "false");
+        std::fprintf(file, "  \"kernels\": [");
+        for (std::size_t i = 0; i != results.size(); ++i) {
+            const auto &result = results[i];
+            std::fprintf(file,
+                         "%s\n    {\"name\": \"%s\", \"elements\": %zu, \"repeats\": %zu, "
+                         "\"per_element\": {\"ns\": %.4f",
+                         i == 0 ? "" : ",", result.name.c_str(), result.elements,
+                         result.repeats, result.ns);
+            for (std::size_t c = 0; c != PerfCounters::NUM_COUNTERS; ++c) {
+                if (result.counters[c] < 0.0) {
+                    std::fprintf(file, ", \"%s\": null", PerfCounters::NAMES[c]);
+                } else {
+                    std::fprintf(file, ", \"%s\": %.4f", PerfCounters::NAMES[c],
+                                 result.counters[c]);
+                }
+            }
+            std::fprintf(file, "}}");
+        }
+        std::fprintf(file, "\n  ]\n}\n");
+        if (std::fclose(file) != 0) throw std::runtime_error("cannot write " + path);
+    }
+}  // namespace
+
+auto main(int argc, char **argv) -> int {
+    cxxopts::Options options(*argv, "Library kernels under hardware performance counters");
+
+    auto run = RunInfo{};
+    std::size_t repeats = 0;
+    std::string filter;
+    std::string json_path;
+
+    // clang-format off
+  options.add_options()
+    ("h,help", "Show help")
+    ("n,size", "Elements per kernel", cxxopts::value(run.size)->default_value("1000000"))
+    ("w,workload", "Input distribution: uniform, near-collinear, infinity, mixed-magnitude "
+     "or concyclic", cxxopts::value(run.workload)->default_value("uniform"))
+    ("seed", "Seed of the input generator", cxxopts::value(run.seed)->default_value("1"))
+    ("r,repeat", "Measured runs per kernel (the fastest is reported)",
+     cxxopts::value(repeats)->default_value("5"))
+    ("f,filter", "Only kernels whose name contains this", cxxopts::value(filter))
+    ("json", "Write the results as JSON to this file", cxxopts::value(json_path))
+    ("label", "Label stored in the JSON, e.g. a commit hash", cxxopts::value(run.label))
+  ;
+    // clang-format on
+
+    auto result = options.parse(argc, argv);
+
+    if (result["help"].as<bool>()) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    try {
+        auto counters = PerfCounters{};
+        if (!counters.reason().empty()) {
+            std::cerr << "hardware counters unavailable: " << counters.reason() << std::endl;
+        }
+        std::printf("%-16s %10s %10s", "kernel", "elements", "ns/elem");
+        for (const auto *name : PerfCounters::NAMES) std::printf(" %12s", name);
+        std::printf(" %6s\n", "ipc");
+
+        auto sink = uint64_t{0};
+        auto results = std::vector<Result>{};
+        const auto kind = fun::parse_workload(run.workload);
+        for (const auto &kernel : make_kernels(run.size, kind, run.seed)) {
+            if (!filter.empty() && kernel.name.find(filter) == std::string::npos) continue;
+            try {
+                results.push_back(
+                    measure(kernel, std::max<std::size_t>(repeats, 1), counters, sink));
+            } catch (const std::overflow_error &err) {  // e.g. huge coordinates
+                std::printf("%-16s skipped: %s\n", kernel.name.c_str(), err.what());
+                continue;
+            }
+            print(results.back());
+        }
+        if (!json_path.empty()) write_json(json_path, run, counters, results);
+        kernel_sink = sink;
+        return 0;
+    } catch (const std::exception &err) {
+        std::cerr << err.what() << std::endl;
+        return 1;
+    }
+}
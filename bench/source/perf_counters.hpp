@@ -0,0 +1,142 @@
+#pragma once
+
+#include <array>    // for array
+#include <cerrno>   // for errno
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint64_t
+#include <cstring>  // for strerror
+#include <string>   // for string
+#include <utility>  // for pair
+
+#if defined(__linux__) && __has_include(<linux/perf_event.h>)
+#    include <linux/perf_event.h>  // for perf_event_attr, PERF_*
+#    include <sys/ioctl.h>         // for ioctl
+#    include <sys/syscall.h>       // for SYS_perf_event_open
+#    include <unistd.h>            // for syscall, read, close
+#    define PROJGEOM_HAS_PERF_EVENTS 1
+#endif
+
+/**
+ * @brief Hardware counters of the calling process, through perf_event_open
+ *
+ * Each counter is opened on its own (user space only, inherited by threads
+ * spawned afterwards), so a counter the machine lacks does not take the
+ * others down. When the kernel refuses access (perf_event_paranoid, a
+ * container without the syscall, a non-Linux system) every counter reads as
+ * unavailable and `reason()` says why; wall-clock timing still works.
+ * Counts are scaled by enabled / running time when the PMU multiplexes.
+ */
+class PerfCounters {
+  public:
+    enum Counter { Cycles, Instructions, L1dMisses, LlcMisses, BranchMisses, NUM_COUNTERS };
+
+    static constexpr std::array<const char *, NUM_COUNTERS> NAMES{
+        "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"};
+
+    /// Counts of one measurement; negative means unavailable
+    using Values = std::array<double, NUM_COUNTERS>;
+
+  private:
+    std::array<int, NUM_COUNTERS> _fds{-1, -1, -1, -1, -1};
+    std::string _reason;
+
+#ifdef PROJGEOM_HAS_PERF_EVENTS
+    static auto open_counter(uint32_t type, uint64_t config) -> int {
+        auto attr = perf_event_attr{};
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    static constexpr auto cache_miss(uint64_t cache) -> uint64_t {
+        return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+               | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+#endif
+
+  public:
+    PerfCounters() {
+#ifdef PROJGEOM_HAS_PERF_EVENTS
+        const std::array<std::pair<uint32_t, uint64_t>, NUM_COUNTERS> events{{
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_L1D)},
+            {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_LL)},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        }};
+        for (std::size_t i = 0; i != NUM_COUNTERS; ++i) {
+            this->_fds[i] = open_counter(events[i].first, events[i].second);
+            if (this->_fds[i] < 0 && this->_reason.empty()) {
+                this->_reason = std::string(NAMES[i]) + ": " + std::strerror(errno);
+                if (errno == EACCES || errno == EPERM) {
+                    this->_reason += " (see /proc/sys/kernel/perf_event_paranoid)";
+                }
+            }
+        }
+#else
+        this->_reason = "perf_event_open is not available on this system";
+#endif
+    }
+
+    PerfCounters(const PerfCounters &) = delete;
+    auto operator=(const PerfCounters &) -> PerfCounters & = delete;
+
+    ~PerfCounters() {
+#ifdef PROJGEOM_HAS_PERF_EVENTS
+        for (const auto fd : this->_fds) {
+            if (fd >= 0) ::close(fd);
+        }
+#endif
+    }
+
+    /// true if at least one counter could be opened
+    auto any() const -> bool {
+        for (const auto fd : this->_fds) {
+            if (fd >= 0) return true;
+        }
+        return false;
+    }
+
+    /// why some counter is missing; empty if all are available
+    auto reason() const -> const std::string & { return this->_reason; }
+
+    /// reset and start all counters
+    void start() {
+#ifdef PROJGEOM_HAS_PERF_EVENTS
+        for (const auto fd : this->_fds) {
+            if (fd < 0) continue;
+            ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    /**
+     * @brief Stop all counters and read them
+     *
+     * @return Values
+     */
+    auto stop() -> Values {
+        auto values = Values{};
+        values.fill(-1.0);
+#ifdef PROJGEOM_HAS_PERF_EVENTS
+        for (std::size_t i = 0; i != NUM_COUNTERS; ++i) {
+            const auto fd = this->_fds[i];
+            if (fd < 0) continue;
+            ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t data[3] = {0, 0, 0};  // value, time enabled, time running
+            if (::read(fd, data, sizeof(data)) != static_cast<ssize_t>(sizeof(data))) continue;
+            if (data[2] == 0) continue;  // never scheduled on the PMU
+            values[i] = static_cast<double>(data[0]) * static_cast<double>(data[1])
+                        / static_cast<double>(data[2]);
+        }
+#endif
+        return values;
+    }
+};
@@ -92,9 +92,9 @@ namespace fun {
          * @return Point
          */
         [[nodiscard]] constexpr auto midpoint(const Point &pt_a, const Point &pt_b) const -> Point {
-            const auto alpha = a.dot(this->_l_inf);
+            const auto alpha = pt_a.dot(this->_l_inf);
             const auto beta = pt_b.dot(this->_l_inf);
-            return parametrize(alpha, pt_a, beta, pt_b);
+            return parametrize(beta, pt_a, alpha, pt_b);
         }
 
         /**
@@ -0,0 +1,420 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "pg_parallel.hpp"
+
+/** @file include/pg3_object.hpp
+ *  This is a C++ Library header.
+ *
+ *  Projective 3-space. Points and planes have 4 homogeneous coordinates;
+ *  lines have 6 Pluecker coordinates (L01, L02, L03, L23, L31, L12), with
+ *  L_ij = p_i q_j - p_j q_i for the join of points p and q. The dual
+ *  coordinates of a line (the same construction applied to two planes
+ *  through it) are the two halves swapped.
+ *
+ *  The value type T is a template parameter: int64_t keeps one join or meet
+ *  chain of depth two (a plane through three points, say) exact for
+ *  coordinates below 2^19; fun::int128_t or a multiprecision integer go
+ *  further.
+ */
+
+template <typename T> class Pg3Point;
+template <typename T> class Pg3Plane;
+template <typename T> class Pg3Line;
+
+/**
+ * @brief Projective object of PG(3) with N homogeneous coordinates
+ *
+ * @tparam Derived
+ * @tparam DualType
+ * @tparam T value type
+ * @tparam N 4 for points and planes, 6 for lines
+ */
+template <typename Derived, typename DualType, typename T, std::size_t N> struct Pg3Object {
+    using Dual = DualType;
+    using value_type = T;
+
+    std::array<T, N> coord;
+
+    /**
+     * @brief Construct a new Pg3 Object object
+     *
+     * @param[in] coord Homogeneous coordinate
+     */
+    constexpr explicit Pg3Object(std::array<T, N> coord) : coord{std::move(coord)} {}
+
+    /**
+     * @brief Equal up to a non-zero scalar (all 2x2 minors vanish)
+     *
+     */
+    friend constexpr auto operator==(const Derived &lhs, const Derived &rhs) -> bool {
+        for (std::size_t i = 0; i != N; ++i) {
+            for (auto j = i + 1; j != N; ++j) {
+                if (!(lhs.coord[i] * rhs.coord[j] == lhs.coord[j] * rhs.coord[i])) return false;
+            }
+        }
+        return true;
+    }
+
+    friend constexpr auto operator!=(const Derived &lhs, const Derived &rhs) -> bool {
+        return !(lhs == rhs);
+    }
+
+    /**
+     * @brief Whether every coordinate is zero (the result of a degenerate join/meet)
+     *
+     */
+    constexpr auto is_zero() const -> bool {
+        for (const auto &c : this->coord) {
+            if (!(c == T(0))) return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Homogeneous parametrization lambda p + mu q
+     *
+     */
+    static constexpr auto parametrize(const T &lambda, const Derived &pt_p, const T &mu,
+                                      const Derived &pt_q) -> Derived {
+        auto result = std::array<T, N>{};
+        for (std::size_t i = 0; i != N; ++i) {
+            result[i] = lambda * pt_p.coord[i] + mu * pt_q.coord[i];
+        }
+        return Derived{result};
+    }
+};
+
+namespace fun {
+    namespace pg3 {
+        /**
+         * @brief Bivector a ^ b of two 4-vectors, in Pluecker order
+         *
+         */
+        template <typename T>
+        constexpr auto wedge(const std::array<T, 4> &a, const std::array<T, 4> &b)
+            -> std::array<T, 6> {
+            return {a[0] * b[1] - a[1] * b[0], a[0] * b[2] - a[2] * b[0],
+                    a[0] * b[3] - a[3] * b[0], a[2] * b[3] - a[3] * b[2],
+                    a[3] * b[1] - a[1] * b[3], a[1] * b[2] - a[2] * b[1]};
+        }
+
+        /**
+         * @brief Contraction of a bivector with a 4-vector
+         *
+         * For a line L = p ^ q this gives the plane through p, q and r; on
+         * the dual coordinates of L and a plane it gives their meet.
+         */
+        template <typename T>
+        constexpr auto contract(const std::array<T, 6> &l, const std::array<T, 4> &r)
+            -> std::array<T, 4> {
+            const auto &[l01, l02, l03, l23, l31, l12] = l;
+            return {l23 * r[1] + l31 * r[2] + l12 * r[3], l03 * r[2] - l23 * r[0] - l02 * r[3],
+                    l01 * r[3] - l31 * r[0] - l03 * r[1], l02 * r[1] - l12 * r[0] - l01 * r[2]};
+        }
+
+        template <typename T> constexpr auto dual(const std::array<T, 6> &l) -> std::array<T, 6> {
+            return {l[3], l[4], l[5], l[0], l[1], l[2]};
+        }
+
+        template <typename T>
+        constexpr auto dot4(const std::array<T, 4> &a, const std::array<T, 4> &b) -> T {
+            return a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+        }
+    }  // namespace pg3
+}  // namespace fun
+
+/**
+ * @brief Point of PG(3)
+ *
+ * @tparam T
+ */
+template <typename T> class Pg3Point : public Pg3Object<Pg3Point<T>, Pg3Plane<T>, T, 4> {
+  public:
+    /**
+     * @brief Construct a new Pg3 Point object
+     *
+     * @param[in] coord Homogeneous coordinate
+     */
+    constexpr explicit Pg3Point(std::array<T, 4> coord)
+        : Pg3Object<Pg3Point<T>, Pg3Plane<T>, T, 4>{std::move(coord)} {}
+
+    constexpr auto dot(const Pg3Plane<T> &plane) const -> T {
+        return fun::pg3::dot4(this->coord, plane.coord);
+    }
+
+    constexpr auto incident(const Pg3Plane<T> &plane) const -> bool {
+        return this->dot(plane) == T(0);
+    }
+
+    constexpr auto incident(const Pg3Line<T> &line) const -> bool {
+        return line.join(*this).is_zero();
+    }
+
+    /**
+     * @brief Line through two points
+     *
+     */
+    constexpr auto join(const Pg3Point &other) const -> Pg3Line<T> {
+        return Pg3Line<T>{fun::pg3::wedge(this->coord, other.coord)};
+    }
+
+    /**
+     * @brief Plane through this point and a line
+     *
+     */
+    constexpr auto join(const Pg3Line<T> &line) const -> Pg3Plane<T> { return line.join(*this); }
+};
+
+/**
+ * @brief Plane of PG(3)
+ *
+ * @tparam T
+ */
+template <typename T> class Pg3Plane : public Pg3Object<Pg3Plane<T>, Pg3Point<T>, T, 4> {
+  public:
+    /**
+     * @brief Construct a new Pg3 Plane object
+     *
+     * @param[in] coord Homogeneous coordinate
+     */
+    constexpr explicit Pg3Plane(std::array<T, 4> coord)
+        : Pg3Object<Pg3Plane<T>, Pg3Point<T>, T, 4>{std::move(coord)} {}
+
+    constexpr auto dot(const Pg3Point<T> &pt) const -> T {
+        return fun::pg3::dot4(this->coord, pt.coord);
+    }
+
+    constexpr auto incident(const Pg3Point<T> &pt) const -> bool { return this->dot(pt) == T(0); }
+
+    constexpr auto incident(const Pg3Line<T> &line) const -> bool {
+        return line.meet(*this).is_zero();
+    }
+
+    /**
+     * @brief Line where two planes meet
+     *
+     */
+    constexpr auto meet(const Pg3Plane &other) const -> Pg3Line<T> {
+        return Pg3Line<T>{fun::pg3::dual(fun::pg3::wedge(this->coord, other.coord))};
+    }
+
+    /**
+     * @brief Point where this plane meets a line
+     *
+     */
+    constexpr auto meet(const Pg3Line<T> &line) const -> Pg3Point<T> { return line.meet(*this); }
+};
+
+/**
+ * @brief Line of PG(3) in Pluecker coordinates (L01, L02, L03, L23, L31, L12)
+ *
+ * @tparam T
+ */
+template <typename T> class Pg3Line : public Pg3Object<Pg3Line<T>, Pg3Line<T>, T, 6> {
+  public:
+    /**
+     * @brief Construct a new Pg3 Line object
+     *
+     * @param[in] coord Pluecker coordinate
+     */
+    constexpr explicit Pg3Line(std::array<T, 6> coord)
+        : Pg3Object<Pg3Line<T>, Pg3Line<T>, T, 6>{std::move(coord)} {}
+
+    /**
+     * @brief Dual Pluecker coordinates (halves swapped)
+     *
+     */
+    constexpr auto dual() const -> Pg3Line { return Pg3Line{fun::pg3::dual(this->coord)}; }
+
+    /**
+     * @brief Plane through this line and a point (zero if the point is on it)
+     *
+     */
+    constexpr auto join(const Pg3Point<T> &pt) const -> Pg3Plane<T> {
+        return Pg3Plane<T>{fun::pg3::contract(this->coord, pt.coord)};
+    }
+
+    /**
+     * @brief Point where this line meets a plane (zero if it lies in it)
+     *
+     */
+    constexpr auto meet(const Pg3Plane<T> &plane) const -> Pg3Point<T> {
+        return Pg3Point<T>{fun::pg3::contract(fun::pg3::dual(this->coord), plane.coord)};
+    }
+
+    constexpr auto incident(const Pg3Point<T> &pt) const -> bool { return pt.incident(*this); }
+
+    constexpr auto incident(const Pg3Plane<T> &plane) const -> bool {
+        return plane.incident(*this);
+    }
+
+    /**
+     * @brief Reciprocal product; zero exactly when the lines are coplanar
+     *
+     */
+    constexpr auto reciprocal(const Pg3Line &other) const -> T {
+        const auto &a = this->coord;
+        const auto &b = other.coord;
+        return a[0] * b[3] + a[1] * b[4] + a[2] * b[5] + a[3] * b[0] + a[4] * b[1] + a[5] * b[2];
+    }
+
+    constexpr auto intersects(const Pg3Line &other) const -> bool {
+        return this->reciprocal(other) == T(0);
+    }
+
+    /**
+     * @brief Pluecker relation L01 L23 + L02 L31 + L03 L12 = 0 (a real line)
+     *
+     */
+    constexpr auto is_valid() const -> bool {
+        return !this->is_zero() && this->reciprocal(*this) == T(0);
+    }
+};
+
+namespace fun {
+
+    /**
+     * @brief Points of PG(3) as structure-of-arrays
+     *
+     * @tparam T
+     */
+    template <typename T> struct Pg3PointsSoA {
+        std::array<std::vector<T>, 4> coord;
+
+        auto size() const -> std::size_t { return this->coord[0].size(); }
+
+        void push_back(const Pg3Point<T> &pt) {
+            for (std::size_t k = 0; k != 4; ++k) this->coord[k].push_back(pt.coord[k]);
+        }
+
+        auto operator[](std::size_t i) const -> Pg3Point<T> {
+            return Pg3Point<T>{{this->coord[0][i], this->coord[1][i], this->coord[2][i],
+                                this->coord[3][i]}};
+        }
+    };
+
+    /**
+     * @brief Lines of PG(3) as structure-of-arrays
+     *
+     * @tparam T
+     */
+    template <typename T> struct Pg3LinesSoA {
+        std::array<std::vector<T>, 6> coord;
+
+        auto size() const -> std::size_t { return this->coord[0].size(); }
+
+        void resize(std::size_t n) {
+            for (auto &c : this->coord) c.resize(n);
+        }
+
+        void push_back(const Pg3Line<T> &line) {
+            for (std::size_t k = 0; k != 6; ++k) this->coord[k].push_back(line.coord[k]);
+        }
+
+        auto operator[](std::size_t i) const -> Pg3Line<T> {
+            auto c = std::array<T, 6>{};
+            for (std::size_t k = 0; k != 6; ++k) c[k] = this->coord[k][i];
+            return Pg3Line<T>{c};
+        }
+    };
+
+    /**
+     * @brief Lines p_i ^ q_i for two equally long point arrays
+     *
+     * @tparam T
+     * @param[in] pts_p
+     * @param[in] pts_q
+     * @param[in] grain
+     * @return Pg3LinesSoA<T>
+     */
+    template <typename T>
+    auto pg3_join_batch(const Pg3PointsSoA<T> &pts_p, const Pg3PointsSoA<T> &pts_q,
+                        std::size_t grain = 16384) -> Pg3LinesSoA<T> {
+        auto result = Pg3LinesSoA<T>{};
+        result.resize(pts_p.size());
+        parallel_for(pts_p.size(), grain, [&](std::size_t begin, std::size_t end) {
+            const auto *p0 = pts_p.coord[0].data();
+            const auto *p1 = pts_p.coord[1].data();
+            const auto *p2 = pts_p.coord[2].data();
+            const auto *p3 = pts_p.coord[3].data();
+            const auto *q0 = pts_q.coord[0].data();
+            const auto *q1 = pts_q.coord[1].data();
+            const auto *q2 = pts_q.coord[2].data();
+            const auto *q3 = pts_q.coord[3].data();
+            auto *l01 = result.coord[0].data();
+            auto *l02 = result.coord[1].data();
+            auto *l03 = result.coord[2].data();
+            auto *l23 = result.coord[3].data();
+            auto *l31 = result.coord[4].data();
+            auto *l12 = result.coord[5].data();
+            for (auto i = begin; i != end; ++i) {
+                l01[i] = p0[i] * q1[i] - p1[i] * q0[i];
+                l02[i] = p0[i] * q2[i] - p2[i] * q0[i];
+                l03[i] = p0[i] * q3[i] - p3[i] * q0[i];
+                l23[i] = p2[i] * q3[i] - p3[i] * q2[i];
+                l31[i] = p3[i] * q1[i] - p1[i] * q3[i];
+                l12[i] = p1[i] * q2[i] - p2[i] * q1[i];
+            }
+        });
+        return result;
+    }
+
+    /**
+     * @brief Incidence of many points with one plane
+     *
+     * @tparam T
+     * @param[in] plane
+     * @param[in] pts
+     * @param[out] out 1 where the point lies on the plane
+     * @param[in] grain
+     */
+    template <typename T>
+    void pg3_incident_batch(const Pg3Plane<T> &plane, const Pg3PointsSoA<T> &pts, uint8_t *out,
+                            std::size_t grain = 16384) {
+        const auto [e0, e1, e2, e3] = plane.coord;
+        parallel_for(pts.size(), grain, [&](std::size_t begin, std::size_t end) {
+            const auto *x = pts.coord[0].data();
+            const auto *y = pts.coord[1].data();
+            const auto *z = pts.coord[2].data();
+            const auto *w = pts.coord[3].data();
+            for (auto i = begin; i != end; ++i) {
+                out[i] = (e0 * x[i] + e1 * y[i] + e2 * z[i] + e3 * w[i]) == T(0) ? 1 : 0;
+            }
+        });
+    }
+
+    /**
+     * @brief Reciprocal products of one line with many lines
+     *
+     * @tparam T
+     * @param[in] line
+     * @param[in] lines
+     * @param[out] out zero where the lines are coplanar
+     * @param[in] grain
+     */
+    template <typename T>
+    void pg3_reciprocal_batch(const Pg3Line<T> &line, const Pg3LinesSoA<T> &lines, T *out,
+                              std::size_t grain = 16384) {
+        // reciprocal(a, b) = a . dual(b), so weight each column by the dual of `line`
+        const auto w = fun::pg3::dual(line.coord);
+        parallel_for(lines.size(), grain, [&](std::size_t begin, std::size_t end) {
+            const auto *c0 = lines.coord[0].data();
+            const auto *c1 = lines.coord[1].data();
+            const auto *c2 = lines.coord[2].data();
+            const auto *c3 = lines.coord[3].data();
+            const auto *c4 = lines.coord[4].data();
+            const auto *c5 = lines.coord[5].data();
+            for (auto i = begin; i != end; ++i) {
+                out[i] = w[0] * c0[i] + w[1] * c1[i] + w[2] * c2[i] + w[3] * c3[i] + w[4] * c4[i]
+                         + w[5] * c5[i];
+            }
+        });
+    }
+
+}  // namespace fun
@@ -0,0 +1,272 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "pg_trace.hpp"
+
+/** @file include/pg_binary_io.hpp
+ *  This is a C++ Library header.
+ *
+ *  A flat binary format for coordinate records: a 16-byte header
+ *
+ *      magic "PGCO" | version (u16) | kind (u16) | record count (u64)
+ *
+ *  followed by `count` fixed-size records in host byte order. Points and
+ *  lines are stored as three int64 coordinates; incidence records append the
+ *  id of a line through the point. I/O failures throw std::runtime_error.
+ */
+
+namespace fun {
+
+    /**
+     * @brief Record types of the binary format
+     *
+     */
+    enum class RecordKind : uint16_t {
+        Points = 1,
+        Lines = 2,
+        Incidences = 3,
+        CompressedCoords = 4,  ///< byte records, see pg_compress.hpp
+        HashIndex = 5,         ///< see pg_mapped_index.hpp
+        GridIndex = 6,
+        IncidencePairs = 7  ///< (point id, line id) pairs, see pg_result_cache.hpp
+    };
+
+    /**
+     * @brief A point with the id of an incident line
+     *
+     */
+    struct IncidenceRecord {
+        std::array<int64_t, 3> coord;
+        uint64_t line;
+
+        auto operator<(const IncidenceRecord &other) const -> bool {
+            return this->coord != other.coord ? this->coord < other.coord
+                                              : this->line < other.line;
+        }
+
+        auto operator==(const IncidenceRecord &other) const -> bool {
+            return this->coord == other.coord && this->line == other.line;
+        }
+    };
+
+    /**
+     * @brief Header of a binary coordinate file
+     *
+     */
+    struct FileHeader {
+        static constexpr std::array<char, 4> MAGIC{'P', 'G', 'C', 'O'};
+        static constexpr uint16_t VERSION = 1;
+
+        std::array<char, 4> magic = MAGIC;
+        uint16_t version = VERSION;
+        uint16_t kind = 0;
+        uint64_t count = 0;
+    };
+
+    static_assert(sizeof(FileHeader) == 16, "FileHeader must be 16 bytes");
+    static_assert(sizeof(IncidenceRecord) == 32, "IncidenceRecord must be 32 bytes");
+
+    namespace detail {
+        struct FileCloser {
+            void operator()(std::FILE *file) const { std::fclose(file); }
+        };
+
+        using FilePtr = std::unique_ptr<std::FILE, FileCloser>;
+
+        inline auto open_file(const std::string &path, const char *mode) -> FilePtr {
+            auto file = FilePtr{std::fopen(path.c_str(), mode)};
+            if (!file) throw std::runtime_error("cannot open " + path);
+            return file;
+        }
+    }  // namespace detail
+
+    /**
+     * @brief Appends records to a new file; the count is written on close
+     *
+     * @tparam Record trivially copyable
+     */
+    template <class Record> class RecordWriter {
+      private:
+        detail::FilePtr _file;
+        std::string _path;
+        FileHeader _header;
+
+      public:
+        /**
+         * @brief Create (or truncate) a file
+         *
+         * @param[in] path
+         * @param[in] kind
+         */
+        RecordWriter(const std::string &path, RecordKind kind)
+            : _file{detail::open_file(path, "wb")}, _path{path} {
+            this->_header.kind = static_cast<uint16_t>(kind);
+            if (std::fwrite(&this->_header, sizeof(FileHeader), 1, this->_file.get()) != 1) {
+                throw std::runtime_error("cannot write " + path);
+            }
+        }
+
+        RecordWriter(RecordWriter &&) noexcept = default;
+        auto operator=(RecordWriter &&) noexcept -> RecordWriter & = default;
+
+        ~RecordWriter() {
+            try {
+                this->close();
+            } catch (...) {  // NOLINT(bugprone-empty-catch)
+            }
+        }
+
+        /**
+         * @brief Append `count` records
+         *
+         * @param[in] records
+         * @param[in] count
+         */
+        void write(const Record *records, std::size_t count) {
+            if (count == 0) return;
+            if (std::fwrite(records, sizeof(Record), count, this->_file.get()) != count) {
+                throw std::runtime_error("cannot write " + this->_path);
+            }
+            this->_header.count += count;
+        }
+
+        void write(const std::vector<Record> &records) {
+            this->write(records.data(), records.size());
+        }
+
+        auto count() const -> uint64_t { return this->_header.count; }
+
+        /**
+         * @brief Patch the record count into the header and close the file
+         *
+         */
+        void close() {
+            if (!this->_file) return;
+            auto *file = this->_file.get();
+            const auto ok = std::fseek(file, 0, SEEK_SET) == 0
+                            && std::fwrite(&this->_header, sizeof(FileHeader), 1, file) == 1;
+            const auto closed = std::fclose(this->_file.release()) == 0;
+            if (!ok || !closed) throw std::runtime_error("cannot finish " + this->_path);
+        }
+    };
+
+    /**
+     * @brief Reads records from a file written by RecordWriter
+     *
+     * @tparam Record
+     */
+    template <class Record> class RecordReader {
+      private:
+        detail::FilePtr _file;
+        std::string _path;
+        FileHeader _header;
+        uint64_t _remaining;
+
+      public:
+        /**
+         * @brief Open a file and check its header
+         *
+         * @param[in] path
+         * @param[in] kind expected record kind
+         * @exception std::runtime_error if the file is not of this kind, or its
+         *            size does not match the record count of the header
+         */
+        RecordReader(const std::string &path, RecordKind kind)
+            : _file{detail::open_file(path, "rb")}, _path{path} {
+            auto *file = this->_file.get();
+            if (std::fread(&this->_header, sizeof(FileHeader), 1, file) != 1
+                || this->_header.magic != FileHeader::MAGIC
+                || this->_header.version != FileHeader::VERSION
+                || this->_header.kind != static_cast<uint16_t>(kind)) {
+                throw std::runtime_error("not a coordinate file of the expected kind: " + path);
+            }
+            // the count sizes read_all's buffer, so it must agree with the file
+            const auto end = std::fseek(file, 0, SEEK_END) == 0 ? std::ftell(file) : -1L;
+            if (end < 0 || std::fseek(file, sizeof(FileHeader), SEEK_SET) != 0) {
+                throw std::runtime_error("cannot read " + path);
+            }
+            const auto body = static_cast<uint64_t>(end) - sizeof(FileHeader);
+            if (body % sizeof(Record) != 0 || body / sizeof(Record) != this->_header.count) {
+                throw std::runtime_error("record count does not match the file size: " + path);
+            }
+            this->_remaining = this->_header.count;
+        }
+
+        auto count() const -> uint64_t { return this->_header.count; }
+
+        /**
+         * @brief Read up to `max_count` records
+         *
+         * @param[out] records
+         * @param[in] max_count
+         * @return std::size_t records read, 0 at the end
+         */
+        auto read(Record *records, std::size_t max_count) -> std::size_t {
+            const auto want = static_cast<std::size_t>(
+                std::min<uint64_t>(this->_remaining, static_cast<uint64_t>(max_count)));
+            if (want == 0) return 0;
+            if (std::fread(records, sizeof(Record), want, this->_file.get()) != want) {
+                throw std::runtime_error("truncated coordinate file: " + this->_path);
+            }
+            this->_remaining -= want;
+            return want;
+        }
+
+        /**
+         * @brief All remaining records
+         *
+         * @return std::vector<Record>
+         */
+        auto read_all() -> std::vector<Record> {
+            auto records = std::vector<Record>(static_cast<std::size_t>(this->_remaining));
+            records.resize(this->read(records.data(), records.size()));
+            return records;
+        }
+    };
+
+    /**
+     * @brief Write points or lines to a file
+     *
+     * @tparam Object
+     * @param[in] path
+     * @param[in] objects
+     * @param[in] kind RecordKind::Points or RecordKind::Lines
+     */
+    template <class Object>
+    void write_objects(const std::string &path, const std::vector<Object> &objects,
+                       RecordKind kind = RecordKind::Points) {
+        PG_TRACE_SCOPE("binary_io", "write");
+        auto writer = RecordWriter<std::array<int64_t, 3>>(path, kind);
+        for (const auto &obj : objects) writer.write(&obj.coord, 1);
+        writer.close();
+    }
+
+    /**
+     * @brief Read points or lines from a file
+     *
+     * @tparam Object
+     * @param[in] path
+     * @param[in] kind
+     * @return std::vector<Object>
+     */
+    template <class Object>
+    auto read_objects(const std::string &path, RecordKind kind = RecordKind::Points)
+        -> std::vector<Object> {
+        PG_TRACE_SCOPE("binary_io", "read");
+        auto reader = RecordReader<std::array<int64_t, 3>>(path, kind);
+        auto result = std::vector<Object>{};
+        result.reserve(static_cast<std::size_t>(reader.count()));
+        for (const auto &coord : reader.read_all()) result.push_back(Object{coord});
+        return result;
+    }
+
+}  // namespace fun
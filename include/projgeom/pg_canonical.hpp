@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+
+/** @file include/pg_canonical.hpp
+ *  This is a C++ Library header.
+ */
+
+namespace fun {
+
+    /**
+     * @brief Canonical representative of a homogeneous coordinate
+     *
+     * Divides by the gcd of the components and flips the sign so that the last
+     * non-zero component is positive. Two non-zero coordinates are equal under
+     * `PgObject::operator==` exactly when their canonical forms are identical.
+     * Affine points (z != 0) come out with z > 0.
+     *
+     * @param[in] coord Homogeneous coordinate
+     * @return std::array<int64_t, 3>
+     */
+    inline auto canonical_coord(const std::array<int64_t, 3> &coord) -> std::array<int64_t, 3> {
+        auto g = std::gcd(std::gcd(coord[0], coord[1]), coord[2]);
+        if (g == 0) return coord;
+        const auto last = coord[2] != 0 ? coord[2] : coord[1] != 0 ? coord[1] : coord[0];
+        if (last < 0) g = -g;
+        return {coord[0] / g, coord[1] / g, coord[2] / g};
+    }
+
+    /**
+     * @brief Canonical representative of a point or line
+     *
+     * @tparam Object PgObject-derived point or line
+     * @param[in] obj
+     * @return Object
+     */
+    template <class Object> auto canonical(const Object &obj) -> Object {
+        return Object{canonical_coord(obj.coord)};
+    }
+
+    /**
+     * @brief Hash of a homogeneous coordinate (apply to canonical forms)
+     *
+     */
+    struct CoordHash {
+        auto operator()(const std::array<int64_t, 3> &coord) const noexcept -> std::size_t {
+            uint64_t h = 0x9E3779B97F4A7C15ULL;
+            for (const auto c : coord) {
+                h ^= static_cast<uint64_t>(c) + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+                h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+            }
+            return static_cast<std::size_t>(h ^ (h >> 31));
+        }
+    };
+
+}  // namespace fun
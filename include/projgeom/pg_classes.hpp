@@ -0,0 +1,220 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "pg_canonical.hpp"
+#include "pg_parallel.hpp"
+
+/** @file include/pg_classes.hpp
+ *  This is a C++ Library header.
+ *
+ *  Parallel and perpendicular classes in linear time. Each line is keyed by
+ *  the canonical form of its point at infinity (parallel) or of the point at
+ *  infinity of the perpendicular direction (`fB` for Euclid, the polarity of
+ *  the plane for a perspective plane); hashing the keys groups the lines.
+ *  Classes are numbered independently in the two groupings, so match them by
+ *  key: the lines of the perpendicular class keyed P are perpendicular to the
+ *  lines of the parallel class keyed P.
+ */
+
+namespace fun {
+
+    /**
+     * @brief Directions in the Euclidean plane (line at infinity z = 0)
+     *
+     */
+    struct EuclidDirection {
+        /// point at infinity of the line, as in cross2-based is_parallel
+        template <class Line> auto key(const Line &ln) const -> std::array<int64_t, 3> {
+            return canonical_coord({ln.coord[1], -ln.coord[0], 0});
+        }
+
+        /// point at infinity of the perpendicular direction, fB(line)
+        template <class Line> auto perp_key(const Line &ln) const -> std::array<int64_t, 3> {
+            return canonical_coord({ln.coord[0], ln.coord[1], 0});
+        }
+    };
+
+    /**
+     * @brief Directions in a perspective plane with line at infinity `l_inf`
+     *
+     * The perpendicular of a line l is (l . i_re) i_re + (l . i_im) i_im, the
+     * polarity of `PerspLine::perp()` with the plane's own points; i_re and
+     * i_im must lie on l_inf. For the standard plane use {L_INF, I_RE, I_IM}.
+     *
+     * @tparam Line e.g. PerspLine
+     */
+    template <class Line> struct PerspDirection {
+        using Point = typename Line::Dual;
+
+        Line l_inf;
+        Point i_re;
+        Point i_im;
+
+        auto key(const Line &ln) const -> std::array<int64_t, 3> {
+            return canonical_coord(ln.meet(this->l_inf).coord);
+        }
+
+        auto perp_key(const Line &ln) const -> std::array<int64_t, 3> {
+            return canonical_coord(
+                Point::parametrize(ln.dot(this->i_re), this->i_re, ln.dot(this->i_im), this->i_im)
+                    .coord);
+        }
+    };
+
+    /**
+     * @brief Indices grouped by key, in CSR form
+     *
+     * Classes are ordered by their smallest member; members ascend within a
+     * class. A zero key collects the lines that have no direction (the line
+     * at infinity).
+     *
+     * @tparam Point
+     */
+    template <class Point> struct ClassBuckets {
+        std::vector<Point> keys;             ///< one canonical point per class
+        std::vector<std::size_t> start;      ///< class c is members[start[c], start[c + 1])
+        std::vector<std::size_t> members;
+
+        auto size() const -> std::size_t { return this->keys.size(); }
+
+        auto class_size(std::size_t c) const -> std::size_t {
+            return this->start[c + 1] - this->start[c];
+        }
+    };
+
+    /**
+     * @brief Group [0, count) by `key_of(i)` with a hash-partitioned parallel pass
+     *
+     * The shard count is fixed, so the output does not depend on the number
+     * of threads.
+     *
+     * @tparam Point
+     * @tparam KeyFn callable as key_of(std::size_t) -> std::array<int64_t, 3>
+     * @param[in] count
+     * @param[in] key_of
+     * @param[in] grain items per chunk
+     * @return ClassBuckets<Point>
+     */
+    template <class Point, class KeyFn>
+    auto bucket_by_key(std::size_t count, KeyFn &&key_of, std::size_t grain = 16384)
+        -> ClassBuckets<Point> {
+        using Coord = std::array<int64_t, 3>;
+        constexpr std::size_t SHARDS = 64;
+        grain = std::max<std::size_t>(grain, 1);
+        const auto chunks = (count + grain - 1) / grain;
+
+        // 1. keys, and per-chunk shard histograms
+        auto keys = std::vector<Coord>(count);
+        auto shard = std::vector<uint8_t>(count);
+        auto hist = std::vector<std::size_t>(chunks * SHARDS, 0);
+        parallel_for(chunks, 1, [&](std::size_t begin, std::size_t end) {
+            for (auto ch = begin; ch != end; ++ch) {
+                for (auto i = ch * grain; i != std::min(count, (ch + 1) * grain); ++i) {
+                    keys[i] = key_of(i);
+                    shard[i] = static_cast<uint8_t>(CoordHash{}(keys[i]) % SHARDS);
+                    ++hist[ch * SHARDS + shard[i]];
+                }
+            }
+        });
+
+        // 2. stable scatter into shards
+        auto shard_start = std::vector<std::size_t>(SHARDS + 1, 0);
+        auto offset = std::vector<std::size_t>(chunks * SHARDS);
+        std::size_t total = 0;
+        for (std::size_t s = 0; s != SHARDS; ++s) {
+            shard_start[s] = total;
+            for (std::size_t ch = 0; ch != chunks; ++ch) {
+                offset[ch * SHARDS + s] = total;
+                total += hist[ch * SHARDS + s];
+            }
+        }
+        shard_start[SHARDS] = total;
+        auto order = std::vector<std::size_t>(count);
+        parallel_for(chunks, 1, [&](std::size_t begin, std::size_t end) {
+            for (auto ch = begin; ch != end; ++ch) {
+                for (auto i = ch * grain; i != std::min(count, (ch + 1) * grain); ++i) {
+                    order[offset[ch * SHARDS + shard[i]]++] = i;
+                }
+            }
+        });
+
+        // 3. group each shard independently
+        using Group = std::pair<Coord, std::vector<std::size_t>>;
+        auto groups = std::vector<std::vector<Group>>(SHARDS);
+        parallel_for(SHARDS, 1, [&](std::size_t begin, std::size_t end) {
+            for (auto s = begin; s != end; ++s) {
+                auto index = std::unordered_map<Coord, std::size_t, CoordHash>{};
+                for (auto k = shard_start[s]; k != shard_start[s + 1]; ++k) {
+                    const auto i = order[k];
+                    const auto [it, fresh] = index.emplace(keys[i], groups[s].size());
+                    if (fresh) groups[s].emplace_back(keys[i], std::vector<std::size_t>{});
+                    groups[s][it->second].second.push_back(i);
+                }
+            }
+        });
+
+        // 4. CSR output, classes by smallest member
+        auto all = std::vector<Group *>{};
+        for (auto &shard_groups : groups) {
+            for (auto &group : shard_groups) all.push_back(&group);
+        }
+        std::sort(all.begin(), all.end(), [](const Group *x, const Group *y) {
+            return x->second.front() < y->second.front();
+        });
+        auto result = ClassBuckets<Point>{};
+        result.keys.reserve(all.size());
+        result.start.reserve(all.size() + 1);
+        result.members.reserve(count);
+        for (const auto *group : all) {
+            result.keys.push_back(Point{group->first});
+            result.start.push_back(result.members.size());
+            result.members.insert(result.members.end(), group->second.begin(),
+                                  group->second.end());
+        }
+        result.start.push_back(result.members.size());
+        return result;
+    }
+
+    /**
+     * @brief Parallel classes of lines
+     *
+     * @tparam Line
+     * @tparam Direction EuclidDirection or PerspDirection<Line>
+     * @param[in] lines
+     * @param[in] dir
+     * @return ClassBuckets<typename Line::Dual>
+     */
+    template <class Line, class Direction = EuclidDirection>
+    auto parallel_classes(const std::vector<Line> &lines, const Direction &dir = {})
+        -> ClassBuckets<typename Line::Dual> {
+        return bucket_by_key<typename Line::Dual>(
+            lines.size(), [&](std::size_t i) { return dir.key(lines[i]); });
+    }
+
+    /**
+     * @brief Perpendicular classes of lines
+     *
+     * The class keyed P holds the lines perpendicular to direction P; its
+     * index need not match that of the parallel class keyed P.
+     *
+     * @tparam Line
+     * @tparam Direction EuclidDirection or PerspDirection<Line>
+     * @param[in] lines
+     * @param[in] dir
+     * @return ClassBuckets<typename Line::Dual>
+     */
+    template <class Line, class Direction = EuclidDirection>
+    auto perpendicular_classes(const std::vector<Line> &lines, const Direction &dir = {})
+        -> ClassBuckets<typename Line::Dual> {
+        return bucket_by_key<typename Line::Dual>(
+            lines.size(), [&](std::size_t i) { return dir.perp_key(lines[i]); });
+    }
+
+}  // namespace fun
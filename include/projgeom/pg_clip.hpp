@@ -0,0 +1,175 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "pg_canonical.hpp"
+#include "pg_parallel.hpp"
+#include "pg_polygon.hpp"
+#include "pg_wide.hpp"
+
+/** @file include/pg_clip.hpp
+ *  This is a C++ Library header.
+ *
+ *  Sutherland-Hodgman clipping in homogeneous integer coordinates. Side tests
+ *  are signs of `dot`, crossings are `meet`s, so no division ever happens.
+ *  Both are evaluated in 128 bits and every new vertex is reduced by its gcd,
+ *  which keeps the coordinates from growing across the clip stages; a vertex
+ *  that still does not fit int64 throws std::overflow_error.
+ */
+
+namespace fun {
+
+    /**
+     * @brief Side of an affine point relative to an oriented line
+     *
+     * @param[in] coord Homogeneous coordinate with positive last component
+     * @param[in] ln_l
+     * @return int64_t positive on the kept side, zero on the line
+     */
+    template <class Line>
+    constexpr auto side_of(const std::array<int64_t, 3> &coord, const Line &ln_l) -> int64_t {
+        return sign_of(dot_wide(coord, ln_l.coord));
+    }
+
+    /**
+     * @brief Clip a polygon against the half-plane `ln_l . p >= 0`
+     *
+     * One Sutherland-Hodgman stage. The returned vertices have a positive last
+     * coordinate.
+     *
+     * @tparam Point
+     * @param[in] polygon affine vertices
+     * @param[in] ln_l boundary line, oriented so that the kept side is positive
+     * @return std::vector<Point>
+     * @exception std::overflow_error if a crossing does not fit int64
+     */
+    template <class Point, class Line = typename Point::Dual>
+    auto clip_half_plane(const std::vector<Point> &polygon, const Line &ln_l)
+        -> std::vector<Point> {
+        auto result = std::vector<Point>{};
+        const auto n = polygon.size();
+        if (n == 0) return result;
+        result.reserve(n + 1);
+        auto prev = affine_coord(polygon[n - 1].coord);
+        auto s_prev = side_of(prev, ln_l);
+        for (const auto &pt_p : polygon) {
+            const auto cur = affine_coord(pt_p.coord);
+            const auto s_cur = side_of(cur, ln_l);
+            if ((s_prev > 0 && s_cur < 0) || (s_prev < 0 && s_cur > 0)) {
+                const auto edge = narrow_reduced<3>(cross_wide(prev, cur));
+                result.push_back(Point{narrow_reduced<3>(cross_wide(edge, ln_l.coord))});
+            }
+            if (s_cur >= 0) result.push_back(Point{cur});
+            prev = cur;
+            s_prev = s_cur;
+        }
+        if (result.size() < 3) result.clear();
+        return result;
+    }
+
+    /**
+     * @brief Convex clip window with precomputed, inward-oriented edge lines
+     *
+     * @tparam Point
+     * @tparam Line
+     */
+    template <class Point, class Line = typename Point::Dual> class ConvexWindow {
+      private:
+        std::vector<Line> _edges;
+
+      public:
+        /**
+         * @brief Construct a new Convex Window object
+         *
+         * @param[in] vertices convex polygon, either orientation
+         * @exception std::overflow_error if an edge line does not fit int64
+         */
+        explicit ConvexWindow(const std::vector<Point> &vertices) {
+            const auto n = vertices.size();
+            assert(n >= 3);
+            this->_edges.reserve(n);
+            for (std::size_t i = 0; i != n; ++i) {
+                const auto a = Point{affine_coord(vertices[i].coord)};
+                const auto b = Point{affine_coord(vertices[(i + 1) % n].coord)};
+                this->_edges.push_back(Line{cross_oriented(a.coord, b.coord)});
+            }
+            // the edges share the orientation of the ring; orient every edge line so that
+            // the interior is on its positive side
+            for (std::size_t i = 0; i != n; ++i) {
+                const auto s
+                    = side_of(affine_coord(vertices[(i + 2) % n].coord), this->_edges[i]);
+                if (s == 0) continue;
+                if (s < 0) {
+                    for (auto &ln : this->_edges) {
+                        ln = Line{
+                            std::array<int64_t, 3>{-ln.coord[0], -ln.coord[1], -ln.coord[2]}};
+                    }
+                }
+                break;
+            }
+        }
+
+        /**
+         * @brief Edge lines, oriented inwards
+         *
+         * @return const std::vector<Line>&
+         */
+        auto edges() const -> const std::vector<Line> & { return this->_edges; }
+
+        /**
+         * @brief Whether an affine point is inside or on the window
+         *
+         * @param[in] pt_p
+         * @return true
+         * @return false
+         */
+        auto contains(const Point &pt_p) const -> bool {
+            const auto c = affine_coord(pt_p.coord);
+            for (const auto &ln : this->_edges) {
+                if (side_of(c, ln) < 0) return false;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Clip one polygon against the window
+         *
+         * @param[in] polygon affine vertices
+         * @return std::vector<Point> empty if nothing remains
+         * @exception std::overflow_error if a crossing does not fit int64
+         */
+        auto clip(const std::vector<Point> &polygon) const -> std::vector<Point> {
+            auto result = polygon;
+            for (const auto &ln : this->_edges) {
+                if (result.empty()) break;
+                result = clip_half_plane(result, ln);
+            }
+            return result;
+        }
+    };
+
+    /**
+     * @brief Clip many polygons against one window, in parallel over polygons
+     *
+     * @tparam Point
+     * @param[in] window
+     * @param[in] polygons
+     * @param[in] grain polygons per chunk
+     * @return std::vector<std::vector<Point>>
+     */
+    template <class Point, class Line>
+    auto clip_polygons(const ConvexWindow<Point, Line> &window,
+                       const std::vector<std::vector<Point>> &polygons, std::size_t grain = 256)
+        -> std::vector<std::vector<Point>> {
+        auto result = std::vector<std::vector<Point>>(polygons.size());
+        parallel_for(polygons.size(), grain, [&](std::size_t begin, std::size_t end) {
+            for (auto i = begin; i != end; ++i) result[i] = window.clip(polygons[i]);
+        });
+        return result;
+    }
+
+}  // namespace fun
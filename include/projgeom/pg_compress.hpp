@@ -0,0 +1,409 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "pg_binary_io.hpp"
+#include "pg_canonical.hpp"
+#include "pg_parallel.hpp"
+#include "pg_trace.hpp"
+
+/** @file include/pg_compress.hpp
+ *  This is a C++ Library header.
+ *
+ *  Compressed storage for sets of canonical coordinates. The set is sorted
+ *  and cut into blocks; within a block each column (x, y, z) is stored as
+ *  its first value followed by the zig-zag encoded differences of
+ *  consecutive values, bit-packed at the width of the largest one. Sorted
+ *  canonical points have small differences, so a column often packs into a
+ *  few bits per value instead of 64.
+ *
+ *  Block layout: first x, y, z (3 x 8 bytes), bit widths (3 bytes), then
+ *  the packed x, y and z differences, each rounded up to whole bytes. An
+ *  offset table gives random access to every block, and blocks decode
+ *  independently into structure-of-arrays buffers.
+ */
+
+namespace fun {
+
+    /**
+     * @brief Sorted, deduplicated canonical coordinates in compressed blocks
+     *
+     */
+    class CompressedCoords {
+      public:
+        using Coord = std::array<int64_t, 3>;
+        static constexpr std::size_t DEFAULT_BLOCK = 1024;
+
+      private:
+        static constexpr std::size_t HEAD = 3 * 8 + 3;  // first values and widths
+        static constexpr std::size_t PAD = 8;            // slack for 64-bit loads
+
+        std::size_t _count{0};
+        std::size_t _block{DEFAULT_BLOCK};
+        std::vector<uint64_t> _offsets{0};  // block b is _data[_offsets[b], _offsets[b + 1])
+        std::vector<uint8_t> _data;
+
+        static auto zigzag(uint64_t delta) -> uint64_t {
+            return (delta << 1) ^ static_cast<uint64_t>(static_cast<int64_t>(delta) >> 63);
+        }
+
+        static auto unzigzag(uint64_t code) -> uint64_t {
+            return (code >> 1) ^ (uint64_t{0} - (code & 1));
+        }
+
+        static auto bit_width(uint64_t value) -> uint8_t {
+            auto width = uint8_t{0};
+            while (value != 0) {
+                ++width;
+                value >>= 1;
+            }
+            return width;
+        }
+
+        static auto load64(const uint8_t *p) -> uint64_t {
+            auto word = uint64_t{0};
+            std::memcpy(&word, p, sizeof(word));
+            return word;
+        }
+
+        /**
+         * @brief Append `count` values of `width` bits, LSB first
+         *
+         */
+        static void pack(const uint64_t *values, std::size_t count, uint8_t width,
+                         std::vector<uint8_t> &out) {
+            auto acc = uint64_t{0};
+            auto filled = 0U;  // bits pending in acc
+            auto flush = [&out](uint64_t word, std::size_t nbytes) {
+                for (std::size_t k = 0; k != nbytes; ++k) {
+                    out.push_back(static_cast<uint8_t>(word >> (8 * k)));
+                }
+            };
+            for (std::size_t i = 0; i != count; ++i) {
+                acc |= values[i] << filled;
+                if (filled + width < 64) {
+                    filled += width;
+                    continue;
+                }
+                flush(acc, 8);
+                acc = filled == 0 ? 0 : values[i] >> (64 - filled);
+                filled = filled + width - 64;
+            }
+            flush(acc, (filled + 7) / 8);
+        }
+
+        /**
+         * @brief Decode one column: unpack, unzigzag and prefix-sum
+         *
+         */
+        static void unpack_column(const uint8_t *p, uint8_t width, int64_t first,
+                                  std::size_t count, int64_t *out) {
+            out[0] = first;
+            auto acc = static_cast<uint64_t>(first);
+            if (width == 0) {
+                for (std::size_t i = 1; i != count; ++i) out[i] = first;
+                return;
+            }
+            if (width <= 56) {
+                const auto mask = (uint64_t{1} << width) - 1;
+                for (std::size_t i = 1; i != count; ++i) {
+                    const auto bit = (i - 1) * width;
+                    const auto code = (load64(p + bit / 8) >> (bit % 8)) & mask;
+                    acc += unzigzag(code);
+                    out[i] = static_cast<int64_t>(acc);
+                }
+                return;
+            }
+            const auto mask = width == 64 ? ~uint64_t{0} : (uint64_t{1} << width) - 1;
+            for (std::size_t i = 1; i != count; ++i) {
+                const auto bit = (i - 1) * width;
+                auto code = load64(p + bit / 8) >> (bit % 8);
+                if (bit % 8 != 0) code |= uint64_t{p[bit / 8 + 8]} << (64 - bit % 8);
+                acc += unzigzag(code & mask);
+                out[i] = static_cast<int64_t>(acc);
+            }
+        }
+
+        /**
+         * @brief Whether `length` bytes hold a block of `count` coordinates
+         *
+         * The widths must be at most 64 and the packed columns must fill the
+         * block exactly, so that decoding stays inside it.
+         */
+        static auto valid_block(const uint8_t *p, std::size_t length, std::size_t count) -> bool {
+            if (length < HEAD) return false;
+            auto packed = std::size_t{0};
+            for (std::size_t c = 0; c != 3; ++c) {
+                const auto width = std::size_t{p[24 + c]};
+                if (width > 64) return false;
+                if (width != 0 && count - 1 > (length - HEAD) * 8 / width) return false;
+                packed += ((count - 1) * width + 7) / 8;
+            }
+            return HEAD + packed == length;
+        }
+
+        static auto encode_block(const Coord *coords, std::size_t count) -> std::vector<uint8_t> {
+            auto out = std::vector<uint8_t>(HEAD);
+            auto codes = std::array<std::vector<uint64_t>, 3>{};
+            auto widths = std::array<uint8_t, 3>{};
+            for (std::size_t c = 0; c != 3; ++c) {
+                std::memcpy(out.data() + 8 * c, &coords[0][c], 8);
+                codes[c].resize(count - 1);
+                auto widest = uint64_t{0};
+                for (std::size_t i = 1; i != count; ++i) {
+                    const auto delta = static_cast<uint64_t>(coords[i][c])
+                                       - static_cast<uint64_t>(coords[i - 1][c]);
+                    codes[c][i - 1] = zigzag(delta);
+                    widest |= codes[c][i - 1];
+                }
+                widths[c] = bit_width(widest);
+                out[24 + c] = widths[c];
+            }
+            for (std::size_t c = 0; c != 3; ++c) pack(codes[c].data(), count - 1, widths[c], out);
+            return out;
+        }
+
+      public:
+        CompressedCoords() = default;
+
+        /**
+         * @brief Compress a set of coordinates
+         *
+         * Coordinates are canonicalized, sorted and deduplicated first.
+         * Blocks are encoded in parallel.
+         *
+         * @param[in] coords
+         * @param[in] block coordinates per block
+         * @return CompressedCoords
+         */
+        static auto encode(std::vector<Coord> coords, std::size_t block = DEFAULT_BLOCK)
+            -> CompressedCoords {
+            PG_TRACE_SCOPE("compress", "encode");
+            for (auto &coord : coords) coord = canonical_coord(coord);
+            std::sort(coords.begin(), coords.end());
+            coords.erase(std::unique(coords.begin(), coords.end()), coords.end());
+
+            auto result = CompressedCoords{};
+            result._count = coords.size();
+            result._block = std::max<std::size_t>(block, 1);
+            const auto blocks = (coords.size() + result._block - 1) / result._block;
+            auto encoded = std::vector<std::vector<uint8_t>>(blocks);
+            parallel_for(blocks, 1, [&](std::size_t begin, std::size_t end) {
+                for (auto b = begin; b != end; ++b) {
+                    PG_TRACE_CHUNK("compress", "encode_block", b);
+                    const auto first = b * result._block;
+                    const auto count = std::min(coords.size(), first + result._block) - first;
+                    encoded[b] = encode_block(coords.data() + first, count);
+                }
+            });
+            for (const auto &bytes : encoded) {
+                result._data.insert(result._data.end(), bytes.begin(), bytes.end());
+                result._offsets.push_back(result._data.size());
+            }
+            result._data.resize(result._data.size() + PAD, 0);
+            return result;
+        }
+
+        /**
+         * @brief Compress the coordinates of points or lines
+         *
+         * @tparam Object
+         * @param[in] objects
+         * @param[in] block
+         * @return CompressedCoords
+         */
+        template <class Object>
+        static auto from_objects(const std::vector<Object> &objects,
+                                 std::size_t block = DEFAULT_BLOCK) -> CompressedCoords {
+            auto coords = std::vector<Coord>{};
+            coords.reserve(objects.size());
+            for (const auto &obj : objects) coords.push_back(obj.coord);
+            return encode(std::move(coords), block);
+        }
+
+        /// number of coordinates
+        auto size() const -> std::size_t { return this->_count; }
+
+        /// number of blocks
+        auto blocks() const -> std::size_t { return this->_offsets.size() - 1; }
+
+        /// coordinates per block (the last block may hold fewer)
+        auto block_capacity() const -> std::size_t { return this->_block; }
+
+        /// compressed size of the blocks in bytes
+        auto bytes() const -> std::size_t { return this->_offsets.back(); }
+
+        /**
+         * @brief Number of coordinates in block b
+         *
+         * @param[in] b
+         * @return std::size_t
+         */
+        auto block_size(std::size_t b) const -> std::size_t {
+            return std::min(this->_count, (b + 1) * this->_block) - b * this->_block;
+        }
+
+        /**
+         * @brief Decode block b into structure-of-arrays buffers
+         *
+         * @param[in] b
+         * @param[out] x at least block_capacity() entries
+         * @param[out] y
+         * @param[out] z
+         * @return std::size_t coordinates decoded
+         */
+        auto decode_block(std::size_t b, int64_t *x, int64_t *y, int64_t *z) const
+            -> std::size_t {
+            const auto count = this->block_size(b);
+            const auto *p = this->_data.data() + this->_offsets[b];
+            auto first = std::array<int64_t, 3>{};
+            std::memcpy(first.data(), p, 24);
+            const auto widths = std::array<uint8_t, 3>{p[24], p[25], p[26]};
+            auto column = p + HEAD;
+            auto outs = std::array<int64_t *, 3>{x, y, z};
+            for (std::size_t c = 0; c != 3; ++c) {
+                unpack_column(column, widths[c], first[c], count, outs[c]);
+                column += ((count - 1) * widths[c] + 7) / 8;
+            }
+            return count;
+        }
+
+        /**
+         * @brief Stream every block through `func(x, y, z, count)`
+         *
+         * The buffers are reused from block to block.
+         *
+         * @tparam Fn callable as func(const int64_t *, const int64_t *, const int64_t *,
+         *            std::size_t)
+         * @param[in] func
+         */
+        template <class Fn> void for_each_block(Fn &&func) const {
+            auto x = std::vector<int64_t>(this->_block);
+            auto y = std::vector<int64_t>(this->_block);
+            auto z = std::vector<int64_t>(this->_block);
+            for (std::size_t b = 0; b != this->blocks(); ++b) {
+                const auto count = this->decode_block(b, x.data(), y.data(), z.data());
+                func(static_cast<const int64_t *>(x.data()), static_cast<const int64_t *>(y.data()),
+                     static_cast<const int64_t *>(z.data()), count);
+            }
+        }
+
+        /**
+         * @brief Decode everything into structure-of-arrays, blocks in parallel
+         *
+         * @param[out] x
+         * @param[out] y
+         * @param[out] z
+         */
+        void decode_all(std::vector<int64_t> &x, std::vector<int64_t> &y,
+                        std::vector<int64_t> &z) const {
+            x.resize(this->_count);
+            y.resize(this->_count);
+            z.resize(this->_count);
+            parallel_for(this->blocks(), 1, [&](std::size_t begin, std::size_t end) {
+                for (auto b = begin; b != end; ++b) {
+                    PG_TRACE_CHUNK("compress", "decode_block", b);
+                    const auto first = b * this->_block;
+                    this->decode_block(b, x.data() + first, y.data() + first, z.data() + first);
+                }
+            });
+        }
+
+        /**
+         * @brief Decode everything as coordinates
+         *
+         * @return std::vector<Coord>
+         */
+        auto to_vector() const -> std::vector<Coord> {
+            auto x = std::vector<int64_t>{};
+            auto y = std::vector<int64_t>{};
+            auto z = std::vector<int64_t>{};
+            this->decode_all(x, y, z);
+            auto result = std::vector<Coord>(this->_count);
+            for (std::size_t i = 0; i != this->_count; ++i) result[i] = {x[i], y[i], z[i]};
+            return result;
+        }
+
+        /**
+         * @brief Save as a binary coordinate file of kind CompressedCoords
+         *
+         * Payload: count, block capacity, block count, offsets, block data.
+         *
+         * @param[in] path
+         */
+        void save(const std::string &path) const {
+            auto bytes = std::vector<uint8_t>{};
+            auto put = [&bytes](uint64_t value) {
+                const auto at = bytes.size();
+                bytes.resize(at + 8);
+                std::memcpy(bytes.data() + at, &value, 8);
+            };
+            put(this->_count);
+            put(this->_block);
+            put(this->blocks());
+            for (const auto offset : this->_offsets) put(offset);
+            bytes.insert(bytes.end(), this->_data.begin(),
+                         this->_data.begin() + static_cast<std::ptrdiff_t>(this->bytes()));
+            auto writer = RecordWriter<uint8_t>(path, RecordKind::CompressedCoords);
+            writer.write(bytes);
+            writer.close();
+        }
+
+        /**
+         * @brief Load a file written by `save`
+         *
+         * @param[in] path
+         * @return CompressedCoords
+         * @exception std::runtime_error if the file is malformed
+         */
+        static auto load(const std::string &path) -> CompressedCoords {
+            const auto bytes = RecordReader<uint8_t>(path, RecordKind::CompressedCoords).read_all();
+            auto at = std::size_t{0};
+            auto get = [&]() {
+                if (at + 8 > bytes.size()) throw std::runtime_error("truncated " + path);
+                auto value = uint64_t{0};
+                std::memcpy(&value, bytes.data() + at, 8);
+                at += 8;
+                return value;
+            };
+            auto result = CompressedCoords{};
+            result._count = static_cast<std::size_t>(get());
+            result._block = static_cast<std::size_t>(get());
+            const auto blocks = static_cast<std::size_t>(get());
+            if (result._block == 0
+                || result._block > std::numeric_limits<std::size_t>::max() - result._count
+                || blocks != (result._count + result._block - 1) / result._block
+                || blocks >= (bytes.size() - at) / 8) {
+                throw std::runtime_error("inconsistent block table in " + path);
+            }
+            result._offsets.resize(blocks + 1);
+            for (auto &offset : result._offsets) offset = get();
+            const auto length = bytes.size() - at;
+            if (result._offsets.front() != 0 || result._offsets.back() != length) {
+                throw std::runtime_error("inconsistent block table in " + path);
+            }
+            for (std::size_t b = 0; b != blocks; ++b) {
+                const auto begin = result._offsets[b];
+                const auto end = result._offsets[b + 1];
+                if (end < begin || end > length
+                    || !valid_block(bytes.data() + at + begin, end - begin,
+                                    result.block_size(b))) {
+                    throw std::runtime_error("corrupt block " + std::to_string(b) + " in "
+                                             + path);
+                }
+            }
+            result._data.assign(bytes.begin() + static_cast<std::ptrdiff_t>(at), bytes.end());
+            result._data.resize(result._data.size() + PAD, 0);
+            return result;
+        }
+    };
+
+}  // namespace fun
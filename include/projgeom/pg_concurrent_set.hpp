@@ -0,0 +1,450 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "pg_canonical.hpp"
+#include "pg_parallel.hpp"
+
+/** @file include/pg_concurrent_set.hpp
+ *  This is a C++ Library header.
+ *
+ *  Concurrent deduplication of points and lines. Keys are canonical
+ *  coordinates, so two objects share an entry exactly when they are equal
+ *  under `PgObject::operator==`.
+ *
+ *  `ConcurrentCoordMap` is an open-addressing table with one atomic state
+ *  per slot (EMPTY -> BUSY -> READY, or -> MOVED during a resize). A slot is
+ *  claimed with a CAS, its key and value are written, and READY is published
+ *  with release order, so readers never see a half-written key. When the
+ *  table passes 3/4 load a larger one is attached, and every thread that
+ *  notices helps migrate it chunk by chunk; inserts resume once migration
+ *  has finished, which keeps every key in exactly one slot. Retired tables
+ *  stay allocated until the map is destroyed, so no reader is left with a
+ *  dangling table.
+ *
+ *  `ShardedCoordMap` is the alternative for write-heavy phases: each thread
+ *  fills a private hash map, and the shards are merged at the end.
+ */
+
+namespace fun {
+
+    /**
+     * @brief Concurrent map from canonical coordinates to values
+     *
+     * Values are written once, on insertion; later inserts of the same key
+     * see the first value.
+     *
+     * @tparam Value default-constructible and copyable
+     */
+    template <class Value> class ConcurrentCoordMap {
+      public:
+        using Coord = std::array<int64_t, 3>;
+
+      private:
+        enum : uint32_t { EMPTY = 0, BUSY = 1, READY = 2, MOVED = 3 };
+        static constexpr std::size_t CHUNK = 1024;  // slots per migration job
+
+        struct Table {
+            std::size_t capacity;
+            std::unique_ptr<std::atomic<uint32_t>[]> state;
+            std::unique_ptr<Coord[]> keys;
+            std::unique_ptr<Value[]> values;
+            std::atomic<std::size_t> count{0};
+            std::atomic<Table *> next{nullptr};
+            std::atomic<std::size_t> next_chunk{0};
+            std::atomic<std::size_t> done_chunks{0};
+
+            explicit Table(std::size_t capacity)
+                : capacity{capacity},
+                  state{new std::atomic<uint32_t>[capacity]},
+                  keys{new Coord[capacity]},
+                  values{new Value[capacity]} {
+                for (std::size_t i = 0; i != capacity; ++i) {
+                    this->state[i].store(EMPTY, std::memory_order_relaxed);
+                }
+            }
+
+            auto chunks() const -> std::size_t { return (this->capacity + CHUNK - 1) / CHUNK; }
+        };
+
+        std::atomic<Table *> _current;
+        std::mutex _tables_mutex;  // guards _tables; taken only when a table is added
+        std::vector<std::unique_ptr<Table>> _tables;
+
+        static auto wait() -> void { std::this_thread::yield(); }
+
+        /**
+         * @brief Insert into one table, or nullopt if a resize got in the way
+         *
+         */
+        static auto probe_insert(Table &table, const Coord &key, std::size_t hash,
+                                 const Value &value) -> std::optional<std::pair<Value, bool>> {
+            const auto mask = table.capacity - 1;
+            auto i = hash & mask;
+            for (std::size_t probes = 0; probes != table.capacity;) {
+                auto s = table.state[i].load(std::memory_order_acquire);
+                if (s == EMPTY) {
+                    if (!table.state[i].compare_exchange_strong(s, BUSY,
+                                                                std::memory_order_acq_rel)) {
+                        continue;  // re-examine the slot
+                    }
+                    table.keys[i] = key;
+                    table.values[i] = value;
+                    table.state[i].store(READY, std::memory_order_release);
+                    table.count.fetch_add(1, std::memory_order_relaxed);
+                    return std::make_pair(value, true);
+                }
+                if (s == BUSY) {
+                    wait();
+                    continue;
+                }
+                if (s == MOVED) return std::nullopt;
+                if (table.keys[i] == key) return std::make_pair(table.values[i], false);
+                i = (i + 1) & mask;
+                ++probes;
+            }
+            return std::nullopt;  // full
+        }
+
+        /**
+         * @brief Move one slot into the next table
+         *
+         */
+        static void migrate_slot(Table &table, std::size_t i, Table &next) {
+            for (;;) {
+                auto s = table.state[i].load(std::memory_order_acquire);
+                if (s == MOVED) return;
+                if (s == EMPTY) {
+                    if (table.state[i].compare_exchange_strong(s, MOVED,
+                                                               std::memory_order_acq_rel)) {
+                        return;
+                    }
+                    continue;
+                }
+                if (s == BUSY) {
+                    wait();
+                    continue;
+                }
+                const auto hash = CoordHash{}(table.keys[i]);
+                probe_insert(next, table.keys[i], hash, table.values[i]);
+                table.state[i].store(MOVED, std::memory_order_release);
+                return;
+            }
+        }
+
+        /**
+         * @brief Attach a table of twice the capacity, unless one is attached
+         *
+         */
+        void start_resize(Table &table) {
+            if (table.next.load(std::memory_order_acquire) != nullptr) return;
+            auto bigger = std::make_unique<Table>(2 * table.capacity);
+            Table *expected = nullptr;
+            if (table.next.compare_exchange_strong(expected, bigger.get(),
+                                                   std::memory_order_acq_rel)) {
+                std::lock_guard<std::mutex> lock(this->_tables_mutex);
+                this->_tables.push_back(std::move(bigger));
+            }
+        }
+
+        /**
+         * @brief Migrate chunks until none are left, then wait for the others
+         *
+         */
+        void help_migrate(Table &table) {
+            auto *next = table.next.load(std::memory_order_acquire);
+            if (next == nullptr) return;
+            const auto chunks = table.chunks();
+            for (;;) {
+                const auto c = table.next_chunk.fetch_add(1, std::memory_order_relaxed);
+                if (c >= chunks) break;
+                const auto end = std::min(table.capacity, (c + 1) * CHUNK);
+                for (auto i = c * CHUNK; i != end; ++i) migrate_slot(table, i, *next);
+                table.done_chunks.fetch_add(1, std::memory_order_acq_rel);
+            }
+            while (table.done_chunks.load(std::memory_order_acquire) < chunks) wait();
+            auto *expected = &table;
+            this->_current.compare_exchange_strong(expected, next, std::memory_order_acq_rel);
+        }
+
+      public:
+        /**
+         * @brief Construct a new Concurrent Coord Map object
+         *
+         * @param[in] capacity initial number of slots (rounded up to a power of two)
+         */
+        explicit ConcurrentCoordMap(std::size_t capacity = 1024) {
+            auto cap = std::size_t{16};
+            while (cap < capacity) cap *= 2;
+            this->_tables.push_back(std::make_unique<Table>(cap));
+            this->_current.store(this->_tables.back().get(), std::memory_order_release);
+        }
+
+        ConcurrentCoordMap(const ConcurrentCoordMap &) = delete;
+        auto operator=(const ConcurrentCoordMap &) -> ConcurrentCoordMap & = delete;
+
+        /**
+         * @brief Insert unless an equal key is present
+         *
+         * @param[in] coord any representative (it is canonicalized)
+         * @param[in] value stored if the key is new
+         * @return std::pair<Value, bool> the stored value, and whether it was inserted
+         */
+        auto try_emplace(const Coord &coord, const Value &value) -> std::pair<Value, bool> {
+            const auto key = canonical_coord(coord);
+            const auto hash = CoordHash{}(key);
+            for (;;) {
+                auto *table = this->_current.load(std::memory_order_acquire);
+                if (table->next.load(std::memory_order_acquire) != nullptr) {
+                    this->help_migrate(*table);
+                    continue;
+                }
+                if (4 * table->count.load(std::memory_order_relaxed) >= 3 * table->capacity) {
+                    this->start_resize(*table);
+                    continue;
+                }
+                if (auto result = probe_insert(*table, key, hash, value)) return *result;
+                this->start_resize(*table);  // full, or a migration has begun
+            }
+        }
+
+        /**
+         * @brief Insert a point or line
+         *
+         * @tparam Object
+         * @param[in] obj
+         * @param[in] value
+         * @return std::pair<Value, bool>
+         */
+        template <class Object>
+        auto try_emplace_object(const Object &obj, const Value &value) -> std::pair<Value, bool> {
+            return this->try_emplace(obj.coord, value);
+        }
+
+        /**
+         * @brief Value stored for a key, if any
+         *
+         * @param[in] coord
+         * @return std::optional<Value>
+         */
+        auto find(const Coord &coord) -> std::optional<Value> {
+            const auto key = canonical_coord(coord);
+            const auto hash = CoordHash{}(key);
+            for (;;) {
+                auto *table = this->_current.load(std::memory_order_acquire);
+                const auto mask = table->capacity - 1;
+                auto i = hash & mask;
+                auto moved = false;
+                for (std::size_t probes = 0; probes != table->capacity;) {
+                    const auto s = table->state[i].load(std::memory_order_acquire);
+                    if (s == EMPTY) return std::nullopt;
+                    if (s == BUSY) {
+                        wait();
+                        continue;
+                    }
+                    if (s == MOVED) {
+                        moved = true;
+                        break;
+                    }
+                    if (table->keys[i] == key) return table->values[i];
+                    i = (i + 1) & mask;
+                    ++probes;
+                }
+                if (!moved) return std::nullopt;
+                this->help_migrate(*table);
+            }
+        }
+
+        /**
+         * @brief Number of keys (exact once writers have finished)
+         *
+         * @return std::size_t
+         */
+        auto size() const -> std::size_t {
+            return this->_current.load(std::memory_order_acquire)->count.load(
+                std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Current number of slots
+         *
+         * @return std::size_t
+         */
+        auto capacity() const -> std::size_t {
+            return this->_current.load(std::memory_order_acquire)->capacity;
+        }
+
+        /**
+         * @brief All entries, in slot order; call once writers have finished
+         *
+         * @return std::vector<std::pair<Coord, Value>>
+         */
+        auto entries() const -> std::vector<std::pair<Coord, Value>> {
+            const auto *table = this->_current.load(std::memory_order_acquire);
+            auto result = std::vector<std::pair<Coord, Value>>{};
+            result.reserve(table->count.load(std::memory_order_relaxed));
+            for (std::size_t i = 0; i != table->capacity; ++i) {
+                if (table->state[i].load(std::memory_order_acquire) == READY) {
+                    result.emplace_back(table->keys[i], table->values[i]);
+                }
+            }
+            return result;
+        }
+    };
+
+    /**
+     * @brief Concurrent set of canonical coordinates
+     *
+     */
+    class ConcurrentCoordSet {
+      private:
+        ConcurrentCoordMap<uint8_t> _map;
+
+      public:
+        using Coord = std::array<int64_t, 3>;
+
+        explicit ConcurrentCoordSet(std::size_t capacity = 1024) : _map{capacity} {}
+
+        /**
+         * @brief Insert a coordinate; true if no equal one was present
+         *
+         * @param[in] coord
+         * @return bool
+         */
+        auto insert(const Coord &coord) -> bool { return this->_map.try_emplace(coord, 0).second; }
+
+        /**
+         * @brief Insert a point or line; true if no equal one was present
+         *
+         * @tparam Object
+         * @param[in] obj
+         * @return bool
+         */
+        template <class Object> auto insert_object(const Object &obj) -> bool {
+            return this->insert(obj.coord);
+        }
+
+        auto contains(const Coord &coord) -> bool { return this->_map.find(coord).has_value(); }
+
+        auto size() const -> std::size_t { return this->_map.size(); }
+
+        /**
+         * @brief Canonical keys, in slot order; call once writers have finished
+         *
+         * @return std::vector<Coord>
+         */
+        auto keys() const -> std::vector<Coord> {
+            auto result = std::vector<Coord>{};
+            for (const auto &entry : this->_map.entries()) result.push_back(entry.first);
+            return result;
+        }
+    };
+
+    /**
+     * @brief Per-thread maps merged at the end
+     *
+     * `local()` returns the calling thread's shard, created on first use; it
+     * must not be called once `merge` has started.
+     *
+     * @tparam Value
+     */
+    template <class Value> class ShardedCoordMap {
+      public:
+        using Coord = std::array<int64_t, 3>;
+        using Shard = std::unordered_map<Coord, Value, CoordHash>;
+
+      private:
+        static auto next_id() -> uint64_t {
+            static std::atomic<uint64_t> counter{0};
+            return counter.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        uint64_t _id{next_id()};  // distinguishes instances in the thread-local cache
+        std::mutex _mutex;
+        std::vector<std::unique_ptr<Shard>> _shards;
+
+      public:
+        ShardedCoordMap() = default;
+        ShardedCoordMap(const ShardedCoordMap &) = delete;
+        auto operator=(const ShardedCoordMap &) -> ShardedCoordMap & = delete;
+
+        /**
+         * @brief The calling thread's shard
+         *
+         * @return Shard&
+         */
+        auto local() -> Shard & {
+            thread_local std::unordered_map<uint64_t, Shard *> cache;
+            const auto it = cache.find(this->_id);
+            if (it != cache.end()) return *it->second;
+            std::lock_guard<std::mutex> lock(this->_mutex);
+            this->_shards.push_back(std::make_unique<Shard>());
+            return *(cache[this->_id] = this->_shards.back().get());
+        }
+
+        /**
+         * @brief Insert into the calling thread's shard
+         *
+         * @param[in] coord any representative
+         * @param[in] value
+         * @return bool whether the key is new to this shard
+         */
+        auto try_emplace(const Coord &coord, const Value &value) -> bool {
+            return this->local().try_emplace(canonical_coord(coord), value).second;
+        }
+
+        /**
+         * @brief Merge the shards, sorted by key
+         *
+         * Each shard is scattered once into per-partition buckets by key
+         * hash, in parallel over shards; then each partition is deduplicated
+         * in parallel. When shards disagree, the value of the earliest
+         * created shard wins.
+         *
+         * @return std::vector<std::pair<Coord, Value>>
+         */
+        auto merge() -> std::vector<std::pair<Coord, Value>> {
+            using Entry = const typename Shard::value_type *;
+            const auto parts = std::max<std::size_t>(1, 4 * num_workers());
+            const auto shards = this->_shards.size();
+            auto buckets = std::vector<std::vector<Entry>>(shards * parts);
+            parallel_for(shards, 1, [&](std::size_t begin, std::size_t end) {
+                for (auto s = begin; s != end; ++s) {
+                    for (const auto &entry : *this->_shards[s]) {
+                        buckets[s * parts + CoordHash{}(entry.first) % parts].push_back(&entry);
+                    }
+                }
+            });
+            auto merged = std::vector<std::vector<std::pair<Coord, Value>>>(parts);
+            parallel_for(parts, 1, [&](std::size_t begin, std::size_t end) {
+                for (auto p = begin; p != end; ++p) {
+                    auto size = std::size_t{0};
+                    for (std::size_t s = 0; s != shards; ++s) size += buckets[s * parts + p].size();
+                    auto part = Shard{};
+                    part.reserve(size);
+                    for (std::size_t s = 0; s != shards; ++s) {
+                        for (const auto *entry : buckets[s * parts + p]) part.emplace(*entry);
+                    }
+                    merged[p].assign(part.begin(), part.end());
+                }
+            });
+            auto result = std::vector<std::pair<Coord, Value>>{};
+            for (auto &part : merged) result.insert(result.end(), part.begin(), part.end());
+            std::sort(result.begin(), result.end(),
+                      [](const auto &a, const auto &b) { return a.first < b.first; });
+            return result;
+        }
+    };
+
+}  // namespace fun
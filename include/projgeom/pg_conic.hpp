@@ -0,0 +1,369 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "pg_parallel.hpp"
+#include "pg_wide.hpp"
+
+/** @file include/pg_conic.hpp
+ *  This is a C++ Library header.
+ *
+ *  General conics x^T C x = 0 with C symmetric,
+ *
+ *      C = | a f e |
+ *          | f b d |     Q(x, y, z) = a x^2 + b y^2 + c z^2 + 2d yz + 2e zx + 2f xy.
+ *          | e d c |
+ *
+ *  Evaluations run in 128-bit arithmetic and results are reduced by their
+ *  gcd before being narrowed back to int64 (std::overflow_error if they do not
+ *  fit). Exactness needs |C| |x|^2 below 2^123 for `value`, and |C| |l|^2
+ *  below 2^60 for `intersect` and `tangents`.
+ */
+
+namespace fun {
+
+    /**
+     * @brief Conic with symmetric integer matrix
+     *
+     * @tparam Point
+     * @tparam Line
+     */
+    template <class Point, class Line = typename Point::Dual> class Conic {
+      public:
+        std::array<int64_t, 6> coef;  ///< a, b, c, d, e, f
+
+        /**
+         * @brief Construct a new Conic object
+         *
+         * @param[in] coef a, b, c, d, e, f
+         */
+        constexpr explicit Conic(const std::array<int64_t, 6> &coef) : coef{coef} {}
+
+        /**
+         * @brief C times a coordinate vector
+         *
+         * @param[in] v
+         * @return std::array<int128_t, 3>
+         */
+        auto apply(const std::array<int64_t, 3> &v) const -> std::array<int128_t, 3> {
+            const auto &[a, b, c, d, e, f] = this->coef;
+            return {mul_wide(a, v[0]) + mul_wide(f, v[1]) + mul_wide(e, v[2]),
+                    mul_wide(f, v[0]) + mul_wide(b, v[1]) + mul_wide(d, v[2]),
+                    mul_wide(e, v[0]) + mul_wide(d, v[1]) + mul_wide(c, v[2])};
+        }
+
+        /**
+         * @brief Bilinear form v^T C w
+         *
+         * @param[in] v
+         * @param[in] w
+         * @return int128_t
+         */
+        auto bilinear(const std::array<int64_t, 3> &v, const std::array<int64_t, 3> &w) const
+            -> int128_t {
+            const auto cw = this->apply(w);
+            return int128_t(v[0]) * cw[0] + int128_t(v[1]) * cw[1] + int128_t(v[2]) * cw[2];
+        }
+
+        /**
+         * @brief Quadratic form x^T C x
+         *
+         * @param[in] pt
+         * @return int128_t
+         */
+        auto value(const Point &pt) const -> int128_t {
+            return this->bilinear(pt.coord, pt.coord);
+        }
+
+        /**
+         * @brief Whether the point lies on the conic
+         *
+         * @param[in] pt
+         * @return true
+         * @return false
+         */
+        auto incident(const Point &pt) const -> bool { return this->value(pt) == int128_t(0); }
+
+        /**
+         * @brief Polar line C p (the tangent at p if p is on the conic)
+         *
+         * @param[in] pt
+         * @return Line
+         */
+        auto polar(const Point &pt) const -> Line {
+            return Line{narrow_reduced(this->apply(pt.coord))};
+        }
+
+        /**
+         * @brief Pole adj(C) l of a line
+         *
+         * @param[in] ln
+         * @return Point
+         */
+        auto pole(const Line &ln) const -> Point {
+            const auto &[a, b, c, d, e, f] = this->coef;
+            const auto &l = ln.coord;
+            const auto m00 = mul_wide(b, c) - mul_wide(d, d);
+            const auto m11 = mul_wide(a, c) - mul_wide(e, e);
+            const auto m22 = mul_wide(a, b) - mul_wide(f, f);
+            const auto m01 = mul_wide(d, e) - mul_wide(f, c);
+            const auto m02 = mul_wide(f, d) - mul_wide(b, e);
+            const auto m12 = mul_wide(f, e) - mul_wide(a, d);
+            return Point{narrow_reduced(std::array<int128_t, 3>{
+                m00 * int128_t(l[0]) + m01 * int128_t(l[1]) + m02 * int128_t(l[2]),
+                m01 * int128_t(l[0]) + m11 * int128_t(l[1]) + m12 * int128_t(l[2]),
+                m02 * int128_t(l[0]) + m12 * int128_t(l[1]) + m22 * int128_t(l[2])})};
+        }
+
+        /**
+         * @brief Rational intersection points with a line
+         *
+         * Returns two points, one (tangent line) or none (no rational or no
+         * real intersection, or a line contained in a degenerate conic).
+         *
+         * @param[in] ln
+         * @return std::vector<Point>
+         */
+        auto intersect(const Line &ln) const -> std::vector<Point> {
+            const auto &l = ln.coord;
+            // two points spanning the line
+            auto pa = std::array<int64_t, 3>{1, 0, 0};
+            auto pb = std::array<int64_t, 3>{0, 1, 0};
+            if (l[0] != 0) {
+                pa = {l[1], -l[0], 0};
+                pb = {l[2], 0, -l[0]};
+            } else if (l[1] != 0) {
+                pa = {1, 0, 0};
+                pb = {0, l[2], -l[1]};
+            }
+            const auto qa = this->bilinear(pa, pa);
+            const auto qb = this->bilinear(pb, pb);
+            const auto bab = this->bilinear(pa, pb);
+            const auto disc = bab * bab - qa * qb;
+            if (disc < int128_t(0)) return {};
+            const auto s = isqrt_wide(disc);
+            if (mul_wide(s, s) != disc) return {};
+
+            auto roots = std::vector<std::array<int128_t, 2>>{};  // (lambda, mu)
+            const auto zero = int128_t(0);
+            if (qa != zero) {
+                roots.push_back({-bab + int128_t(s), qa});
+                roots.push_back({-bab - int128_t(s), qa});
+            } else if (qb != zero) {
+                roots.push_back({qb, -bab + int128_t(s)});
+                roots.push_back({qb, -bab - int128_t(s)});
+            } else if (bab != zero) {
+                roots.push_back({int128_t(1), zero});
+                roots.push_back({zero, int128_t(1)});
+            } else {
+                return {};
+            }
+            if (s == 0) roots.pop_back();
+            auto result = std::vector<Point>{};
+            for (const auto &[lambda, mu] : roots) {
+                result.push_back(Point{narrow_reduced(std::array<int128_t, 3>{
+                    lambda * int128_t(pa[0]) + mu * int128_t(pb[0]),
+                    lambda * int128_t(pa[1]) + mu * int128_t(pb[1]),
+                    lambda * int128_t(pa[2]) + mu * int128_t(pb[2])})});
+            }
+            return result;
+        }
+
+        /**
+         * @brief Rational tangent lines through a point
+         *
+         * A point on the conic has one tangent (its polar). From a point off
+         * the conic the tangents touch where the polar meets the conic.
+         *
+         * @param[in] pt
+         * @return std::vector<Line>
+         */
+        auto tangents(const Point &pt) const -> std::vector<Line> {
+            if (this->incident(pt)) return {this->polar(pt)};
+            auto result = std::vector<Line>{};
+            for (const auto &touch : this->intersect(this->polar(pt))) {
+                result.push_back(
+                    Line{narrow_reduced(cross_wide(pt.coord, touch.coord))});
+            }
+            return result;
+        }
+
+        /**
+         * @brief Signs of Q at many points (SoA), -1, 0 or 1
+         *
+         * A vectorizable double pass decides every point whose value clearly
+         * exceeds the rounding bound; the rest are evaluated exactly.
+         *
+         * @param[in] x
+         * @param[in] y
+         * @param[in] z
+         * @param[in] count
+         * @param[out] out
+         * @param[in] grain points per chunk
+         */
+        void signs(const int64_t *x, const int64_t *y, const int64_t *z, std::size_t count,
+                   int8_t *out, std::size_t grain = 16384) const {
+            const auto a = static_cast<double>(this->coef[0]);
+            const auto b = static_cast<double>(this->coef[1]);
+            const auto c = static_cast<double>(this->coef[2]);
+            const auto d2 = 2 * static_cast<double>(this->coef[3]);
+            const auto e2 = 2 * static_cast<double>(this->coef[4]);
+            const auto f2 = 2 * static_cast<double>(this->coef[5]);
+            parallel_for(count, grain, [&](std::size_t begin, std::size_t end) {
+                for (auto i = begin; i != end; ++i) {
+                    const auto px = static_cast<double>(x[i]);
+                    const auto py = static_cast<double>(y[i]);
+                    const auto pz = static_cast<double>(z[i]);
+                    const auto t0 = a * px * px;
+                    const auto t1 = b * py * py;
+                    const auto t2 = c * pz * pz;
+                    const auto t3 = d2 * py * pz;
+                    const auto t4 = e2 * pz * px;
+                    const auto t5 = f2 * px * py;
+                    const auto v = t0 + t1 + t2 + t3 + t4 + t5;
+                    const auto tol = 4e-15
+                                     * (std::abs(t0) + std::abs(t1) + std::abs(t2) + std::abs(t3)
+                                        + std::abs(t4) + std::abs(t5));
+                    const auto sign = static_cast<int8_t>((v > tol) - (v < -tol));
+                    out[i] = std::abs(v) <= tol ? int8_t{2} : sign;  // 2: undecided
+                }
+                for (auto i = begin; i != end; ++i) {
+                    if (out[i] != 2) continue;
+                    out[i] = static_cast<int8_t>(
+                        sign_of(this->value(Point{std::array<int64_t, 3>{x[i], y[i], z[i]}})));
+                }
+            });
+        }
+
+        /**
+         * @brief Equal up to a non-zero scalar
+         *
+         */
+        friend auto operator==(const Conic &lhs, const Conic &rhs) -> bool {
+            for (std::size_t i = 0; i != 6; ++i) {
+                for (auto j = i + 1; j != 6; ++j) {
+                    if (mul_wide(lhs.coef[i], rhs.coef[j]) != mul_wide(lhs.coef[j], rhs.coef[i])) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        friend auto operator!=(const Conic &lhs, const Conic &rhs) -> bool {
+            return !(lhs == rhs);
+        }
+    };
+
+    /**
+     * @brief Conic through five points
+     *
+     * With line pairs C1 = (p1 p2)(p3 p4) and C2 = (p1 p3)(p2 p4), both through
+     * p1..p4, the conic is C2(p5) C1 - C1(p5) C2. Coefficients are reduced by
+     * their gcd, first non-zero positive. Exact for coordinates below 2^11.
+     *
+     * @tparam Point
+     * @param[in] pts
+     * @return Conic<Point>
+     * @exception std::invalid_argument if the five points do not determine a conic
+     */
+    template <class Point> auto conic_through(const std::array<Point, 5> &pts) -> Conic<Point> {
+        using Coord = std::array<int64_t, 3>;
+        // 2 (l.x)(m.x) as a symmetric matrix
+        auto pair = [](const Coord &l, const Coord &m) -> std::array<int128_t, 6> {
+            return {2 * mul_wide(l[0], m[0]), 2 * mul_wide(l[1], m[1]), 2 * mul_wide(l[2], m[2]),
+                    mul_wide(l[1], m[2]) + mul_wide(l[2], m[1]),
+                    mul_wide(l[0], m[2]) + mul_wide(l[2], m[0]),
+                    mul_wide(l[0], m[1]) + mul_wide(l[1], m[0])};
+        };
+        auto at = [&](const Coord &l, const Coord &m) {
+            return 2 * dot_wide(l, pts[4].coord) * dot_wide(m, pts[4].coord);
+        };
+        const auto l12 = pts[0].meet(pts[1]).coord;
+        const auto l34 = pts[2].meet(pts[3]).coord;
+        const auto l13 = pts[0].meet(pts[2]).coord;
+        const auto l24 = pts[1].meet(pts[3]).coord;
+        const auto c1 = pair(l12, l34);
+        const auto c2 = pair(l13, l24);
+        const auto lambda = at(l13, l24);
+        const auto mu = at(l12, l34);
+        auto coef = std::array<int128_t, 6>{};
+        for (std::size_t i = 0; i != 6; ++i) coef[i] = lambda * c1[i] - mu * c2[i];
+        const auto result = narrow_reduced(coef, true);
+        if (result == std::array<int64_t, 6>{}) {
+            throw std::invalid_argument("conic_through: points do not determine a conic");
+        }
+        return Conic<Point>{result};
+    }
+
+    /**
+     * @brief Many conics as structure-of-arrays, evaluated at one point
+     *
+     * @tparam Point
+     */
+    template <class Point> class ConicBatch {
+      private:
+        std::array<std::vector<int64_t>, 6> _coef;
+
+      public:
+        auto size() const -> std::size_t { return this->_coef[0].size(); }
+
+        void push_back(const Conic<Point> &conic) {
+            for (std::size_t k = 0; k != 6; ++k) this->_coef[k].push_back(conic.coef[k]);
+        }
+
+        auto operator[](std::size_t i) const -> Conic<Point> {
+            return Conic<Point>{{this->_coef[0][i], this->_coef[1][i], this->_coef[2][i],
+                                 this->_coef[3][i], this->_coef[4][i], this->_coef[5][i]}};
+        }
+
+        /**
+         * @brief Signs of every conic at one point, -1, 0 or 1
+         *
+         * @param[in] pt
+         * @param[out] out one entry per conic
+         * @param[in] grain conics per chunk
+         */
+        void signs(const Point &pt, int8_t *out, std::size_t grain = 16384) const {
+            const auto px = static_cast<double>(pt.coord[0]);
+            const auto py = static_cast<double>(pt.coord[1]);
+            const auto pz = static_cast<double>(pt.coord[2]);
+            // the monomials, so each conic costs a dot product of length 6
+            const auto m = std::array<double, 6>{px * px, py * py, pz * pz,
+                                                 2 * py * pz, 2 * pz * px, 2 * px * py};
+            const auto *ca = this->_coef[0].data();
+            const auto *cb = this->_coef[1].data();
+            const auto *cc = this->_coef[2].data();
+            const auto *cd = this->_coef[3].data();
+            const auto *ce = this->_coef[4].data();
+            const auto *cf = this->_coef[5].data();
+            parallel_for(this->size(), grain, [&](std::size_t begin, std::size_t end) {
+                for (auto i = begin; i != end; ++i) {
+                    const auto t0 = static_cast<double>(ca[i]) * m[0];
+                    const auto t1 = static_cast<double>(cb[i]) * m[1];
+                    const auto t2 = static_cast<double>(cc[i]) * m[2];
+                    const auto t3 = static_cast<double>(cd[i]) * m[3];
+                    const auto t4 = static_cast<double>(ce[i]) * m[4];
+                    const auto t5 = static_cast<double>(cf[i]) * m[5];
+                    const auto v = t0 + t1 + t2 + t3 + t4 + t5;
+                    const auto tol = 4e-15
+                                     * (std::abs(t0) + std::abs(t1) + std::abs(t2) + std::abs(t3)
+                                        + std::abs(t4) + std::abs(t5));
+                    const auto sign = static_cast<int8_t>((v > tol) - (v < -tol));
+                    out[i] = std::abs(v) <= tol ? int8_t{2} : sign;  // 2: undecided
+                }
+                for (auto i = begin; i != end; ++i) {
+                    if (out[i] == 2) out[i] = static_cast<int8_t>(sign_of((*this)[i].value(pt)));
+                }
+            });
+        }
+    };
+
+}  // namespace fun
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include "pg_conic.hpp"
+#include "pg_parallel.hpp"
+
+/** @file include/pg_conic_param.hpp
+ *  This is a C++ Library header.
+ *
+ *  Rational points of a conic from one known rational point P0: the line
+ *  through P0 and R meets the conic again at Q(R) P0 - 2 B(P0, R) R. Letting
+ *  R = s U + t V run over a line not through P0 reaches every rational point
+ *  exactly once (P0 itself comes from the tangent direction). For the unit
+ *  circle with P0 = (-1, 0, 1) this is uc_point(t, s).
+ */
+
+namespace fun {
+
+    /**
+     * @brief Height of a homogeneous coordinate, max |x_i|
+     *
+     * @param[in] coord
+     * @return int64_t
+     */
+    inline auto height(const std::array<int64_t, 3> &coord) -> int64_t {
+        return std::max({std::abs(coord[0]), std::abs(coord[1]), std::abs(coord[2])});
+    }
+
+    /**
+     * @brief Rational parametrization of a conic through a known point
+     *
+     * @tparam Point
+     */
+    template <class Point> class ConicParametrization {
+      private:
+        Conic<Point> _conic;
+        Point _base;
+        std::array<int64_t, 3> _u{};  // U, V span a coordinate line missing P0
+        std::array<int64_t, 3> _v{};
+
+        static auto by_height(const Point &p, const Point &q) -> bool {
+            const auto hp = height(p.coord);
+            const auto hq = height(q.coord);
+            return hp != hq ? hp < hq : p.coord < q.coord;
+        }
+
+      public:
+        /**
+         * @brief Construct a new Conic Parametrization object
+         *
+         * @param[in] conic
+         * @param[in] base rational point on the conic
+         * @exception std::invalid_argument if `base` is not on the conic
+         */
+        ConicParametrization(const Conic<Point> &conic, const Point &base)
+            : _conic{conic}, _base{base} {
+            if (!conic.incident(base)) {
+                throw std::invalid_argument("ConicParametrization: base point not on the conic");
+            }
+            // the line x_k = 0 misses P0 when its k-th coordinate is the largest
+            std::size_t k = 0;
+            for (std::size_t i = 1; i != 3; ++i) {
+                if (std::abs(base.coord[i]) > std::abs(base.coord[k])) k = i;
+            }
+            this->_u[(k + 1) % 3] = 1;
+            this->_v[(k + 2) % 3] = 1;
+        }
+
+        auto base() const -> const Point & { return this->_base; }
+
+        /**
+         * @brief Second intersection of the conic with the line P0 R(s, t)
+         *
+         * @param[in] s
+         * @param[in] t
+         * @return Point canonical
+         */
+        auto point(int64_t s, int64_t t) const -> Point {
+            auto r = std::array<int64_t, 3>{};
+            for (std::size_t i = 0; i != 3; ++i) r[i] = s * this->_u[i] + t * this->_v[i];
+            const auto q = this->_conic.bilinear(r, r);
+            const auto b2 = 2 * this->_conic.bilinear(this->_base.coord, r);
+            auto p = std::array<int128_t, 3>{};
+            for (std::size_t i = 0; i != 3; ++i) {
+                p[i] = q * int128_t(this->_base.coord[i]) - b2 * int128_t(r[i]);
+            }
+            return Point{narrow_reduced(p)};
+        }
+
+        /**
+         * @brief Points for parameters t in [t_begin, t_end), |s| <= max_param
+         *
+         * Each projective parameter is visited once: (s, t) coprime with
+         * t > 0, plus (1, 0). Unsorted; use it to split work across jobs.
+         *
+         * @param[in] t_begin
+         * @param[in] t_end
+         * @param[in] max_param
+         * @return std::vector<Point>
+         */
+        auto enumerate_range(int64_t t_begin, int64_t t_end, int64_t max_param) const
+            -> std::vector<Point> {
+            auto result = std::vector<Point>{};
+            for (auto t = std::max<int64_t>(t_begin, 0); t < t_end; ++t) {
+                if (t == 0) {
+                    result.push_back(this->point(1, 0));
+                    continue;
+                }
+                for (auto s = -max_param; s <= max_param; ++s) {
+                    if (std::gcd(s, t) == 1) result.push_back(this->point(s, t));
+                }
+            }
+            return result;
+        }
+
+        /**
+         * @brief Distinct points for parameters of height up to `max_param`
+         *
+         * Parameter rows are split across threads; the result is sorted by
+         * point height, then coordinates.
+         *
+         * @param[in] max_param
+         * @param[in] grain rows of t per chunk
+         * @return std::vector<Point>
+         */
+        auto enumerate(int64_t max_param, std::size_t grain = 4) const -> std::vector<Point> {
+            const auto rows = static_cast<std::size_t>(std::max<int64_t>(max_param, 0) + 1);
+            auto parts = std::vector<std::vector<Point>>(rows);
+            parallel_for(rows, grain, [&](std::size_t begin, std::size_t end) {
+                for (auto t = begin; t != end; ++t) {
+                    const auto row = static_cast<int64_t>(t);
+                    parts[t] = this->enumerate_range(row, row + 1, max_param);
+                }
+            });
+            auto result = std::vector<Point>{};
+            for (auto &part : parts) result.insert(result.end(), part.begin(), part.end());
+            std::sort(result.begin(), result.end(), by_height);
+            result.erase(std::unique(result.begin(), result.end(),
+                                     [](const Point &p, const Point &q) {
+                                         return p.coord == q.coord;
+                                     }),
+                         result.end());
+            return result;
+        }
+    };
+
+}  // namespace fun
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <future>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "pg_binary_io.hpp"
+#include "pg_canonical.hpp"
+#include "pg_trace.hpp"
+
+/** @file include/pg_external_dedup.hpp
+ *  This is a C++ Library header.
+ *
+ *  Out-of-core deduplication and grouping of (point, line id) records, e.g.
+ *  the intersection candidates of a large arrangement. Records are
+ *  canonicalized and hash-partitioned into spill files in the binary
+ *  coordinate format; since equal points always land in the same
+ *  partition, each partition can then be sorted and grouped on its own.
+ *
+ *  Memory is bounded by the options: two buffers of `buffer_records`
+ *  records per partition while spilling (one filling, one being written in
+ *  the background), and two partitions while grouping (one being grouped,
+ *  the next being read in the background). Choose `partitions` so that
+ *  total records / partitions fit in memory.
+ */
+
+namespace fun {
+
+    /**
+     * @brief Settings of the external grouper
+     *
+     */
+    struct ExternalGroupOptions {
+        std::string spill_dir = ".";            ///< directory for the spill files
+        std::size_t partitions = 64;            ///< spill files
+        std::size_t buffer_records = 1U << 15;  ///< records per partition buffer
+
+        /**
+         * @brief Buffer size for a memory budget (bytes) while spilling
+         *
+         * @param[in] bytes
+         * @return ExternalGroupOptions&
+         */
+        auto with_spill_budget(std::size_t bytes) -> ExternalGroupOptions & {
+            const auto per_record = 2 * this->partitions * sizeof(IncidenceRecord);
+            this->buffer_records = std::max<std::size_t>(1, bytes / per_record);
+            return *this;
+        }
+    };
+
+    /**
+     * @brief Hash-partitioned external grouping of points with line ids
+     *
+     * `add` is meant for a single producer thread; run one grouper per
+     * producer (with distinct spill directories) when feeding in parallel.
+     *
+     */
+    class ExternalGrouper {
+      public:
+        using Coord = std::array<int64_t, 3>;
+
+      private:
+        struct Partition {
+            std::string path;
+            RecordWriter<IncidenceRecord> writer;
+            std::vector<IncidenceRecord> active;
+            std::vector<IncidenceRecord> pending;  // being written by `inflight`
+            std::future<void> inflight;
+        };
+
+        ExternalGroupOptions _options;
+        uint64_t _salt{std::random_device{}()};  // keeps spill names unique across processes
+        std::vector<Partition> _partitions;
+        uint64_t _records{0};
+        bool _finished{false};
+
+        /**
+         * @brief Hand the active buffer to a background write
+         *
+         */
+        static void flush(Partition &part) {
+            if (part.inflight.valid()) part.inflight.get();  // the spare buffer is free again
+            part.pending.swap(part.active);
+            part.active.clear();
+            if (part.pending.empty()) return;
+            part.inflight = std::async(std::launch::async,
+                                       [&part]() { part.writer.write(part.pending); });
+        }
+
+        void close_all() {
+            for (auto &part : this->_partitions) {
+                flush(part);
+                if (part.inflight.valid()) part.inflight.get();
+                part.writer.close();
+            }
+        }
+
+      public:
+        /**
+         * @brief Create the spill files
+         *
+         * @param[in] options
+         */
+        explicit ExternalGrouper(ExternalGroupOptions options) : _options{std::move(options)} {
+            this->_options.partitions = std::max<std::size_t>(1, this->_options.partitions);
+            this->_options.buffer_records = std::max<std::size_t>(1, this->_options.buffer_records);
+            this->_partitions.reserve(this->_options.partitions);
+            for (std::size_t p = 0; p != this->_options.partitions; ++p) {
+                auto path = this->_options.spill_dir + "/pg_spill_" + std::to_string(this->_salt)
+                            + "_" + std::to_string(reinterpret_cast<std::uintptr_t>(this)) + "_"
+                            + std::to_string(p) + ".bin";
+                auto writer = RecordWriter<IncidenceRecord>(path, RecordKind::Incidences);
+                this->_partitions.push_back(Partition{std::move(path), std::move(writer), {}, {},
+                                                      {}});
+                this->_partitions.back().active.reserve(this->_options.buffer_records);
+                this->_partitions.back().pending.reserve(this->_options.buffer_records);
+            }
+        }
+
+        ExternalGrouper(const ExternalGrouper &) = delete;
+        auto operator=(const ExternalGrouper &) -> ExternalGrouper & = delete;
+
+        ~ExternalGrouper() {
+            try {
+                if (!this->_finished) this->close_all();
+            } catch (...) {  // NOLINT(bugprone-empty-catch)
+            }
+            for (const auto &part : this->_partitions) std::remove(part.path.c_str());
+        }
+
+        /**
+         * @brief Add a point (any representative) with an incident line id
+         *
+         * @param[in] coord
+         * @param[in] line
+         */
+        void add(const Coord &coord, uint64_t line) {
+            const auto key = canonical_coord(coord);
+            auto &part = this->_partitions[CoordHash{}(key) % this->_partitions.size()];
+            part.active.push_back(IncidenceRecord{key, line});
+            ++this->_records;
+            if (part.active.size() >= this->_options.buffer_records) flush(part);
+        }
+
+        /**
+         * @brief Records added so far
+         *
+         * @return uint64_t
+         */
+        auto records() const -> uint64_t { return this->_records; }
+
+        /**
+         * @brief Group the records; call once
+         *
+         * Partitions are processed in order, each sorted by (point, line);
+         * the sink receives every distinct point once, with its distinct line
+         * ids ascending. Points are sorted within a partition only.
+         *
+         * @tparam Sink callable as sink(const Coord &, const std::vector<uint64_t> &)
+         * @param[in] sink
+         * @return std::size_t number of distinct points
+         */
+        template <class Sink> auto finish(Sink &&sink) -> std::size_t {
+            this->close_all();
+            this->_finished = true;
+            auto load = [this](std::size_t p) {
+                return RecordReader<IncidenceRecord>(this->_partitions[p].path,
+                                                     RecordKind::Incidences)
+                    .read_all();
+            };
+            auto distinct = std::size_t{0};
+            auto next = std::async(std::launch::async, load, 0);
+            auto lines = std::vector<uint64_t>{};
+            for (std::size_t p = 0; p != this->_partitions.size(); ++p) {
+                PG_TRACE_CHUNK("external_group", "partition", p);
+                auto records = next.get();
+                if (p + 1 != this->_partitions.size()) {
+                    next = std::async(std::launch::async, load, p + 1);
+                }
+                std::sort(records.begin(), records.end());
+                for (std::size_t lo = 0, hi = 0; lo != records.size(); lo = hi) {
+                    lines.clear();
+                    while (hi != records.size() && records[hi].coord == records[lo].coord) {
+                        if (lines.empty() || lines.back() != records[hi].line) {
+                            lines.push_back(records[hi].line);
+                        }
+                        ++hi;
+                    }
+                    sink(records[lo].coord, lines);
+                    ++distinct;
+                }
+            }
+            return distinct;
+        }
+    };
+
+}  // namespace fun
@@ -0,0 +1,361 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "pg_canonical.hpp"
+#include "pg_parallel.hpp"
+
+/** @file include/pg_hough.hpp
+ *  This is a C++ Library header.
+ *
+ *  Hough accumulator over the dual plane: finds points where many lines meet.
+ *  A homogeneous point is a direction up to sign, binned on three faces of a
+ *  cube (face k holds the directions whose k-th component is largest in
+ *  magnitude, antipodes identified), so points at infinity need no special
+ *  case and memory is 3 R^2 counters. Each line is a great circle and is
+ *  rasterized across the faces. Affine data should be brought to unit size
+ *  by the `scale` parameter (e.g. the image half-diagonal), otherwise all
+ *  far points crowd the line at infinity. Peaks are refined to exact `meet`
+ *  points; line coordinates must stay below 2^19.
+ */
+
+namespace fun {
+
+    /**
+     * @brief A concurrency point and the lines through it
+     *
+     * @tparam Point
+     */
+    template <class Point> struct HoughPeak {
+        Point point;
+        std::size_t votes;               ///< accumulator count at the peak bin
+        std::vector<std::size_t> lines;  ///< indices of lines exactly incident
+    };
+
+    /**
+     * @brief Cube-map Hough accumulator for concurrent lines
+     *
+     * @tparam Line
+     * @tparam Point
+     */
+    template <class Line, class Point = typename Line::Dual> class DualHough {
+      private:
+        std::size_t _res;
+        double _scale;
+        std::vector<uint32_t> _votes;                // 3 faces x res x res
+        std::vector<std::vector<uint32_t>> _local;   // per-worker, reused across frames
+
+        auto cell(double t) const -> std::size_t {
+            const auto res = static_cast<double>(this->_res);
+            const auto i = static_cast<std::ptrdiff_t>((t + 1) * 0.5 * res);
+            return static_cast<std::size_t>(
+                std::clamp<std::ptrdiff_t>(i, 0, static_cast<std::ptrdiff_t>(this->_res) - 1));
+        }
+
+        /**
+         * @brief Line coordinates acting on the scaled points (x, y, scale z)
+         *
+         */
+        auto scaled(const std::array<int64_t, 3> &ln) const -> std::array<double, 3> {
+            return {static_cast<double>(ln[0]) * this->_scale,
+                    static_cast<double>(ln[1]) * this->_scale, static_cast<double>(ln[2])};
+        }
+
+        /**
+         * @brief Add one line (as a great circle) to an accumulator
+         *
+         */
+        void rasterize(const std::array<int64_t, 3> &coord, uint32_t *acc) const {
+            const auto res = this->_res;
+            const auto step = 2.0 / static_cast<double>(res);
+            const auto ln = this->scaled(coord);
+            for (std::size_t k = 0; k != 3; ++k) {
+                // on face k the point is (.., 1 at k, ..) with u, v in [-1, 1]
+                const auto lk = ln[k];
+                const auto la = ln[(k + 1) % 3];
+                const auto lb = ln[(k + 2) % 3];
+                auto *face = acc + k * res * res;
+                if (la == 0 && lb == 0) continue;
+                // walk the axis along which the line is flatter: one cell per step
+                const auto flat_u = std::abs(lb) >= std::abs(la);
+                const auto p = flat_u ? la : lb;
+                const auto q = flat_u ? lb : la;
+                for (std::size_t i = 0; i != res; ++i) {
+                    const auto s = -1 + (static_cast<double>(i) + 0.5) * step;
+                    const auto t = -(lk + p * s) / q;
+                    if (t < -1 || t > 1) continue;
+                    const auto j = this->cell(t);
+                    const auto row = flat_u ? j : i;  // row indexes v, column indexes u
+                    const auto col = flat_u ? i : j;
+                    ++face[row * res + col];
+                }
+            }
+        }
+
+        /**
+         * @brief Unit direction at the centre of bin (face, row, col)
+         *
+         */
+        auto center(std::size_t face, std::size_t row, std::size_t col) const
+            -> std::array<double, 3> {
+            const auto step = 2.0 / static_cast<double>(this->_res);
+            auto d = std::array<double, 3>{};
+            d[face] = 1;
+            d[(face + 1) % 3] = -1 + (static_cast<double>(col) + 0.5) * step;
+            d[(face + 2) % 3] = -1 + (static_cast<double>(row) + 0.5) * step;
+            const auto n = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+            for (auto &x : d) x /= n;
+            return d;
+        }
+
+        /**
+         * @brief Exact concurrency point among the candidate lines
+         *
+         * Meets up to ANCHORS anchor lines with every other candidate and takes
+         * the canonical point that occurs most often (ties to the smallest).
+         * The anchors are the candidates of lowest coordinate hash, so the
+         * choice does not depend on the order of the lines yet behaves like a
+         * random sample: a point carried by a fraction f of the candidates is
+         * missed with probability about (1 - f)^48, below 0.05% for f = 15%.
+         */
+        static auto refine(const std::vector<Line> &lines, const std::vector<std::size_t> &cand)
+            -> std::pair<std::array<int64_t, 3>, std::size_t> {
+            constexpr std::size_t ANCHORS = 48;
+            auto ranked = std::vector<std::pair<std::size_t, std::size_t>>{};  // hash, candidate
+            ranked.reserve(cand.size());
+            for (const auto j : cand) {
+                ranked.emplace_back(CoordHash{}(canonical_coord(lines[j].coord)), j);
+            }
+            const auto anchors = std::min(ANCHORS, ranked.size());
+            std::partial_sort(ranked.begin(), ranked.begin() + static_cast<std::ptrdiff_t>(anchors),
+                              ranked.end(), [&](const auto &x, const auto &y) {
+                                  return x.first != y.first
+                                             ? x.first < y.first
+                                             : canonical_coord(lines[x.second].coord)
+                                                   < canonical_coord(lines[y.second].coord);
+                              });
+
+            auto best = std::array<int64_t, 3>{0, 0, 0};
+            std::size_t best_count = 0;
+            auto meets = std::vector<std::array<int64_t, 3>>{};
+            for (std::size_t a = 0; a != anchors; ++a) {
+                const auto &anchor = lines[ranked[a].second];
+                meets.clear();
+                for (const auto j : cand) {
+                    const auto p = anchor.meet(lines[j]).coord;
+                    if (p == std::array<int64_t, 3>{0, 0, 0}) continue;  // same line
+                    meets.push_back(canonical_coord(p));
+                }
+                std::sort(meets.begin(), meets.end());
+                for (std::size_t i = 0; i != meets.size();) {
+                    auto j = i;
+                    while (j != meets.size() && meets[j] == meets[i]) ++j;
+                    if (j - i > best_count || (j - i == best_count && meets[i] < best)) {
+                        best_count = j - i;
+                        best = meets[i];
+                    }
+                    i = j;
+                }
+            }
+            return {best, best_count};
+        }
+
+      public:
+        /**
+         * @brief Construct a new Dual Hough object
+         *
+         * @param[in] resolution bins per face side
+         * @param[in] scale affine distance mapped to one unit of the cube
+         */
+        explicit DualHough(std::size_t resolution = 64, double scale = 1.0)
+            : _res{std::max<std::size_t>(resolution, 2)},
+              _scale{scale},
+              _votes(3 * _res * _res, 0) {}
+
+        /**
+         * @brief Bins per face side
+         *
+         * @return std::size_t
+         */
+        auto resolution() const -> std::size_t { return this->_res; }
+
+        /**
+         * @brief Accumulator counts, face-major then row-major
+         *
+         * @return const std::vector<uint32_t>&
+         */
+        auto votes() const -> const std::vector<uint32_t> & { return this->_votes; }
+
+        /**
+         * @brief Bin index of a point
+         *
+         * @param[in] pt
+         * @return std::size_t
+         */
+        auto bin_of(const Point &pt) const -> std::size_t {
+            const auto c = std::array<double, 3>{static_cast<double>(pt.coord[0]),
+                                                 static_cast<double>(pt.coord[1]),
+                                                 static_cast<double>(pt.coord[2]) * this->_scale};
+            std::size_t k = 0;
+            for (std::size_t i = 1; i != 3; ++i) {
+                if (std::abs(c[i]) > std::abs(c[k])) k = i;
+            }
+            const auto u = c[(k + 1) % 3] / c[k];
+            const auto v = c[(k + 2) % 3] / c[k];
+            return (k * this->_res + this->cell(v)) * this->_res + this->cell(u);
+        }
+
+        /**
+         * @brief Reset all counts
+         *
+         */
+        void clear() { std::fill(this->_votes.begin(), this->_votes.end(), 0); }
+
+        /**
+         * @brief Add votes for a batch of lines, one private accumulator per worker
+         *
+         * @param[in] lines
+         */
+        void vote(const std::vector<Line> &lines) {
+            const auto bins = this->_votes.size();
+            const auto workers = std::max<std::size_t>(
+                1, std::min(num_workers(), lines.size() / 256));
+            this->_local.resize(workers);
+            parallel_for(workers, 1, [&](std::size_t begin, std::size_t end) {
+                for (auto w = begin; w != end; ++w) {
+                    auto &acc = this->_local[w];
+                    acc.assign(bins, 0);
+                    const auto lo = lines.size() * w / workers;
+                    const auto hi = lines.size() * (w + 1) / workers;
+                    for (auto i = lo; i != hi; ++i) this->rasterize(lines[i].coord, acc.data());
+                }
+            });
+            parallel_for(bins, 4096, [&](std::size_t begin, std::size_t end) {
+                for (const auto &acc : this->_local) {
+                    for (auto b = begin; b != end; ++b) this->_votes[b] += acc[b];
+                }
+            });
+        }
+
+        /**
+         * @brief Local maxima refined to exact points
+         *
+         * `lines` must be the lines that were voted. Each peak keeps the exact
+         * meet point supported by the most nearby lines, and reports every
+         * line incident to it.
+         *
+         * @param[in] lines
+         * @param[in] max_peaks
+         * @param[in] min_votes
+         * @return std::vector<HoughPeak<Point>>
+         */
+        auto peaks(const std::vector<Line> &lines, std::size_t max_peaks,
+                   std::size_t min_votes = 3) const -> std::vector<HoughPeak<Point>> {
+            const auto res = this->_res;
+            auto found = std::vector<std::pair<uint32_t, std::size_t>>{};
+            for (std::size_t f = 0; f != 3; ++f) {
+                for (std::size_t r = 0; r != res; ++r) {
+                    for (std::size_t c = 0; c != res; ++c) {
+                        const auto b = (f * res + r) * res + c;
+                        const auto v = this->_votes[b];
+                        if (v < min_votes) continue;
+                        auto is_max = true;
+                        for (auto dr = r == 0 ? 0 : r - 1; dr <= std::min(r + 1, res - 1); ++dr) {
+                            for (auto dc = c == 0 ? 0 : c - 1; dc <= std::min(c + 1, res - 1);
+                                 ++dc) {
+                                const auto nb = (f * res + dr) * res + dc;
+                                // ties go to the lower bin index
+                                if (this->_votes[nb] > v || (this->_votes[nb] == v && nb < b)) {
+                                    is_max = false;
+                                }
+                            }
+                        }
+                        if (is_max) found.emplace_back(v, b);
+                    }
+                }
+            }
+            std::sort(found.begin(), found.end(),
+                      [](const auto &x, const auto &y) {
+                          return x.first != y.first ? x.first > y.first : x.second < y.second;
+                      });
+            found.resize(std::min(found.size(), 2 * max_peaks));  // spare for merged peaks
+
+            // a line passes within ~1.5 bins of the bin centre
+            const auto tol = 3.0 / static_cast<double>(res);
+            const auto none = HoughPeak<Point>{Point{std::array<int64_t, 3>{0, 0, 0}}, 0, {}};
+            auto refined = std::vector<HoughPeak<Point>>(found.size(), none);
+            parallel_for(found.size(), 1, [&](std::size_t begin, std::size_t end) {
+                for (auto i = begin; i != end; ++i) {
+                    const auto b = found[i].second;
+                    const auto d = this->center(b / (res * res), b / res % res, b % res);
+                    auto cand = std::vector<std::size_t>{};
+                    for (std::size_t j = 0; j != lines.size(); ++j) {
+                        const auto l = this->scaled(lines[j].coord);
+                        const auto s = l[0] * d[0] + l[1] * d[1] + l[2] * d[2];
+                        const auto norm2 = l[0] * l[0] + l[1] * l[1] + l[2] * l[2];
+                        if (s * s <= tol * tol * norm2) cand.push_back(j);
+                    }
+                    const auto [pt, support] = refine(lines, cand);
+                    refined[i].votes = found[i].first;
+                    refined[i].point = Point{pt};
+                    if (support == 0) continue;
+                    for (std::size_t j = 0; j != lines.size(); ++j) {
+                        if (lines[j].incident(refined[i].point)) refined[i].lines.push_back(j);
+                    }
+                }
+            });
+
+            auto result = std::vector<HoughPeak<Point>>{};
+            for (auto &peak : refined) {
+                if (peak.lines.size() < std::max<std::size_t>(2, min_votes)) continue;
+                const auto dup = std::any_of(result.begin(), result.end(), [&](const auto &seen) {
+                    return seen.point == peak.point;
+                });
+                if (dup) continue;
+                result.push_back(std::move(peak));
+                if (result.size() == max_peaks) break;
+            }
+            return result;
+        }
+
+        /**
+         * @brief Clear, vote and return the peaks of one batch
+         *
+         * @param[in] lines
+         * @param[in] max_peaks
+         * @param[in] min_votes
+         * @return std::vector<HoughPeak<Point>>
+         */
+        auto detect(const std::vector<Line> &lines, std::size_t max_peaks,
+                    std::size_t min_votes = 3) -> std::vector<HoughPeak<Point>> {
+            this->clear();
+            this->vote(lines);
+            return this->peaks(lines, max_peaks, min_votes);
+        }
+    };
+
+    /**
+     * @brief Points where at least `min_lines` of the lines meet
+     *
+     * @tparam Line
+     * @param[in] lines
+     * @param[in] max_points
+     * @param[in] min_lines
+     * @param[in] resolution bins per cube face side
+     * @param[in] scale affine distance mapped to one unit of the cube
+     * @return std::vector<HoughPeak<typename Line::Dual>>
+     */
+    template <class Line>
+    auto concurrent_points(const std::vector<Line> &lines, std::size_t max_points,
+                           std::size_t min_lines = 3, std::size_t resolution = 64,
+                           double scale = 1.0) -> std::vector<HoughPeak<typename Line::Dual>> {
+        return DualHough<Line>(resolution, scale).detect(lines, max_points, min_lines);
+    }
+
+}  // namespace fun
@@ -0,0 +1,378 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <numeric>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "pg_canonical.hpp"
+#include "pg_parallel.hpp"
+#include "pg_trace.hpp"
+#include "pg_wide.hpp"
+
+/** @file include/pg_incidence_join.hpp
+ *  This is a C++ Library header.
+ *
+ *  All incident (point, line) pairs between two sets. Lines are grouped by
+ *  canonical direction; a class with normal (a, b) is sorted by its offset
+ *  o, the value of a X + b Y on its lines at affine points (X, Y). Points
+ *  are sorted along a Z-order curve and cut into tiles (`PointTiles`, which
+ *  can be built once and joined against many line sets), and the bounding box
+ *  of a tile bounds a X + b Y to an interval, so a binary search yields the
+ *  only lines of the class that can pass through the tile. Candidates are
+ *  then checked exactly against all points of the tile in a vectorized loop
+ *  (wrapping 64-bit dot products, proven exact by a bound on the terms, with
+ *  `dot_wide` beyond that).
+ *
+ *  Points at infinity lie on the lines of their own direction and on the
+ *  line at infinity; they are matched by hashing instead.
+ */
+
+namespace fun {
+
+    /**
+     * @brief An incident pair, by index into the point and line sets
+     *
+     */
+    struct IncidencePair {
+        std::size_t point;
+        std::size_t line;
+
+        auto operator==(const IncidencePair &other) const -> bool {
+            return this->point == other.point && this->line == other.line;
+        }
+
+        auto operator<(const IncidencePair &other) const -> bool {
+            return this->point != other.point ? this->point < other.point
+                                              : this->line < other.line;
+        }
+    };
+
+    template <class Point, class Line> class IncidenceJoin;
+
+    /**
+     * @brief Points of an incidence join, Z-ordered and cut into tiles
+     *
+     * Depends only on the points, so one tiling serves any number of line
+     * sets (e.g. one per query batch).
+     *
+     * @tparam Point
+     */
+    template <class Point> class PointTiles {
+      private:
+        // affine points in structure-of-arrays form, in Z-order
+        std::vector<std::size_t> _ids;
+        std::vector<int64_t> _x, _y, _z;
+        std::vector<double> _mx, _my, _mz;          // |x|, |y|, |z|
+        std::vector<std::array<double, 4>> _box;  // per tile: X min, X max, Y min, Y max
+        std::size_t _tile;
+        std::vector<std::pair<std::size_t, std::array<int64_t, 3>>> _at_infinity;
+
+        template <class, class> friend class IncidenceJoin;
+
+        /**
+         * @brief Z-order key of a point quantized to a 2^16 x 2^16 grid
+         *
+         */
+        static auto morton(double u, double v) -> uint32_t {
+            auto spread = [](uint32_t w) {
+                w &= 0xFFFF;
+                w = (w | (w << 8)) & 0x00FF00FF;
+                w = (w | (w << 4)) & 0x0F0F0F0F;
+                w = (w | (w << 2)) & 0x33333333;
+                w = (w | (w << 1)) & 0x55555555;
+                return w;
+            };
+            const auto qu = static_cast<uint32_t>(std::clamp(u, 0.0, 1.0) * 65535.0);
+            const auto qv = static_cast<uint32_t>(std::clamp(v, 0.0, 1.0) * 65535.0);
+            return spread(qu) | (spread(qv) << 1);
+        }
+
+      public:
+        /**
+         * @brief Sort and tile a set of points
+         *
+         * @param[in] points
+         * @param[in] tile points per tile
+         */
+        explicit PointTiles(const std::vector<Point> &points, std::size_t tile = 256)
+            : _tile{std::max<std::size_t>(tile, 1)} {
+            auto affine = std::vector<std::size_t>{};
+            auto ax = std::vector<double>(points.size());
+            auto ay = std::vector<double>(points.size());
+            auto lo = std::array<double, 2>{HUGE_VAL, HUGE_VAL};
+            auto hi = std::array<double, 2>{-HUGE_VAL, -HUGE_VAL};
+            for (std::size_t i = 0; i != points.size(); ++i) {
+                const auto &c = points[i].coord;
+                if (c[2] == 0) {
+                    if (c[0] != 0 || c[1] != 0) this->_at_infinity.emplace_back(i, c);
+                    continue;
+                }
+                affine.push_back(i);
+                ax[i] = static_cast<double>(c[0]) / static_cast<double>(c[2]);
+                ay[i] = static_cast<double>(c[1]) / static_cast<double>(c[2]);
+                lo = {std::min(lo[0], ax[i]), std::min(lo[1], ay[i])};
+                hi = {std::max(hi[0], ax[i]), std::max(hi[1], ay[i])};
+            }
+            const auto wx = hi[0] > lo[0] ? hi[0] - lo[0] : 1.0;
+            const auto wy = hi[1] > lo[1] ? hi[1] - lo[1] : 1.0;
+            auto keys = std::vector<std::pair<uint32_t, std::size_t>>{};
+            keys.reserve(affine.size());
+            for (const auto i : affine) {
+                keys.emplace_back(morton((ax[i] - lo[0]) / wx, (ay[i] - lo[1]) / wy), i);
+            }
+            std::sort(keys.begin(), keys.end());
+
+            const auto n = keys.size();
+            this->_ids.resize(n);
+            this->_x.resize(n);
+            this->_y.resize(n);
+            this->_z.resize(n);
+            this->_mx.resize(n);
+            this->_my.resize(n);
+            this->_mz.resize(n);
+            for (std::size_t k = 0; k != n; ++k) {
+                const auto i = keys[k].second;
+                const auto &c = points[i].coord;
+                this->_ids[k] = i;
+                this->_x[k] = c[0];
+                this->_y[k] = c[1];
+                this->_z[k] = c[2];
+                this->_mx[k] = std::fabs(static_cast<double>(c[0]));
+                this->_my[k] = std::fabs(static_cast<double>(c[1]));
+                this->_mz[k] = std::fabs(static_cast<double>(c[2]));
+            }
+            for (std::size_t begin = 0; begin < n; begin += this->_tile) {
+                auto box = std::array<double, 4>{HUGE_VAL, -HUGE_VAL, HUGE_VAL, -HUGE_VAL};
+                for (auto k = begin; k != std::min(n, begin + this->_tile); ++k) {
+                    const auto i = this->_ids[k];
+                    box = {std::min(box[0], ax[i]), std::max(box[1], ax[i]),
+                           std::min(box[2], ay[i]), std::max(box[3], ay[i])};
+                }
+                this->_box.push_back(box);
+            }
+        }
+
+        /**
+         * @brief Number of tiles
+         *
+         * @return std::size_t
+         */
+        auto tiles() const -> std::size_t { return this->_box.size(); }
+    };
+
+    /**
+     * @brief Incidence join against a fixed set of lines
+     *
+     * @tparam Point
+     * @tparam Line
+     */
+    template <class Point, class Line = typename Point::Dual> class IncidenceJoin {
+      public:
+        using Coord = std::array<int64_t, 3>;
+
+      private:
+        struct DirectionClass {
+            int64_t a;           // normal, canonical up to sign
+            int64_t b;
+            std::size_t begin;   // lines _order[begin, end), ascending offset
+            std::size_t end;
+        };
+
+        std::vector<Line> _lines;
+        std::vector<DirectionClass> _classes;
+        std::vector<std::size_t> _order;
+        std::vector<double> _offset;             // parallel to _order
+        std::unordered_map<Coord, std::size_t, CoordHash> _class_of_key;
+        std::vector<std::size_t> _at_infinity;  // lines (0, 0, c)
+
+        static constexpr double SAFE = 4611686018427387904.0;  // 2^62
+        static constexpr double SLACK = 1e-9;  // interval widening per unit of |a X| + |b Y|
+
+        /**
+         * @brief Pairs between the points of tile t and the lines
+         *
+         */
+        void join_tile(const PointTiles<Point> &tiles, std::size_t t, std::vector<uint8_t> &hit,
+                       std::vector<IncidencePair> &out) const {
+            const auto k_begin = t * tiles._tile;
+            const auto count = std::min(tiles._ids.size(), k_begin + tiles._tile) - k_begin;
+            const auto &[x_lo, x_hi, y_lo, y_hi] = tiles._box[t];
+            const auto *px = tiles._x.data() + k_begin;
+            const auto *py = tiles._y.data() + k_begin;
+            const auto *pz = tiles._z.data() + k_begin;
+            const auto *mx = tiles._mx.data() + k_begin;
+            const auto *my = tiles._my.data() + k_begin;
+            const auto *mz = tiles._mz.data() + k_begin;
+            for (const auto &cls : this->_classes) {
+                // interval of a X + b Y over the bounding box
+                const auto a = static_cast<double>(cls.a);
+                const auto b = static_cast<double>(cls.b);
+                const auto lo = (a > 0 ? a * x_lo : a * x_hi) + (b > 0 ? b * y_lo : b * y_hi);
+                const auto hi = (a > 0 ? a * x_hi : a * x_lo) + (b > 0 ? b * y_hi : b * y_lo);
+                // the rounding of X, Y and the offsets scales with the terms, not their sum
+                const auto terms = std::fabs(a) * std::max(std::fabs(x_lo), std::fabs(x_hi))
+                                   + std::fabs(b) * std::max(std::fabs(y_lo), std::fabs(y_hi));
+                const auto slack = SLACK * (terms + 1.0);
+                const auto first = this->_offset.begin() + static_cast<std::ptrdiff_t>(cls.begin);
+                const auto last = this->_offset.begin() + static_cast<std::ptrdiff_t>(cls.end);
+                const auto from = std::lower_bound(first, last, lo - slack);
+                const auto to = std::upper_bound(from, last, hi + slack);
+                const auto pos = static_cast<std::size_t>(from - this->_offset.begin());
+                const auto stop = static_cast<std::size_t>(to - this->_offset.begin());
+                for (auto r = pos; r != stop; ++r) {
+                    const auto j = this->_order[r];
+                    const auto &l = this->_lines[j].coord;
+                    const auto l0 = static_cast<uint64_t>(l[0]);
+                    const auto l1 = static_cast<uint64_t>(l[1]);
+                    const auto l2 = static_cast<uint64_t>(l[2]);
+                    const auto m0 = std::fabs(static_cast<double>(l[0]));
+                    const auto m1 = std::fabs(static_cast<double>(l[1]));
+                    const auto m2 = std::fabs(static_cast<double>(l[2]));
+                    auto any = uint8_t{0};
+                    for (std::size_t k = 0; k != count; ++k) {
+                        const auto wrapped = static_cast<uint64_t>(px[k]) * l0
+                                             + static_cast<uint64_t>(py[k]) * l1
+                                             + static_cast<uint64_t>(pz[k]) * l2;
+                        const auto mag = mx[k] * m0 + my[k] * m1 + mz[k] * m2;
+                        // 1: incident, 2: needs the exact check
+                        hit[k] = static_cast<uint8_t>((wrapped == 0) | ((mag >= SAFE) << 1));
+                        any |= hit[k];
+                    }
+                    if (any == 0) continue;
+                    for (std::size_t k = 0; k != count; ++k) {
+                        if (hit[k] == 0) continue;
+                        if (hit[k] >= 2) {
+                            const auto p = Coord{px[k], py[k], pz[k]};
+                            if (dot_wide(p, l) != int128_t(0)) continue;
+                        }
+                        out.push_back(IncidencePair{tiles._ids[k_begin + k], j});
+                    }
+                }
+            }
+        }
+
+      public:
+        /**
+         * @brief Index a set of lines
+         *
+         * @param[in] lines
+         */
+        explicit IncidenceJoin(std::vector<Line> lines) : _lines{std::move(lines)} {
+            auto class_lines = std::vector<std::vector<std::size_t>>{};
+            for (std::size_t j = 0; j != this->_lines.size(); ++j) {
+                const auto &l = this->_lines[j].coord;
+                if (l[0] == 0 && l[1] == 0) {
+                    if (l[2] != 0) this->_at_infinity.push_back(j);
+                    continue;
+                }
+                const auto key = canonical_coord({l[1], -l[0], 0});  // point at infinity
+                const auto [it, inserted] = this->_class_of_key.emplace(key, class_lines.size());
+                if (inserted) {
+                    class_lines.emplace_back();
+                    this->_classes.push_back(DirectionClass{-key[1], key[0], 0, 0});
+                }
+                class_lines[it->second].push_back(j);
+            }
+            for (std::size_t c = 0; c != this->_classes.size(); ++c) {
+                auto &cls = this->_classes[c];
+                auto entries = std::vector<std::pair<double, std::size_t>>{};
+                for (const auto j : class_lines[c]) {
+                    // l = s (a, b, *), so a X + b Y = -l2 / s on the line
+                    const auto &l = this->_lines[j].coord;
+                    const auto s = cls.a != 0 ? l[0] / cls.a : l[1] / cls.b;
+                    entries.emplace_back(-static_cast<double>(l[2]) / static_cast<double>(s), j);
+                }
+                std::sort(entries.begin(), entries.end());
+                cls.begin = this->_order.size();
+                for (const auto &[offset, j] : entries) {
+                    this->_offset.push_back(offset);
+                    this->_order.push_back(j);
+                }
+                cls.end = this->_order.size();
+            }
+        }
+
+        /**
+         * @brief Number of distinct line directions
+         *
+         * @return std::size_t
+         */
+        auto directions() const -> std::size_t { return this->_classes.size(); }
+
+        /**
+         * @brief Stream every incident pair to `sink`
+         *
+         * Tiles run in parallel; the sink is called from worker threads but
+         * never concurrently, one tile of results at a time.
+         *
+         * @tparam Sink callable as sink(const IncidencePair &)
+         * @param[in] tiles the points, tiled
+         * @param[in] sink
+         */
+        template <class Sink> void run(const PointTiles<Point> &tiles, Sink &&sink) const {
+            PG_TRACE_SCOPE("incidence_join", "run");
+            std::mutex sink_mutex;
+            parallel_for(tiles.tiles(), 1, [&](std::size_t begin, std::size_t end) {
+                auto hit = std::vector<uint8_t>(tiles._tile);
+                auto out = std::vector<IncidencePair>{};
+                for (auto t = begin; t != end; ++t) {
+                    PG_TRACE_CHUNK("incidence_join", "tile", t);
+                    this->join_tile(tiles, t, hit, out);
+                    std::lock_guard<std::mutex> lock(sink_mutex);
+                    for (const auto &pair : out) sink(pair);
+                    out.clear();
+                }
+            });
+
+            // points at infinity: lines of the same direction and the line at infinity
+            for (const auto &[i, c] : tiles._at_infinity) {
+                for (const auto j : this->_at_infinity) sink(IncidencePair{i, j});
+                const auto it = this->_class_of_key.find(canonical_coord(c));
+                if (it == this->_class_of_key.end()) continue;
+                const auto &cls = this->_classes[it->second];
+                for (auto k = cls.begin; k != cls.end; ++k) sink(IncidencePair{i, this->_order[k]});
+            }
+        }
+
+        /**
+         * @brief Stream every incident pair to `sink`, tiling the points first
+         *
+         * @tparam Sink callable as sink(const IncidencePair &)
+         * @param[in] points
+         * @param[in] sink
+         * @param[in] tile points per tile
+         */
+        template <class Sink>
+        void run(const std::vector<Point> &points, Sink &&sink, std::size_t tile = 256) const {
+            this->run(PointTiles<Point>(points, tile), std::forward<Sink>(sink));
+        }
+    };
+
+    /**
+     * @brief All incident (point, line) pairs, sorted
+     *
+     * @tparam Point
+     * @tparam Line
+     * @param[in] points
+     * @param[in] lines
+     * @param[in] tile
+     * @return std::vector<IncidencePair>
+     */
+    template <class Point, class Line>
+    auto incidence_join(const std::vector<Point> &points, const std::vector<Line> &lines,
+                        std::size_t tile = 256) -> std::vector<IncidencePair> {
+        auto result = std::vector<IncidencePair>{};
+        IncidenceJoin<Point, Line>(lines).run(
+            points, [&](const IncidencePair &pair) { result.push_back(pair); }, tile);
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+}  // namespace fun
@@ -0,0 +1,657 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#    define PROJGEOM_HAS_MMAP 1
+#endif
+
+#include "pg_binary_io.hpp"
+#include "pg_canonical.hpp"
+#include "pg_wide.hpp"
+
+/** @file include/pg_mapped_index.hpp
+ *  This is a C++ Library header.
+ *
+ *  Read-only indexes that are built once, written to a file and memory
+ *  mapped by any number of processes. Every reference inside a file is a
+ *  byte offset from its start, so a mapping is usable as is at any address:
+ *  opening an index validates the headers and sets a few pointers, nothing
+ *  is deserialized or copied, and the page cache is shared between readers.
+ *
+ *  File layout: FileHeader (kind HashIndex or GridIndex, count = entries),
+ *  IndexHeader, then 8-byte aligned sections. Coordinates are stored as
+ *  std::array<int64_t, 3>, the `coord` of the library's points and lines.
+ *
+ *  - MappedHashIndex: distinct canonical coordinates and an open-addressing
+ *    table of entry ids (id + 1, 0 for an empty slot), probed linearly.
+ *  - MappedGridIndex: points bucketed into a uniform grid over their affine
+ *    positions, stored cell by cell (CSR), with points at infinity last and
+ *    the input position of every entry.
+ *
+ *  Building writes a temporary file and renames it over `path`, so processes
+ *  that still map an older index at that path keep their (unlinked) copy
+ *  instead of seeing it rewritten under them.
+ *
+ *  Without POSIX mmap the file is read into memory instead.
+ */
+
+namespace fun {
+
+    /**
+     * @brief Layout header following the FileHeader of an index file
+     *
+     */
+    struct IndexHeader {
+        static constexpr uint32_t LAYOUT_VERSION = 1;
+
+        uint32_t layout_version = LAYOUT_VERSION;
+        uint32_t reserved = 0;
+        uint64_t file_size = 0;
+        std::array<uint64_t, 4> sections{};  ///< byte offsets from the start of the file
+        std::array<double, 4> params{};      ///< grid: origin x, origin y, cell width, height
+        std::array<uint64_t, 2> dims{};      ///< hash: capacity; grid: columns, rows
+    };
+
+    static_assert(sizeof(IndexHeader) == 96, "IndexHeader must be 96 bytes");
+
+    /**
+     * @brief A read-only view of a whole file
+     *
+     */
+    class MappedFile {
+      private:
+        const uint8_t *_data{nullptr};
+        std::size_t _size{0};
+#ifdef PROJGEOM_HAS_MMAP
+        void *_map{nullptr};
+#else
+        std::vector<uint8_t> _buffer;
+#endif
+
+        void release() {
+#ifdef PROJGEOM_HAS_MMAP
+            if (this->_map != nullptr) ::munmap(this->_map, this->_size);
+            this->_map = nullptr;
+#endif
+            this->_data = nullptr;
+            this->_size = 0;
+        }
+
+      public:
+        MappedFile() = default;
+
+        /**
+         * @brief Map a file read-only
+         *
+         * @param[in] path
+         * @exception std::runtime_error if the file cannot be opened or mapped
+         */
+        explicit MappedFile(const std::string &path) {
+#ifdef PROJGEOM_HAS_MMAP
+            const auto fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) throw std::runtime_error("cannot open " + path);
+            struct stat info {};
+            if (::fstat(fd, &info) != 0) {
+                ::close(fd);
+                throw std::runtime_error("cannot stat " + path);
+            }
+            this->_size = static_cast<std::size_t>(info.st_size);
+            if (this->_size != 0) {
+                this->_map = ::mmap(nullptr, this->_size, PROT_READ, MAP_SHARED, fd, 0);
+                if (this->_map == MAP_FAILED) {
+                    this->_map = nullptr;
+                    ::close(fd);
+                    throw std::runtime_error("cannot map " + path);
+                }
+                this->_data = static_cast<const uint8_t *>(this->_map);
+            }
+            ::close(fd);
+#else
+            auto file = detail::open_file(path, "rb");
+            auto chunk = std::array<uint8_t, 1U << 16>{};
+            for (std::size_t n; (n = std::fread(chunk.data(), 1, chunk.size(), file.get())) != 0;) {
+                this->_buffer.insert(this->_buffer.end(), chunk.begin(), chunk.begin() + n);
+            }
+            this->_data = this->_buffer.data();
+            this->_size = this->_buffer.size();
+#endif
+        }
+
+        MappedFile(MappedFile &&other) noexcept { *this = std::move(other); }
+
+        auto operator=(MappedFile &&other) noexcept -> MappedFile & {
+            if (this != &other) {
+                this->release();
+                std::swap(this->_data, other._data);
+                std::swap(this->_size, other._size);
+#ifdef PROJGEOM_HAS_MMAP
+                std::swap(this->_map, other._map);
+#else
+                std::swap(this->_buffer, other._buffer);
+#endif
+            }
+            return *this;
+        }
+
+        MappedFile(const MappedFile &) = delete;
+        auto operator=(const MappedFile &) -> MappedFile & = delete;
+
+        ~MappedFile() { this->release(); }
+
+        auto data() const -> const uint8_t * { return this->_data; }
+        auto size() const -> std::size_t { return this->_size; }
+    };
+
+    namespace detail {
+        /**
+         * @brief Write the headers and sections of an index file
+         *
+         * Sections are written back to back; their sizes are multiples of 8,
+         * so every section stays 8-byte aligned. The file is written under a
+         * temporary name and renamed into place.
+         */
+        inline void write_index(const std::string &path, RecordKind kind, uint64_t count,
+                                IndexHeader header,
+                                const std::vector<std::pair<const void *, std::size_t>> &parts) {
+            static const auto salt = std::random_device{}();  // unique across processes
+            static auto sequence = std::atomic<uint64_t>{0};
+            auto offset = uint64_t{sizeof(FileHeader) + sizeof(IndexHeader)};
+            for (std::size_t s = 0; s != parts.size(); ++s) {
+                header.sections[s] = offset;
+                offset += parts[s].second;
+            }
+            header.file_size = offset;
+            auto file_header = FileHeader{};
+            file_header.kind = static_cast<uint16_t>(kind);
+            file_header.count = count;
+            const auto thread = std::hash<std::thread::id>{}(std::this_thread::get_id());
+            const auto temp = path + ".tmp" + std::to_string(thread) + "_" + std::to_string(salt)
+                              + "_" + std::to_string(sequence++);
+            auto file = open_file(temp, "wb");
+            auto ok = std::fwrite(&file_header, sizeof(file_header), 1, file.get()) == 1
+                      && std::fwrite(&header, sizeof(header), 1, file.get()) == 1;
+            for (const auto &part : parts) {
+                if (part.second == 0) continue;
+                ok = ok && std::fwrite(part.first, 1, part.second, file.get()) == part.second;
+            }
+            const auto closed = std::fclose(file.release()) == 0;
+            auto error = std::error_code{};
+            if (!ok || !closed) {
+                std::filesystem::remove(temp, error);
+                throw std::runtime_error("cannot write " + path);
+            }
+            std::filesystem::rename(temp, path, error);
+            if (error) {
+                std::filesystem::remove(temp, error);
+                throw std::runtime_error("cannot write " + path);
+            }
+        }
+
+        /**
+         * @brief Check that every section lies inside the mapped file
+         *
+         */
+        inline void check_sections(const MappedFile &file, const IndexHeader &layout,
+                                   const std::string &path,
+                                   const std::array<uint64_t, 4> &section_bytes) {
+            for (std::size_t s = 0; s != section_bytes.size(); ++s) {
+                if (section_bytes[s] == 0) continue;
+                const auto at = layout.sections[s];
+                if (at % 8 != 0 || at > file.size() || section_bytes[s] > file.size() - at) {
+                    throw std::runtime_error("corrupt index section in " + path);
+                }
+            }
+        }
+
+        /**
+         * @brief Validate the headers of a mapped index file
+         *
+         */
+        inline auto open_index(const MappedFile &file, RecordKind kind, const std::string &path)
+            -> std::pair<const FileHeader *, const IndexHeader *> {
+            if (file.size() < sizeof(FileHeader) + sizeof(IndexHeader)) {
+                throw std::runtime_error("not an index file: " + path);
+            }
+            const auto *head = reinterpret_cast<const FileHeader *>(file.data());
+            const auto *layout = reinterpret_cast<const IndexHeader *>(file.data()
+                                                                       + sizeof(FileHeader));
+            if (head->magic != FileHeader::MAGIC || head->version != FileHeader::VERSION
+                || head->kind != static_cast<uint16_t>(kind)) {
+                throw std::runtime_error("not an index file of the expected kind: " + path);
+            }
+            if (layout->layout_version != IndexHeader::LAYOUT_VERSION) {
+                throw std::runtime_error("unsupported index layout version in " + path);
+            }
+            if (layout->file_size != file.size()) {
+                throw std::runtime_error("truncated index file: " + path);
+            }
+            return {head, layout};
+        }
+    }  // namespace detail
+
+    /**
+     * @brief Memory-mapped set of distinct canonical coordinates
+     *
+     */
+    class MappedHashIndex {
+      public:
+        using Coord = std::array<int64_t, 3>;
+        static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+      private:
+        MappedFile _file;
+        const Coord *_coords{nullptr};
+        const uint64_t *_slots{nullptr};
+        std::size_t _count{0};
+        std::size_t _mask{0};
+
+        static auto capacity_for(std::size_t count) -> std::size_t {
+            auto capacity = std::size_t{16};
+            while (capacity < 2 * count) capacity *= 2;
+            return capacity;
+        }
+
+      public:
+        /**
+         * @brief Build an index of the distinct objects among `coords`
+         *
+         * Entry ids follow the first occurrence of each object.
+         *
+         * @param[in] path
+         * @param[in] coords any representatives
+         * @return std::size_t number of distinct entries
+         */
+        static auto build(const std::string &path, const std::vector<Coord> &coords)
+            -> std::size_t {
+            const auto capacity = capacity_for(coords.size());
+            auto slots = std::vector<uint64_t>(capacity, 0);
+            auto keys = std::vector<Coord>{};
+            for (const auto &coord : coords) {
+                const auto key = canonical_coord(coord);
+                auto slot = CoordHash{}(key) & (capacity - 1);
+                while (slots[slot] != 0 && keys[slots[slot] - 1] != key) {
+                    slot = (slot + 1) & (capacity - 1);
+                }
+                if (slots[slot] != 0) continue;
+                keys.push_back(key);
+                slots[slot] = keys.size();
+            }
+            auto header = IndexHeader{};
+            header.dims[0] = capacity;
+            detail::write_index(path, RecordKind::HashIndex, keys.size(), header,
+                                {{keys.data(), keys.size() * sizeof(Coord)},
+                                 {slots.data(), slots.size() * sizeof(uint64_t)}});
+            return keys.size();
+        }
+
+        /**
+         * @brief Build an index of points or lines
+         *
+         * @tparam Object
+         * @param[in] path
+         * @param[in] objects
+         * @return std::size_t
+         */
+        template <class Object>
+        static auto build_objects(const std::string &path, const std::vector<Object> &objects)
+            -> std::size_t {
+            auto coords = std::vector<Coord>{};
+            coords.reserve(objects.size());
+            for (const auto &obj : objects) coords.push_back(obj.coord);
+            return build(path, coords);
+        }
+
+        /**
+         * @brief Map an index file
+         *
+         * @param[in] path
+         * @exception std::runtime_error if the file is not a valid hash index
+         */
+        explicit MappedHashIndex(const std::string &path) : _file{path} {
+            const auto [head, layout] = detail::open_index(this->_file, RecordKind::HashIndex,
+                                                           path);
+            const auto capacity = layout->dims[0];
+            // the builder keeps the table at most half full
+            if (capacity == 0 || (capacity & (capacity - 1)) != 0 || head->count > capacity / 2
+                || capacity > this->_file.size() / sizeof(uint64_t)) {
+                throw std::runtime_error("corrupt hash index: " + path);
+            }
+            this->_count = static_cast<std::size_t>(head->count);
+            this->_mask = static_cast<std::size_t>(capacity - 1);
+            detail::check_sections(this->_file, *layout, path,
+                                   {head->count * sizeof(Coord), capacity * sizeof(uint64_t),
+                                    0, 0});
+            this->_coords = reinterpret_cast<const Coord *>(this->_file.data()
+                                                            + layout->sections[0]);
+            this->_slots = reinterpret_cast<const uint64_t *>(this->_file.data()
+                                                              + layout->sections[1]);
+        }
+
+        /// number of distinct entries
+        auto size() const -> std::size_t { return this->_count; }
+
+        /// canonical coordinate of entry i
+        auto coord(std::size_t i) const -> const Coord & { return this->_coords[i]; }
+
+        /**
+         * @brief Entry i as a point or line
+         *
+         * @tparam Object
+         * @param[in] i
+         * @return Object
+         */
+        template <class Object> auto object(std::size_t i) const -> Object {
+            return Object{this->_coords[i]};
+        }
+
+        /**
+         * @brief Entry id of a coordinate (any representative)
+         *
+         * At most one pass over the table is probed, so a corrupt file without
+         * empty slots cannot make a lookup spin.
+         *
+         * @param[in] coord
+         * @return std::size_t id, or npos if absent
+         */
+        auto find(const Coord &coord) const -> std::size_t {
+            const auto key = canonical_coord(coord);
+            auto slot = CoordHash{}(key) & this->_mask;
+            for (std::size_t probe = 0; probe <= this->_mask; ++probe) {
+                const auto id = this->_slots[slot];
+                if (id == 0) return npos;
+                if (id > this->_count) return npos;  // corrupt slot; never read past the keys
+                if (this->_coords[id - 1] == key) return static_cast<std::size_t>(id - 1);
+                slot = (slot + 1) & this->_mask;
+            }
+            return npos;
+        }
+
+        auto contains(const Coord &coord) const -> bool { return this->find(coord) != npos; }
+
+        template <class Object> auto contains_object(const Object &obj) const -> bool {
+            return this->contains(obj.coord);
+        }
+    };
+
+    /**
+     * @brief Memory-mapped uniform grid over points
+     *
+     */
+    class MappedGridIndex {
+      public:
+        using Coord = std::array<int64_t, 3>;
+
+      private:
+        MappedFile _file;
+        const Coord *_coords{nullptr};
+        const uint64_t *_ids{nullptr};
+        const uint64_t *_cell_start{nullptr};  // columns * rows + 1 entries
+        std::size_t _count{0};
+        std::size_t _columns{0};
+        std::size_t _rows{0};
+        double _origin_x{0}, _origin_y{0}, _width{1}, _height{1};
+
+        static auto cell_of(double value, double origin, double size, std::size_t cells)
+            -> std::size_t {
+            const auto c = std::floor((value - origin) / size);
+            if (!(c > 0)) return 0;  // also catches NaN
+            return std::min(static_cast<std::size_t>(std::min(c, 1e18)), cells - 1);
+        }
+
+        auto cell_range(std::size_t cell) const -> std::pair<std::size_t, std::size_t> {
+            return {static_cast<std::size_t>(this->_cell_start[cell]),
+                    static_cast<std::size_t>(this->_cell_start[cell + 1])};
+        }
+
+      public:
+        /**
+         * @brief Build a grid over `points`, about `per_cell` points per cell
+         *
+         * @param[in] path
+         * @param[in] points homogeneous coordinates; z == 0 are points at infinity
+         * @param[in] per_cell
+         */
+        static void build(const std::string &path, const std::vector<Coord> &points,
+                          std::size_t per_cell = 4) {
+            auto ax = std::vector<double>(points.size());
+            auto ay = std::vector<double>(points.size());
+            auto lo = std::array<double, 2>{0.0, 0.0};
+            auto hi = std::array<double, 2>{0.0, 0.0};
+            auto affine = std::size_t{0};
+            for (std::size_t i = 0; i != points.size(); ++i) {
+                const auto &p = points[i];
+                if (p[2] == 0) continue;
+                ax[i] = static_cast<double>(p[0]) / static_cast<double>(p[2]);
+                ay[i] = static_cast<double>(p[1]) / static_cast<double>(p[2]);
+                if (affine++ == 0) {
+                    lo = hi = {ax[i], ay[i]};
+                } else {
+                    lo = {std::min(lo[0], ax[i]), std::min(lo[1], ay[i])};
+                    hi = {std::max(hi[0], ax[i]), std::max(hi[1], ay[i])};
+                }
+            }
+            per_cell = std::max<std::size_t>(per_cell, 1);
+            const auto cells = std::max<std::size_t>(1, affine / per_cell);
+            const auto side = std::max<std::size_t>(
+                1, static_cast<std::size_t>(std::sqrt(static_cast<double>(cells))));
+            auto header = IndexHeader{};
+            const auto width = std::max((hi[0] - lo[0]) / static_cast<double>(side), 1e-300);
+            const auto height = std::max((hi[1] - lo[1]) / static_cast<double>(side), 1e-300);
+            header.params = {lo[0], lo[1], width, height};
+            header.dims = {side, side};
+
+            const auto num_cells = side * side;
+            auto cell = std::vector<std::size_t>(points.size(), num_cells);  // infinity last
+            auto start = std::vector<uint64_t>(num_cells + 2, 0);
+            for (std::size_t i = 0; i != points.size(); ++i) {
+                if (points[i][2] != 0) {
+                    cell[i] = cell_of(ay[i], lo[1], height, side) * side
+                              + cell_of(ax[i], lo[0], width, side);
+                }
+                ++start[cell[i] + 1];
+            }
+            for (std::size_t c = 0; c != num_cells + 1; ++c) start[c + 1] += start[c];
+            auto coords = std::vector<Coord>(points.size());
+            auto ids = std::vector<uint64_t>(points.size());
+            auto fill = std::vector<uint64_t>(start.begin(), start.end() - 1);
+            for (std::size_t i = 0; i != points.size(); ++i) {
+                const auto at = fill[cell[i]]++;
+                coords[at] = canonical_coord(points[i]);
+                ids[at] = i;
+            }
+            start.pop_back();
+            detail::write_index(path, RecordKind::GridIndex, points.size(), header,
+                                {{coords.data(), coords.size() * sizeof(Coord)},
+                                 {ids.data(), ids.size() * sizeof(uint64_t)},
+                                 {start.data(), start.size() * sizeof(uint64_t)}});
+        }
+
+        template <class Point>
+        static void build_objects(const std::string &path, const std::vector<Point> &points,
+                                  std::size_t per_cell = 4) {
+            auto coords = std::vector<Coord>{};
+            coords.reserve(points.size());
+            for (const auto &pt : points) coords.push_back(pt.coord);
+            build(path, coords, per_cell);
+        }
+
+        /**
+         * @brief Map a grid index file
+         *
+         * @param[in] path
+         * @exception std::runtime_error if the file is not a valid grid index
+         */
+        explicit MappedGridIndex(const std::string &path) : _file{path} {
+            const auto [head, layout] = detail::open_index(this->_file, RecordKind::GridIndex,
+                                                           path);
+            const auto columns = layout->dims[0];
+            const auto rows = layout->dims[1];
+            // the cell table needs 8 bytes per cell: bound columns * rows before forming it
+            if (head->count > this->_file.size() || columns == 0 || rows == 0
+                || columns > this->_file.size() / sizeof(uint64_t) / rows
+                || !(layout->params[2] > 0) || !(layout->params[3] > 0)) {
+                throw std::runtime_error("corrupt grid index: " + path);
+            }
+            detail::check_sections(this->_file, *layout, path,
+                                   {head->count * sizeof(Coord), head->count * sizeof(uint64_t),
+                                    (columns * rows + 1) * sizeof(uint64_t), 0});
+            this->_count = static_cast<std::size_t>(head->count);
+            this->_columns = static_cast<std::size_t>(columns);
+            this->_rows = static_cast<std::size_t>(rows);
+            this->_origin_x = layout->params[0];
+            this->_origin_y = layout->params[1];
+            this->_width = layout->params[2];
+            this->_height = layout->params[3];
+            const auto *base = this->_file.data();
+            this->_coords = reinterpret_cast<const Coord *>(base + layout->sections[0]);
+            this->_ids = reinterpret_cast<const uint64_t *>(base + layout->sections[1]);
+            this->_cell_start = reinterpret_cast<const uint64_t *>(base + layout->sections[2]);
+            const auto cells = this->_columns * this->_rows;
+            for (std::size_t c = 0; c != cells; ++c) {
+                if (this->_cell_start[c] > this->_cell_start[c + 1]) {
+                    throw std::runtime_error("corrupt grid index: " + path);
+                }
+            }
+            if (this->_cell_start[cells] > this->_count) {
+                throw std::runtime_error("corrupt grid index: " + path);
+            }
+        }
+
+        /// number of entries
+        auto size() const -> std::size_t { return this->_count; }
+
+        /// canonical coordinate of entry i (entries are stored cell by cell)
+        auto coord(std::size_t i) const -> const Coord & { return this->_coords[i]; }
+
+        /// position of entry i in the input of `build`
+        auto id(std::size_t i) const -> std::size_t {
+            return static_cast<std::size_t>(this->_ids[i]);
+        }
+
+        template <class Point> auto object(std::size_t i) const -> Point {
+            return Point{this->_coords[i]};
+        }
+
+        /// entries [first, size()) are the points at infinity
+        auto infinite_begin() const -> std::size_t {
+            return static_cast<std::size_t>(this->_cell_start[this->_columns * this->_rows]);
+        }
+
+        /**
+         * @brief Entries whose affine point lies in [xmin, xmax] x [ymin, ymax]
+         *
+         * Cells are selected with one cell of slack; membership is decided
+         * exactly on the integer coordinates.
+         *
+         * @tparam Sink callable as sink(std::size_t entry)
+         * @param[in] xmin
+         * @param[in] ymin
+         * @param[in] xmax
+         * @param[in] ymax
+         * @param[in] sink
+         */
+        template <class Sink>
+        void query_box(int64_t xmin, int64_t ymin, int64_t xmax, int64_t ymax, Sink &&sink) const {
+            if (xmin > xmax || ymin > ymax) return;
+            const auto c0 = cell_of(static_cast<double>(xmin), this->_origin_x, this->_width,
+                                    this->_columns);
+            const auto c1 = cell_of(static_cast<double>(xmax), this->_origin_x, this->_width,
+                                    this->_columns);
+            const auto r0 = cell_of(static_cast<double>(ymin), this->_origin_y, this->_height,
+                                    this->_rows);
+            const auto r1 = cell_of(static_cast<double>(ymax), this->_origin_y, this->_height,
+                                    this->_rows);
+            for (auto r = r0 == 0 ? 0 : r0 - 1; r <= std::min(r1 + 1, this->_rows - 1); ++r) {
+                const auto col_lo = c0 == 0 ? 0 : c0 - 1;
+                const auto col_hi = std::min(c1 + 1, this->_columns - 1);
+                const auto first = this->cell_range(r * this->_columns + col_lo).first;
+                const auto last = this->cell_range(r * this->_columns + col_hi).second;
+                for (auto i = first; i != last; ++i) {
+                    const auto &p = this->_coords[i];  // canonical: z > 0
+                    if (mul_wide(xmin, p[2]) <= p[0] && p[0] <= mul_wide(xmax, p[2])
+                        && mul_wide(ymin, p[2]) <= p[1] && p[1] <= mul_wide(ymax, p[2])) {
+                        sink(i);
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief The k affine entries nearest to (x, y), nearest first
+         *
+         * Searches rings of cells around (x, y) until no unvisited cell can
+         * hold a closer point. Distances are evaluated in double precision.
+         *
+         * @param[in] x
+         * @param[in] y
+         * @param[in] k
+         * @return std::vector<std::size_t> entries
+         */
+        auto nearest(double x, double y, std::size_t k) const -> std::vector<std::size_t> {
+            auto found = std::vector<std::pair<double, std::size_t>>{};
+            const auto affine = this->infinite_begin();
+            k = std::min(k, affine);
+            if (k == 0) return {};
+            const auto qc = static_cast<std::ptrdiff_t>(
+                cell_of(x, this->_origin_x, this->_width, this->_columns));
+            const auto qr = static_cast<std::ptrdiff_t>(
+                cell_of(y, this->_origin_y, this->_height, this->_rows));
+            const auto cols = static_cast<std::ptrdiff_t>(this->_columns);
+            const auto rows = static_cast<std::ptrdiff_t>(this->_rows);
+            const auto max_ring
+                = std::max(std::max(qc, cols - 1 - qc), std::max(qr, rows - 1 - qr));
+            auto visit = [&](std::ptrdiff_t c, std::ptrdiff_t r) {
+                if (c < 0 || r < 0 || c >= cols || r >= rows) return;
+                const auto range = this->cell_range(static_cast<std::size_t>(r * cols + c));
+                for (auto i = range.first; i != range.second; ++i) {
+                    const auto &p = this->_coords[i];
+                    const auto dx = static_cast<double>(p[0]) / static_cast<double>(p[2]) - x;
+                    const auto dy = static_cast<double>(p[1]) / static_cast<double>(p[2]) - y;
+                    found.emplace_back(dx * dx + dy * dy, i);
+                }
+            };
+            for (std::ptrdiff_t ring = 0; ring <= max_ring; ++ring) {
+                for (auto c = qc - ring; c <= qc + ring; ++c) {
+                    visit(c, qr - ring);
+                    if (ring != 0) visit(c, qr + ring);
+                }
+                for (auto r = qr - ring + 1; r <= qr + ring - 1; ++r) {
+                    visit(qc - ring, r);
+                    visit(qc + ring, r);
+                }
+                if (found.size() < k) continue;
+                std::nth_element(found.begin(), found.begin() + static_cast<std::ptrdiff_t>(k - 1),
+                                 found.end());
+                // every unvisited cell is at least `ring` whole cells away
+                const auto reach
+                    = static_cast<double>(ring) * std::min(this->_width, this->_height);
+                if (found[k - 1].first <= reach * reach) break;
+            }
+            std::sort(found.begin(), found.end());
+            auto result = std::vector<std::size_t>(k);
+            for (std::size_t j = 0; j != k; ++j) result[j] = found[j].second;
+            return result;
+        }
+    };
+
+}  // namespace fun
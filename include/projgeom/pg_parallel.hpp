@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** @file include/pg_parallel.hpp
+ *  This is a C++ Library header.
+ */
+
+namespace fun {
+
+    /**
+     * @brief Number of worker threads used by the batch engines
+     *
+     * @return std::size_t at least one
+     */
+    inline auto num_workers() -> std::size_t {
+        const auto hw = static_cast<std::size_t>(std::thread::hardware_concurrency());
+        return hw == 0 ? 1 : hw;
+    }
+
+    /**
+     * @brief Run `func(begin, end)` over [0, count) in chunks of `grain`
+     *
+     * Chunks are handed out dynamically through an atomic counter, so uneven
+     * chunk costs balance across threads. The first exception thrown by any
+     * chunk is rethrown on the calling thread after all workers have joined.
+     *
+     * @tparam Fn callable as func(std::size_t, std::size_t)
+     * @param[in] count number of items
+     * @param[in] grain items per chunk (0 selects a default)
+     * @param[in] func chunk body
+     * @param[in] workers number of threads (0 selects num_workers())
+     */
+    template <typename Fn>
+    void parallel_for(std::size_t count, std::size_t grain, Fn &&func, std::size_t workers = 0) {
+        if (count == 0) return;
+        if (workers == 0) workers = num_workers();
+        if (grain == 0) grain = std::max<std::size_t>(1, count / (8 * workers));
+        const auto chunks = (count + grain - 1) / grain;
+        workers = std::min(workers, chunks);
+        if (workers <= 1) {
+            func(std::size_t{0}, count);
+            return;
+        }
+
+        std::atomic<std::size_t> next{0};
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        auto worker = [&]() {
+            for (;;) {
+                const auto chunk = next.fetch_add(1, std::memory_order_relaxed);
+                if (chunk >= chunks) return;
+                const auto begin = chunk * grain;
+                try {
+                    func(begin, std::min(count, begin + grain));
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!error) error = std::current_exception();
+                    next.store(chunks, std::memory_order_relaxed);
+                }
+            }
+        };
+
+        std::vector<std::thread> pool;
+        pool.reserve(workers - 1);
+        for (std::size_t i = 1; i < workers; ++i) pool.emplace_back(worker);
+        worker();
+        for (auto &thread : pool) thread.join();
+        if (error) std::rethrow_exception(error);
+    }
+
+}  // namespace fun
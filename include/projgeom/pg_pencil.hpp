@@ -0,0 +1,178 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "pg_wide.hpp"
+
+/** @file include/pg_pencil.hpp
+ *  This is a C++ Library header.
+ *
+ *  Forward differencing along a pencil: the objects lambda p + mu q for
+ *  lambda, mu in arithmetic progression, produced by adding a fixed step
+ *  instead of calling `parametrize` each time. With p, q points this walks
+ *  a line; with p, q lines it walks the lines through their meet.
+ */
+
+namespace fun {
+
+    /**
+     * @brief Iterator over a pencil by repeated addition
+     *
+     * @tparam Object point or line (PgObject-derived)
+     */
+    template <class Object> class PencilIterator {
+      private:
+        std::array<int64_t, 3> _cur;
+        std::array<int64_t, 3> _step;
+        std::size_t _index;
+
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Object;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = Object;
+
+        PencilIterator(const std::array<int64_t, 3> &cur, const std::array<int64_t, 3> &step,
+                       std::size_t index)
+            : _cur{cur}, _step{step}, _index{index} {}
+
+        auto operator*() const -> Object { return Object{this->_cur}; }
+
+        auto operator++() -> PencilIterator & {
+            // unsigned: the step past the last member may leave int64, and is never read
+            for (std::size_t i = 0; i != 3; ++i) {
+                this->_cur[i] = static_cast<int64_t>(static_cast<uint64_t>(this->_cur[i])
+                                                     + static_cast<uint64_t>(this->_step[i]));
+            }
+            ++this->_index;
+            return *this;
+        }
+
+        auto operator++(int) -> PencilIterator {
+            auto old = *this;
+            ++*this;
+            return old;
+        }
+
+        auto operator==(const PencilIterator &other) const -> bool {
+            return this->_index == other._index;
+        }
+
+        auto operator!=(const PencilIterator &other) const -> bool { return !(*this == other); }
+    };
+
+    /**
+     * @brief `count` members of the pencil spanned by p and q
+     *
+     * Member k is (lambda0 + k dlambda) p + (mu0 + k dmu) q. Every coordinate
+     * is linear in k, so checking the first and last member against int64
+     * once (in 128-bit arithmetic) makes every step up to the last member
+     * overflow-free. Steps are added in uint64_t, so the one taken after the
+     * last member (which is never read) may wrap without harm.
+     *
+     * @tparam Object point or line (PgObject-derived)
+     */
+    template <class Object> class Pencil {
+      private:
+        std::array<int64_t, 3> _start{};
+        std::array<int64_t, 3> _step{};
+        std::size_t _count;
+
+        static auto member(int128_t lambda, const Object &pt_p, int128_t mu, const Object &pt_q)
+            -> std::array<int64_t, 3> {
+            const auto lo = int128_t{std::numeric_limits<int64_t>::min()};
+            const auto hi = int128_t{std::numeric_limits<int64_t>::max()};
+            if (lambda < lo || lambda > hi || mu < lo || mu > hi) {
+                throw std::overflow_error("Pencil: coefficient exceeds int64");
+            }
+            auto result = std::array<int64_t, 3>{};
+            for (std::size_t i = 0; i != 3; ++i) {
+                const auto v = lambda * int128_t{pt_p.coord[i]} + mu * int128_t{pt_q.coord[i]};
+                if (v < lo || v > hi) throw std::overflow_error("Pencil: coordinate exceeds int64");
+                result[i] = static_cast<int64_t>(v);
+            }
+            return result;
+        }
+
+      public:
+        /**
+         * @brief Construct a new Pencil object
+         *
+         * @param[in] pt_p
+         * @param[in] pt_q
+         * @param[in] lambda0
+         * @param[in] mu0
+         * @param[in] dlambda
+         * @param[in] dmu
+         * @param[in] count
+         * @exception std::overflow_error if any member leaves int64
+         */
+        Pencil(const Object &pt_p, const Object &pt_q, int64_t lambda0, int64_t mu0,
+               int64_t dlambda, int64_t dmu, std::size_t count)
+            : _count{count} {
+            if (count == 0) return;
+            const auto last = static_cast<int64_t>(count - 1);
+            this->_start = member(lambda0, pt_p, mu0, pt_q);
+            member(int128_t{lambda0} + mul_wide(last, dlambda), pt_p,
+                   int128_t{mu0} + mul_wide(last, dmu), pt_q);
+            if (count > 1) this->_step = member(dlambda, pt_p, dmu, pt_q);
+        }
+
+        auto size() const -> std::size_t { return this->_count; }
+
+        auto begin() const -> PencilIterator<Object> {
+            return {this->_start, this->_step, 0};
+        }
+
+        auto end() const -> PencilIterator<Object> {
+            return {this->_start, this->_step, this->_count};
+        }
+
+        /**
+         * @brief Write all members as structure-of-arrays coordinates
+         *
+         * Each output is an induction variable, so the loop vectorizes.
+         *
+         * @param[out] x
+         * @param[out] y
+         * @param[out] z
+         */
+        void fill(int64_t *x, int64_t *y, int64_t *z) const {
+            auto cx = static_cast<uint64_t>(this->_start[0]);
+            auto cy = static_cast<uint64_t>(this->_start[1]);
+            auto cz = static_cast<uint64_t>(this->_start[2]);
+            const auto sx = static_cast<uint64_t>(this->_step[0]);
+            const auto sy = static_cast<uint64_t>(this->_step[1]);
+            const auto sz = static_cast<uint64_t>(this->_step[2]);
+            const auto count = this->_count;  // outputs may alias members
+            for (std::size_t k = 0; k != count; ++k) {
+                x[k] = static_cast<int64_t>(cx);
+                y[k] = static_cast<int64_t>(cy);
+                z[k] = static_cast<int64_t>(cz);
+                cx += sx;
+                cy += sy;
+                cz += sz;
+            }
+        }
+
+        /**
+         * @brief All members as objects
+         *
+         * @return std::vector<Object>
+         */
+        auto to_vector() const -> std::vector<Object> {
+            auto result = std::vector<Object>{};
+            result.reserve(this->_count);
+            for (auto it = this->begin(); it != this->end(); ++it) result.push_back(*it);
+            return result;
+        }
+    };
+
+}  // namespace fun
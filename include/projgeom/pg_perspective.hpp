@@ -0,0 +1,366 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "pg_canonical.hpp"
+#include "pg_parallel.hpp"
+#include "pg_trace.hpp"
+#include "pg_wide.hpp"
+
+/** @file include/pg_perspective.hpp
+ *  This is a C++ Library header.
+ *
+ *  All pairs of perspective triangles in a set, with vertices corresponding
+ *  in order as in `fun::persp`. Triangles (A, B, C) and (D, E, F) are
+ *  perspective when the joins AD, BE and CF are concurrent; the common point
+ *  is the perspector and, by Desargues, the meets of corresponding sides lie
+ *  on the perspectrix.
+ *
+ *  Degenerate triangles are ignored, and so are pairs that share a
+ *  corresponding vertex (their join is not a line). Identical triangles are
+ *  hashed to one representative and tested once. Perspectors are exact for
+ *  coordinates below 2^15; a perspector or perspectrix that does not fit in
+ *  int64 throws std::overflow_error.
+ */
+
+namespace fun {
+
+    /**
+     * @brief A perspective pair of triangles, first < second
+     *
+     * @tparam Point
+     * @tparam Line
+     */
+    template <class Point, class Line = typename Point::Dual> struct PerspectivePair {
+        std::size_t first;
+        std::size_t second;
+        Point perspector;  ///< canonical
+        Line perspectrix;  ///< canonical
+    };
+
+    /**
+     * @brief Perspective-pair finder over a fixed set of triangles
+     *
+     * Results go to a sink, `sink(const PerspectivePair &)`, called from
+     * worker threads but never concurrently. Each worker buffers at most one
+     * tile (or one center) of results, so memory stays bounded however many
+     * pairs are found.
+     *
+     * @tparam Point
+     * @tparam Line
+     */
+    template <class Point, class Line = typename Point::Dual> class PerspectiveFinder {
+      public:
+        using Triangle = std::array<Point, 3>;
+        using Pair = PerspectivePair<Point, Line>;
+        using Coord = std::array<int64_t, 3>;
+
+      private:
+        std::vector<Triangle> _triangles;
+        std::vector<std::size_t> _start;    // distinct triangle u has copies
+        std::vector<std::size_t> _members;  //   _members[_start[u], _start[u + 1])
+        std::size_t _distinct{0};
+        std::vector<double> _soa;  // coordinate k of vertex v at [(3 v + k) * _distinct + u]
+
+        static auto join(const Coord &p, const Coord &q) -> Coord {
+            return narrow_reduced(cross_wide(p, q));
+        }
+
+        static auto is_zero(const Coord &c) -> bool { return c[0] == 0 && c[1] == 0 && c[2] == 0; }
+
+        auto vertex(std::size_t u, std::size_t v) const -> const Coord & {
+            return this->_triangles[this->_members[this->_start[u]]][v].coord;
+        }
+
+        /**
+         * @brief Exact perspector of two distinct triangles, if any
+         *
+         */
+        auto perspector(std::size_t u, std::size_t w) const -> std::optional<Coord> {
+            auto joins = std::array<Coord, 3>{};
+            for (std::size_t v = 0; v != 3; ++v) {
+                joins[v] = join(this->vertex(u, v), this->vertex(w, v));
+                if (is_zero(joins[v])) return std::nullopt;
+            }
+            // two joins may coincide, but not all three (the triangles are proper)
+            auto center = join(joins[0], joins[1]);
+            if (is_zero(center)) return join(joins[0], joins[2]);
+            if (dot_wide(center, joins[2]) != int128_t(0)) return std::nullopt;
+            return center;
+        }
+
+        /**
+         * @brief Desargues axis through the meets of corresponding sides
+         *
+         */
+        auto perspectrix(std::size_t u, std::size_t w) const -> Coord {
+            auto meets = std::array<Coord, 3>{};
+            for (std::size_t s = 0; s != 3; ++s) {
+                const auto side_u = join(this->vertex(u, s), this->vertex(u, (s + 1) % 3));
+                const auto side_w = join(this->vertex(w, s), this->vertex(w, (s + 1) % 3));
+                meets[s] = join(side_u, side_w);
+            }
+            for (std::size_t s = 0; s != 3; ++s) {
+                const auto axis = join(meets[s], meets[(s + 1) % 3]);
+                if (!is_zero(axis)) return axis;
+            }
+            return {0, 0, 0};
+        }
+
+        /**
+         * @brief Append every copy pair of distinct triangles u and w
+         *
+         */
+        void emit(std::size_t u, std::size_t w, const Coord &center, std::vector<Pair> &out) const {
+            const auto axis = Line{this->perspectrix(u, w)};
+            const auto pt = Point{canonical_coord(center)};
+            for (auto a = this->_start[u]; a != this->_start[u + 1]; ++a) {
+                for (auto b = this->_start[w]; b != this->_start[w + 1]; ++b) {
+                    const auto i = this->_members[a];
+                    const auto j = this->_members[b];
+                    out.push_back(Pair{std::min(i, j), std::max(i, j), pt, axis});
+                }
+            }
+        }
+
+        /**
+         * @brief Floating-point filter for the pairs (i, j), j in [j_begin, j_end)
+         *
+         * flags[j - j_begin] is cleared when det[AD, BE, CF] is certainly
+         * non-zero; the loop has no branches and vectorizes.
+         */
+        void filter(std::size_t i, std::size_t j_begin, std::size_t j_end, uint8_t *flags) const {
+            const auto n = this->_distinct;
+            const auto *d = this->_soa.data();
+            auto c = std::array<double, 9>{};
+            for (std::size_t k = 0; k != 9; ++k) c[k] = d[k * n + i];
+            const auto *ax = d;
+            const auto *ay = d + n;
+            const auto *az = d + 2 * n;
+            const auto *bx = d + 3 * n;
+            const auto *by = d + 4 * n;
+            const auto *bz = d + 5 * n;
+            const auto *cx = d + 6 * n;
+            const auto *cy = d + 7 * n;
+            const auto *cz = d + 8 * n;
+            const auto tol = 64 * std::numeric_limits<double>::epsilon();
+            for (auto j = j_begin; j != j_end; ++j) {
+                // joins AD, BE, CF and componentwise bounds of their magnitudes
+                const auto p0 = c[1] * az[j] - c[2] * ay[j];
+                const auto p1 = c[2] * ax[j] - c[0] * az[j];
+                const auto p2 = c[0] * ay[j] - c[1] * ax[j];
+                const auto q0 = c[4] * bz[j] - c[5] * by[j];
+                const auto q1 = c[5] * bx[j] - c[3] * bz[j];
+                const auto q2 = c[3] * by[j] - c[4] * bx[j];
+                const auto r0 = c[7] * cz[j] - c[8] * cy[j];
+                const auto r1 = c[8] * cx[j] - c[6] * cz[j];
+                const auto r2 = c[6] * cy[j] - c[7] * cx[j];
+                const auto mp0 = std::fabs(c[1] * az[j]) + std::fabs(c[2] * ay[j]);
+                const auto mp1 = std::fabs(c[2] * ax[j]) + std::fabs(c[0] * az[j]);
+                const auto mp2 = std::fabs(c[0] * ay[j]) + std::fabs(c[1] * ax[j]);
+                const auto mq0 = std::fabs(c[4] * bz[j]) + std::fabs(c[5] * by[j]);
+                const auto mq1 = std::fabs(c[5] * bx[j]) + std::fabs(c[3] * bz[j]);
+                const auto mq2 = std::fabs(c[3] * by[j]) + std::fabs(c[4] * bx[j]);
+                const auto mr0 = std::fabs(c[7] * cz[j]) + std::fabs(c[8] * cy[j]);
+                const auto mr1 = std::fabs(c[8] * cx[j]) + std::fabs(c[6] * cz[j]);
+                const auto mr2 = std::fabs(c[6] * cy[j]) + std::fabs(c[7] * cx[j]);
+                const auto det = p0 * (q1 * r2 - q2 * r1) + p1 * (q2 * r0 - q0 * r2)
+                                 + p2 * (q0 * r1 - q1 * r0);
+                const auto bound = mp0 * (mq1 * mr2 + mq2 * mr1) + mp1 * (mq2 * mr0 + mq0 * mr2)
+                                   + mp2 * (mq0 * mr1 + mq1 * mr0);
+                flags[j - j_begin] = std::fabs(det) <= tol * bound ? 1 : 0;
+            }
+        }
+
+      public:
+        /**
+         * @brief Construct a new Perspective Finder object
+         *
+         * @param[in] triangles
+         */
+        explicit PerspectiveFinder(std::vector<Triangle> triangles)
+            : _triangles{std::move(triangles)} {
+            struct TriangleHash {
+                auto operator()(const std::array<Coord, 3> &t) const noexcept -> std::size_t {
+                    const auto h = CoordHash{};
+                    return h(t[0]) ^ (h(t[1]) * 31) ^ (h(t[2]) * 1031);
+                }
+            };
+            auto index = std::unordered_map<std::array<Coord, 3>, std::size_t, TriangleHash>{};
+            auto group = std::vector<std::size_t>{};
+            auto sizes = std::vector<std::size_t>{};
+            for (std::size_t t = 0; t != this->_triangles.size(); ++t) {
+                const auto &[pa, pb, pc] = this->_triangles[t];
+                if (dot_wide(join(pa.coord, pb.coord), pc.coord) == int128_t(0)) {
+                    group.push_back(SIZE_MAX);  // degenerate
+                    continue;
+                }
+                const auto key = std::array<Coord, 3>{canonical_coord(pa.coord),
+                                                      canonical_coord(pb.coord),
+                                                      canonical_coord(pc.coord)};
+                const auto [it, inserted] = index.emplace(key, sizes.size());
+                if (inserted) sizes.push_back(0);
+                ++sizes[it->second];
+                group.push_back(it->second);
+            }
+            this->_distinct = sizes.size();
+            this->_start.assign(this->_distinct + 1, 0);
+            std::partial_sum(sizes.begin(), sizes.end(), this->_start.begin() + 1);
+            this->_members.resize(this->_start.back());
+            auto fill = this->_start;
+            for (std::size_t t = 0; t != group.size(); ++t) {
+                if (group[t] != SIZE_MAX) this->_members[fill[group[t]]++] = t;
+            }
+            const auto n = this->_distinct;
+            this->_soa.resize(9 * n);
+            for (std::size_t u = 0; u != n; ++u) {
+                for (std::size_t v = 0; v != 3; ++v) {
+                    for (std::size_t k = 0; k != 3; ++k) {
+                        const auto value = this->vertex(u, v)[k];
+                        this->_soa[(3 * v + k) * n + u] = static_cast<double>(value);
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief Number of distinct proper triangles
+         *
+         * @return std::size_t
+         */
+        auto distinct() const -> std::size_t { return this->_distinct; }
+
+        /**
+         * @brief Test all pairs, tile by tile
+         *
+         * Tiles of `tile` x `tile` distinct triangles run in parallel; inside a
+         * tile a vectorized floating-point filter discards the clearly
+         * non-perspective pairs and the rest are decided exactly.
+         *
+         * @tparam Sink callable as sink(const PerspectivePair &)
+         * @param[in] sink
+         * @param[in] tile distinct triangles per tile side
+         */
+        template <class Sink> void all_pairs(Sink &&sink, std::size_t tile = 256) const {
+            const auto n = this->_distinct;
+            tile = std::max<std::size_t>(tile, 1);
+            const auto blocks = (n + tile - 1) / tile;
+            auto tiles = std::vector<std::pair<std::size_t, std::size_t>>{};
+            for (std::size_t bi = 0; bi != blocks; ++bi) {
+                for (auto bj = bi; bj != blocks; ++bj) tiles.emplace_back(bi, bj);
+            }
+            std::mutex sink_mutex;
+            parallel_for(tiles.size(), 1, [&](std::size_t begin, std::size_t end) {
+                auto flags = std::vector<uint8_t>(tile);
+                auto out = std::vector<Pair>{};
+                for (auto t = begin; t != end; ++t) {
+                    PG_TRACE_CHUNK("perspective", "tile", t);
+                    const auto [bi, bj] = tiles[t];
+                    const auto i_end = std::min(n, (bi + 1) * tile);
+                    for (auto i = bi * tile; i != i_end; ++i) {
+                        const auto j_begin = bi == bj ? i + 1 : bj * tile;
+                        const auto j_end = std::min(n, (bj + 1) * tile);
+                        if (j_begin >= j_end) continue;
+                        this->filter(i, j_begin, j_end, flags.data());
+                        for (auto j = j_begin; j != j_end; ++j) {
+                            if (flags[j - j_begin] == 0) continue;
+                            if (const auto center = this->perspector(i, j)) {
+                                this->emit(i, j, *center, out);
+                            }
+                        }
+                    }
+                    std::lock_guard<std::mutex> lock(sink_mutex);
+                    for (const auto &pair : out) sink(pair);
+                    out.clear();
+                }
+            });
+        }
+
+        /**
+         * @brief Pairs perspective from one of the given centers
+         *
+         * For a center O, two triangles are perspective from O exactly when
+         * their lines OA, OB, OC agree, so hashing these canonical lines
+         * groups the triangles and only pairs within a group are reported.
+         * Costs O(centers x triangles) instead of O(triangles^2).
+         *
+         * @tparam Sink callable as sink(const PerspectivePair &)
+         * @param[in] centers
+         * @param[in] sink
+         */
+        template <class Sink> void from_centers(const std::vector<Point> &centers,
+                                                Sink &&sink) const {
+            auto keys = std::vector<Coord>{};
+            for (const auto &pt : centers) {
+                if (!is_zero(pt.coord)) keys.push_back(canonical_coord(pt.coord));
+            }
+            std::sort(keys.begin(), keys.end());
+            keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+            const auto n = this->_distinct;
+            std::mutex sink_mutex;
+            parallel_for(keys.size(), 1, [&](std::size_t begin, std::size_t end) {
+                auto rays = std::vector<std::pair<std::array<Coord, 3>, std::size_t>>{};
+                auto out = std::vector<Pair>{};
+                for (auto c = begin; c != end; ++c) {
+                    PG_TRACE_CHUNK("perspective", "center", c);
+                    const auto &center = keys[c];
+                    rays.clear();
+                    for (std::size_t u = 0; u != n; ++u) {
+                        auto sig = std::array<Coord, 3>{};
+                        for (std::size_t v = 0; v != 3; ++v) {
+                            sig[v] = join(center, this->vertex(u, v));
+                        }
+                        if (is_zero(sig[0]) || is_zero(sig[1]) || is_zero(sig[2])) continue;
+                        rays.emplace_back(sig, u);
+                    }
+                    std::sort(rays.begin(), rays.end());
+                    for (std::size_t lo = 0, hi = 0; lo != rays.size(); lo = hi) {
+                        while (hi != rays.size() && rays[hi].first == rays[lo].first) ++hi;
+                        for (auto a = lo; a != hi; ++a) {
+                            for (auto b = a + 1; b != hi; ++b) {
+                                const auto u = rays[a].second;
+                                const auto w = rays[b].second;
+                                if (this->perspector(u, w)) this->emit(u, w, center, out);
+                            }
+                        }
+                    }
+                    std::lock_guard<std::mutex> lock(sink_mutex);
+                    for (const auto &pair : out) sink(pair);
+                    out.clear();
+                }
+            });
+        }
+    };
+
+    /**
+     * @brief All perspective pairs, sorted by (first, second)
+     *
+     * @tparam Point
+     * @param[in] triangles
+     * @param[in] tile
+     * @return std::vector<PerspectivePair<Point>>
+     */
+    template <class Point>
+    auto perspective_pairs(const std::vector<std::array<Point, 3>> &triangles,
+                           std::size_t tile = 256) -> std::vector<PerspectivePair<Point>> {
+        auto result = std::vector<PerspectivePair<Point>>{};
+        PerspectiveFinder<Point>(triangles).all_pairs(
+            [&](const PerspectivePair<Point> &pair) { result.push_back(pair); }, tile);
+        std::sort(result.begin(), result.end(), [](const auto &p, const auto &q) {
+            return std::make_pair(p.first, p.second) < std::make_pair(q.first, q.second);
+        });
+        return result;
+    }
+
+}  // namespace fun
@@ -0,0 +1,375 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "pg_parallel.hpp"
+
+/** @file include/pg_polygon.hpp
+ *  This is a C++ Library header.
+ *
+ *  Exact point-in-polygon classification over homogeneous integer points.
+ *  All orientation tests are `meet`/`dot` evaluations in int64_t, so they are
+ *  exact as long as the coordinates stay below 2^20 in magnitude.
+ */
+
+namespace fun {
+
+    /**
+     * @brief Location of a point relative to a polygon
+     *
+     */
+    enum class Location : std::int8_t { Outside, Inside, Boundary };
+
+    /**
+     * @brief Whether every component is below 2^20 in magnitude, the range in
+     *        which the classification is exact
+     *
+     * @param[in] coord
+     * @return true
+     * @return false
+     */
+    constexpr auto within_polygon_range(const std::array<int64_t, 3> &coord) -> bool {
+        constexpr auto bound = int64_t{1} << 20;
+        for (const auto c : coord) {
+            if (c <= -bound || c >= bound) return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Homogeneous coordinate scaled so that the last component is positive
+     *
+     * @param[in] coord Homogeneous coordinate of an affine point
+     * @return std::array<int64_t, 3>
+     */
+    constexpr auto affine_coord(const std::array<int64_t, 3> &coord) -> std::array<int64_t, 3> {
+        assert(coord[2] != 0);
+        return coord[2] < 0 ? std::array<int64_t, 3>{-coord[0], -coord[1], -coord[2]} : coord;
+    }
+
+    /**
+     * @brief Polygon edge, stored with its endpoints and its line `a.meet(b)`
+     *
+     */
+    struct PolygonEdge {
+        int64_t ax, ay, az;
+        int64_t bx, by, bz;
+        int64_t l0, l1, l2;
+    };
+
+    /**
+     * @brief Winding-number contribution of one edge to a run of points
+     *
+     * Branch-free so that the inner loop over the SoA point arrays vectorizes.
+     * Points must have a positive last coordinate (see affine_coord()).
+     *
+     * @param[in] edge
+     * @param[in] xs
+     * @param[in] ys
+     * @param[in] zs
+     * @param[in] count
+     * @param[in,out] winding accumulated winding numbers
+     * @param[in,out] boundary set to 1 where the point lies on the edge
+     */
+    inline void winding_kernel(const PolygonEdge &edge, const int64_t *xs, const int64_t *ys,
+                               const int64_t *zs, std::size_t count, int32_t *winding,
+                               uint8_t *boundary) {
+        const auto e = edge;
+        for (std::size_t i = 0; i != count; ++i) {
+            const auto x = xs[i];
+            const auto y = ys[i];
+            const auto z = zs[i];
+            const auto side = e.l0 * x + e.l1 * y + e.l2 * z;
+            const auto dya = e.ay * z - y * e.az;
+            const auto dyb = e.by * z - y * e.bz;
+            const auto dxa = e.ax * z - x * e.az;
+            const auto dxb = e.bx * z - x * e.bz;
+            const bool a_le = dya <= 0;
+            const bool b_le = dyb <= 0;
+            const bool up = a_le & !b_le & (side > 0);
+            const bool down = !a_le & b_le & (side < 0);
+            winding[i] += static_cast<int32_t>(up) - static_cast<int32_t>(down);
+            const bool in_x = ((dxa <= 0) & (dxb >= 0)) | ((dxa >= 0) & (dxb <= 0));
+            const bool in_y = ((dya <= 0) & (dyb >= 0)) | ((dya >= 0) & (dyb <= 0));
+            boundary[i] |= static_cast<uint8_t>((side == 0) & in_x & in_y);
+        }
+    }
+
+    /**
+     * @brief Slab-indexed polygon for exact point-in-polygon queries
+     *
+     * The y-extent of the polygon is cut into horizontal slabs and every slab
+     * lists the edges whose y-range overlaps it (widened by one slab on each side
+     * so that floating-point bucketing never drops an edge). The slab only
+     * selects candidate edges; the classification itself is exact.
+     *
+     * @tparam Point
+     */
+    template <class Point> class PolygonIndex {
+      private:
+        std::vector<PolygonEdge> _edges;
+        std::vector<uint32_t> _slab_start;
+        std::vector<uint32_t> _slab_edges;
+        double _x_min{0}, _x_max{0}, _y_min{0}, _y_max{0};
+        double _tol{0};
+        double _height{1};
+
+        static constexpr auto to_double(int64_t num, int64_t den) -> double {
+            return static_cast<double>(num) / static_cast<double>(den);
+        }
+
+        auto slab_of(double y) const -> std::size_t {
+            const auto num = this->num_slabs();
+            const auto s = std::floor((y - this->_y_min) / this->_height);
+            if (!(s > 0)) return 0;
+            return std::min(num - 1, static_cast<std::size_t>(s));
+        }
+
+      public:
+        /**
+         * @brief Construct a new Polygon Index object
+         *
+         * @param[in] ring polygon vertices (closed implicitly, any orientation)
+         * @param[in] num_slabs number of slabs (0 selects about 2 sqrt(n))
+         */
+        explicit PolygonIndex(const std::vector<Point> &ring, std::size_t num_slabs = 0) {
+            const auto n = ring.size();
+            assert(n >= 3);
+            this->_edges.reserve(n);
+            for (std::size_t i = 0; i != n; ++i) {
+                const auto a = affine_coord(ring[i].coord);
+                const auto b = affine_coord(ring[(i + 1) % n].coord);
+                const auto ln = ring[i].meet(ring[(i + 1) % n]).coord;
+                // keep the sign of the line consistent with positive z
+                const auto flip = (ring[i].coord[2] < 0) != (ring[(i + 1) % n].coord[2] < 0);
+                this->_edges.push_back({a[0], a[1], a[2], b[0], b[1], b[2], flip ? -ln[0] : ln[0],
+                                        flip ? -ln[1] : ln[1], flip ? -ln[2] : ln[2]});
+            }
+
+            this->_x_min = this->_y_min = HUGE_VAL;
+            this->_x_max = this->_y_max = -HUGE_VAL;
+            for (const auto &e : this->_edges) {
+                this->_x_min = std::min(this->_x_min, to_double(e.ax, e.az));
+                this->_x_max = std::max(this->_x_max, to_double(e.ax, e.az));
+                this->_y_min = std::min(this->_y_min, to_double(e.ay, e.az));
+                this->_y_max = std::max(this->_y_max, to_double(e.ay, e.az));
+            }
+            const auto scale = std::max({1.0, std::fabs(this->_x_min), std::fabs(this->_x_max),
+                                         std::fabs(this->_y_min), std::fabs(this->_y_max)});
+            this->_tol = 1e-9 * scale;
+
+            if (num_slabs == 0) {
+                num_slabs = static_cast<std::size_t>(2.0 * std::sqrt(static_cast<double>(n))) + 1;
+            }
+            if (!(this->_y_max > this->_y_min)) num_slabs = 1;
+            this->_height = num_slabs == 1 ? 1.0 : (this->_y_max - this->_y_min) / num_slabs;
+
+            // counting sort of edges into the slabs they may cross
+            this->_slab_start.assign(num_slabs + 1, 0);
+            std::vector<std::pair<std::size_t, std::size_t>> spans;
+            spans.reserve(n);
+            for (const auto &e : this->_edges) {
+                const auto ya = to_double(e.ay, e.az);
+                const auto yb = to_double(e.by, e.bz);
+                const auto lo = this->slab_of(std::min(ya, yb));
+                const auto hi = std::min(num_slabs - 1, this->slab_of(std::max(ya, yb)) + 1);
+                spans.emplace_back(lo == 0 ? 0 : lo - 1, hi);
+                for (auto s = spans.back().first; s <= hi; ++s) ++this->_slab_start[s + 1];
+            }
+            for (std::size_t s = 0; s != num_slabs; ++s) {
+                this->_slab_start[s + 1] += this->_slab_start[s];
+            }
+            this->_slab_edges.resize(this->_slab_start[num_slabs]);
+            auto fill = this->_slab_start;
+            for (std::size_t i = 0; i != n; ++i) {
+                for (auto s = spans[i].first; s <= spans[i].second; ++s) {
+                    this->_slab_edges[fill[s]++] = static_cast<uint32_t>(i);
+                }
+            }
+        }
+
+        /**
+         * @brief Number of edges
+         *
+         * @return std::size_t
+         */
+        auto size() const -> std::size_t { return this->_edges.size(); }
+
+        /**
+         * @brief Number of slabs
+         *
+         * @return std::size_t
+         */
+        auto num_slabs() const -> std::size_t { return this->_slab_start.size() - 1; }
+
+        /**
+         * @brief Whether an affine point is certainly outside the bounding box
+         *
+         * @param[in] coord Homogeneous coordinate with positive last component
+         * @return true
+         * @return false
+         */
+        auto outside_bbox(const std::array<int64_t, 3> &coord) const -> bool {
+            const auto x = to_double(coord[0], coord[2]);
+            const auto y = to_double(coord[1], coord[2]);
+            return x < this->_x_min - this->_tol || x > this->_x_max + this->_tol
+                   || y < this->_y_min - this->_tol || y > this->_y_max + this->_tol;
+        }
+
+        /**
+         * @brief Locate a single point
+         *
+         * @param[in] pt_p point; a point at infinity is Outside
+         * @return Location
+         */
+        auto locate(const Point &pt_p) const -> Location {
+            if (pt_p.coord[2] == 0) return Location::Outside;
+            const auto c = affine_coord(pt_p.coord);
+            if (this->outside_bbox(c)) return Location::Outside;
+            const auto s = this->slab_of(to_double(c[1], c[2]));
+            int32_t winding = 0;
+            uint8_t boundary = 0;
+            for (auto k = this->_slab_start[s]; k != this->_slab_start[s + 1]; ++k) {
+                winding_kernel(this->_edges[this->_slab_edges[k]], &c[0], &c[1], &c[2], 1,
+                               &winding, &boundary);
+            }
+            if (boundary != 0) return Location::Boundary;
+            return winding != 0 ? Location::Inside : Location::Outside;
+        }
+
+        /**
+         * @brief Locate a run of points
+         *
+         * Points are bucketed by slab into SoA buffers, then every slab runs the
+         * vectorized winding_kernel() once per candidate edge. Points at
+         * infinity are Outside.
+         *
+         * @param[in] first
+         * @param[in] last
+         * @param[out] out one Location per point
+         */
+        template <typename Iter> void locate_batch(Iter first, Iter last, Location *out) const {
+            const auto count = static_cast<std::size_t>(std::distance(first, last));
+            const auto num = this->num_slabs();
+            std::vector<std::array<int64_t, 3>> coords;
+            coords.reserve(count);
+            std::vector<std::size_t> slab(count);
+            std::vector<uint32_t> start(num + 1, 0);
+            for (std::size_t i = 0; i != count; ++i, ++first) {
+                const auto &c = first->coord;
+                coords.push_back(c[2] == 0 ? c : affine_coord(c));
+                if (c[2] == 0 || this->outside_bbox(coords[i])) {
+                    slab[i] = num;
+                    out[i] = Location::Outside;
+                    continue;
+                }
+                slab[i] = this->slab_of(to_double(coords[i][1], coords[i][2]));
+                ++start[slab[i] + 1];
+            }
+            for (std::size_t s = 0; s != num; ++s) start[s + 1] += start[s];
+
+            const auto total = start[num];
+            std::vector<int64_t> xs(total), ys(total), zs(total);
+            std::vector<uint32_t> origin(total);
+            auto fill = start;
+            for (std::size_t i = 0; i != count; ++i) {
+                if (slab[i] == num) continue;
+                const auto k = fill[slab[i]]++;
+                xs[k] = coords[i][0];
+                ys[k] = coords[i][1];
+                zs[k] = coords[i][2];
+                origin[k] = static_cast<uint32_t>(i);
+            }
+
+            std::vector<int32_t> winding(total, 0);
+            std::vector<uint8_t> boundary(total, 0);
+            for (std::size_t s = 0; s != num; ++s) {
+                const auto lo = start[s];
+                const auto len = start[s + 1] - lo;
+                if (len == 0) continue;
+                for (auto k = this->_slab_start[s]; k != this->_slab_start[s + 1]; ++k) {
+                    winding_kernel(this->_edges[this->_slab_edges[k]], &xs[lo], &ys[lo], &zs[lo],
+                                   len, &winding[lo], &boundary[lo]);
+                }
+            }
+            for (std::size_t k = 0; k != total; ++k) {
+                out[origin[k]] = boundary[k] != 0 ? Location::Boundary
+                                 : winding[k] != 0 ? Location::Inside
+                                                   : Location::Outside;
+            }
+        }
+    };
+
+    /**
+     * @brief Locate many points against one polygon, in parallel over point chunks
+     *
+     * @tparam Point
+     * @param[in] index
+     * @param[in] points
+     * @param[in] grain points per chunk
+     * @return std::vector<Location>
+     */
+    template <class Point>
+    auto locate_points(const PolygonIndex<Point> &index, const std::vector<Point> &points,
+                       std::size_t grain = 4096) -> std::vector<Location> {
+        std::vector<Location> result(points.size(), Location::Outside);
+        parallel_for(points.size(), grain, [&](std::size_t begin, std::size_t end) {
+            index.locate_batch(points.begin() + begin, points.begin() + end, &result[begin]);
+        });
+        return result;
+    }
+
+    /**
+     * @brief A point that is inside or on the boundary of a polygon
+     *
+     */
+    struct PipHit {
+        std::size_t point;
+        std::size_t polygon;
+        Location location;
+    };
+
+    /**
+     * @brief Report every (point, polygon) pair that is not Outside
+     *
+     * Work is distributed over (polygon, point chunk) tiles. Hits are returned
+     * grouped by polygon, then ordered by point, independent of scheduling.
+     *
+     * @tparam Point
+     * @param[in] polygons
+     * @param[in] points
+     * @param[in] grain points per tile
+     * @return std::vector<PipHit>
+     */
+    template <class Point>
+    auto locate_hits(const std::vector<PolygonIndex<Point>> &polygons,
+                     const std::vector<Point> &points, std::size_t grain = 4096)
+        -> std::vector<PipHit> {
+        if (grain == 0) grain = 4096;
+        const auto chunks = (points.size() + grain - 1) / grain;
+        std::vector<std::vector<PipHit>> tiles(polygons.size() * chunks);
+        parallel_for(tiles.size(), 1, [&](std::size_t begin, std::size_t end) {
+            std::vector<Location> loc;
+            for (auto t = begin; t != end; ++t) {
+                const auto poly = t / chunks;
+                const auto lo = (t % chunks) * grain;
+                const auto hi = std::min(points.size(), lo + grain);
+                loc.resize(hi - lo);
+                polygons[poly].locate_batch(points.begin() + lo, points.begin() + hi, loc.data());
+                for (auto i = lo; i != hi; ++i) {
+                    if (loc[i - lo] != Location::Outside) tiles[t].push_back({i, poly, loc[i - lo]});
+                }
+            }
+        });
+        std::vector<PipHit> hits;
+        for (auto &tile : tiles) hits.insert(hits.end(), tile.begin(), tile.end());
+        return hits;
+    }
+
+}  // namespace fun
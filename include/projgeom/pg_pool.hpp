@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+/** @file include/pg_pool.hpp
+ *  This is a C++ Library header.
+ */
+
+namespace fun {
+
+    /**
+     * @brief Fixed-size node pool (not thread-safe)
+     *
+     * Hands out blocks of one size from large slabs and recycles freed blocks
+     * through an intrusive free list. Everything is released at once when the
+     * pool is destroyed.
+     */
+    class NodePool {
+      private:
+        struct FreeNode {
+            FreeNode *next;
+        };
+
+        std::size_t _node_size;
+        std::size_t _nodes_per_slab;
+        std::vector<std::unique_ptr<std::byte[]>> _slabs;
+        std::size_t _used{0};
+        FreeNode *_free{nullptr};
+
+      public:
+        /**
+         * @brief Construct a new Node Pool object
+         *
+         * @param[in] node_size bytes per node
+         * @param[in] nodes_per_slab nodes carved from each allocation
+         */
+        explicit NodePool(std::size_t node_size, std::size_t nodes_per_slab = 1024)
+            : _node_size{(std::max(node_size, sizeof(FreeNode)) + alignof(std::max_align_t) - 1)
+                         / alignof(std::max_align_t) * alignof(std::max_align_t)},
+              _nodes_per_slab{nodes_per_slab},
+              _used{nodes_per_slab} {}
+
+        /**
+         * @brief Bytes per node
+         *
+         * @return std::size_t
+         */
+        auto node_size() const -> std::size_t { return this->_node_size; }
+
+        /**
+         * @brief Get one node
+         *
+         * @return void*
+         */
+        auto allocate() -> void * {
+            if (this->_free != nullptr) {
+                auto *node = this->_free;
+                this->_free = node->next;
+                return node;
+            }
+            if (this->_used == this->_nodes_per_slab) {
+                this->_slabs.emplace_back(new std::byte[this->_node_size * this->_nodes_per_slab]);
+                this->_used = 0;
+            }
+            return this->_slabs.back().get() + this->_node_size * this->_used++;
+        }
+
+        /**
+         * @brief Return one node
+         *
+         * @param[in] ptr
+         */
+        void deallocate(void *ptr) {
+            auto *node = static_cast<FreeNode *>(ptr);
+            node->next = this->_free;
+            this->_free = node;
+        }
+    };
+
+    /**
+     * @brief Allocator that serves single-object requests from a NodePool
+     *
+     * Intended for node-based containers (std::set, std::map, std::list). The
+     * pool is created lazily for the node type the container rebinds to; array
+     * requests fall back to operator new.
+     *
+     * @tparam T
+     */
+    template <typename T> class PoolAllocator {
+      private:
+        template <typename U> friend class PoolAllocator;
+
+        std::shared_ptr<std::vector<std::unique_ptr<NodePool>>> _pools;
+
+        auto pool() const -> NodePool & {
+            for (auto &pool : *this->_pools) {
+                if (pool->node_size() >= sizeof(T) && pool->node_size() < sizeof(T) + 16) {
+                    return *pool;
+                }
+            }
+            this->_pools->emplace_back(std::make_unique<NodePool>(sizeof(T)));
+            return *this->_pools->back();
+        }
+
+      public:
+        using value_type = T;
+
+        PoolAllocator() : _pools{std::make_shared<std::vector<std::unique_ptr<NodePool>>>()} {}
+
+        template <typename U>
+        PoolAllocator(const PoolAllocator<U> &other)  // NOLINT(google-explicit-constructor)
+            : _pools{other._pools} {}
+
+        auto allocate(std::size_t n) -> T * {
+            static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned node type");
+            if (n != 1) return static_cast<T *>(::operator new(n * sizeof(T)));
+            return static_cast<T *>(this->pool().allocate());
+        }
+
+        void deallocate(T *ptr, std::size_t n) {
+            if (n != 1) {
+                ::operator delete(ptr);
+                return;
+            }
+            this->pool().deallocate(ptr);
+        }
+
+        template <typename U> auto operator==(const PoolAllocator<U> &other) const -> bool {
+            return this->_pools == other._pools;
+        }
+
+        template <typename U> auto operator!=(const PoolAllocator<U> &other) const -> bool {
+            return !(*this == other);
+        }
+    };
+
+}  // namespace fun
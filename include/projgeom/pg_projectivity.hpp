@@ -0,0 +1,343 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include "pg_parallel.hpp"
+#include "pg_wide.hpp"
+
+/** @file include/pg_projectivity.hpp
+ *  This is a C++ Library header.
+ *
+ *  Projectivities between lines as integer 2x2 matrices. A point X = u A + v B
+ *  of a line is given by its chart coordinates (u, v) relative to two points
+ *  A, B of the line; a projectivity maps (u, v) to M (u, v)^T. Perspectivities
+ *  are linear in X, so projecting from a center is exactly a matrix, and a
+ *  chain of perspectivities collapses into one matrix product.
+ *
+ *  Products run in 128-bit arithmetic and every result is reduced by its gcd
+ *  before being narrowed back to int64 (std::overflow_error if it does not
+ *  fit). Exactness needs the intermediate products to stay below 2^127, which
+ *  holds for coordinates below 2^15 in `perspectivity` and 2^20 in
+ *  `from_pairs`.
+ */
+
+namespace fun {
+
+    /**
+     * @brief Projectivity of the projective line, [[a, b], [c, d]]
+     *
+     */
+    class Projectivity1D {
+      public:
+        std::array<int64_t, 4> mat;  ///< a, b, c, d (row-major)
+
+        /**
+         * @brief Construct a new Projectivity1D object
+         *
+         * @param[in] mat a, b, c, d (row-major)
+         */
+        constexpr explicit Projectivity1D(const std::array<int64_t, 4> &mat) : mat{mat} {}
+
+        static constexpr auto identity() -> Projectivity1D { return Projectivity1D{{1, 0, 0, 1}}; }
+
+        /**
+         * @brief The projectivity sending x_i to y_i (i = 1, 2, 3)
+         *
+         * Let M_x send e1, e2, e1 + e2 to x1, x2, x3 (up to scale); then the
+         * map is M_y adj(M_x).
+         *
+         * @param[in] x three distinct points of the source line
+         * @param[in] y three distinct points of the target line
+         * @return Projectivity1D
+         * @exception std::invalid_argument if the x_i or the y_i are not distinct
+         */
+        static auto from_pairs(const std::array<std::array<int64_t, 2>, 3> &x,
+                               const std::array<std::array<int64_t, 2>, 3> &y)
+            -> Projectivity1D {
+            const auto m_x = Projectivity1D{frame(x)};
+            const auto m_y = Projectivity1D{frame(y)};
+            return m_y.compose(m_x.inverse());
+        }
+
+        /**
+         * @brief Determinant ad - bc (zero for a degenerate map)
+         *
+         * @return int128_t
+         */
+        auto det() const -> int128_t {
+            return mul_wide(this->mat[0], this->mat[3]) - mul_wide(this->mat[1], this->mat[2]);
+        }
+
+        /**
+         * @brief Image of a point given by chart coordinates
+         *
+         * @param[in] uv
+         * @return std::array<int64_t, 2> reduced
+         */
+        auto apply(const std::array<int64_t, 2> &uv) const -> std::array<int64_t, 2> {
+            const auto &[a, b, c, d] = this->mat;
+            return narrow_reduced(std::array<int128_t, 2>{mul_wide(a, uv[0]) + mul_wide(b, uv[1]),
+                                                          mul_wide(c, uv[0]) + mul_wide(d, uv[1])});
+        }
+
+        /**
+         * @brief This map after `other`, i.e. x -> this(other(x))
+         *
+         * @param[in] other
+         * @return Projectivity1D reduced
+         */
+        auto compose(const Projectivity1D &other) const -> Projectivity1D {
+            const auto &[a, b, c, d] = this->mat;
+            const auto &[e, f, g, h] = other.mat;
+            return Projectivity1D{narrow_reduced(
+                std::array<int128_t, 4>{mul_wide(a, e) + mul_wide(b, g),
+                                        mul_wide(a, f) + mul_wide(b, h),
+                                        mul_wide(c, e) + mul_wide(d, g),
+                                        mul_wide(c, f) + mul_wide(d, h)},
+                true)};
+        }
+
+        /**
+         * @brief Inverse map, the adjugate [[d, -b], [-c, a]]
+         *
+         * @return Projectivity1D
+         * @exception std::overflow_error if an entry is INT64_MIN
+         */
+        auto inverse() const -> Projectivity1D {
+            const auto &[a, b, c, d] = this->mat;
+            return Projectivity1D{narrow_reduced(
+                std::array<int128_t, 4>{int128_t(d), -int128_t(b), -int128_t(c), int128_t(a)},
+                true)};
+        }
+
+        /**
+         * @brief Equality as projective maps (proportional matrices)
+         *
+         * @param[in] other
+         * @return true
+         * @return false
+         */
+        auto operator==(const Projectivity1D &other) const -> bool {
+            for (std::size_t i = 0; i != 4; ++i) {
+                for (std::size_t j = i + 1; j != 4; ++j) {
+                    if (mul_wide(this->mat[i], other.mat[j])
+                        != mul_wide(this->mat[j], other.mat[i])) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        auto operator!=(const Projectivity1D &other) const -> bool { return !(*this == other); }
+
+        /**
+         * @brief Apply the map to many points (SoA chart coordinates)
+         *
+         * Each chunk first bounds its inputs; when no product can leave int64
+         * it runs a plain multiply-add loop that vectorizes. Otherwise points
+         * are mapped one at a time in 128-bit arithmetic, and reduced only if
+         * needed to fit. Outputs are projectively, not literally, reduced.
+         *
+         * @param[in] u
+         * @param[in] v
+         * @param[in] count
+         * @param[out] out_u may equal `u`
+         * @param[out] out_v may equal `v`
+         * @param[in] grain points per chunk
+         * @exception std::overflow_error if a reduced image does not fit
+         */
+        void apply_batch(const int64_t *u, const int64_t *v, std::size_t count, int64_t *out_u,
+                         int64_t *out_v, std::size_t grain = 4096) const {
+            const auto a = this->mat[0];
+            const auto b = this->mat[1];
+            const auto c = this->mat[2];
+            const auto d = this->mat[3];
+            const auto row = std::max(abs_wide(a) + abs_wide(b), abs_wide(c) + abs_wide(d));
+            const auto limit = int128_t(std::numeric_limits<int64_t>::max());
+            parallel_for(count, grain, [&](std::size_t begin, std::size_t end) {
+                auto lo = int64_t{0};
+                auto hi = int64_t{0};
+                for (auto i = begin; i != end; ++i) {
+                    lo = std::min(lo, std::min(u[i], v[i]));
+                    hi = std::max(hi, std::max(u[i], v[i]));
+                }
+                const auto bound = std::max(abs_wide(lo), abs_wide(hi));
+                if (row == int128_t(0) || bound <= limit / row) {
+                    for (auto i = begin; i != end; ++i) {
+                        const auto ui = u[i];
+                        const auto vi = v[i];
+                        out_u[i] = a * ui + b * vi;
+                        out_v[i] = c * ui + d * vi;
+                    }
+                    return;
+                }
+                for (auto i = begin; i != end; ++i) {
+                    const auto wu = mul_wide(a, u[i]) + mul_wide(b, v[i]);
+                    const auto wv = mul_wide(c, u[i]) + mul_wide(d, v[i]);
+                    if (abs_wide(wu) <= limit && abs_wide(wv) <= limit) {
+                        out_u[i] = static_cast<int64_t>(wu);
+                        out_v[i] = static_cast<int64_t>(wv);
+                    } else {
+                        const auto r = narrow_reduced(std::array<int128_t, 2>{wu, wv});
+                        out_u[i] = r[0];
+                        out_v[i] = r[1];
+                    }
+                }
+            });
+        }
+
+      private:
+        static auto abs_wide(const int128_t &x) -> int128_t { return x < int128_t(0) ? -x : x; }
+
+        static auto det2(const std::array<int64_t, 2> &p, const std::array<int64_t, 2> &q)
+            -> int128_t {
+            return mul_wide(p[0], q[1]) - mul_wide(p[1], q[0]);
+        }
+
+        /**
+         * @brief Matrix with columns det(p3, p2) p1 and det(p1, p3) p2
+         *
+         */
+        static auto frame(const std::array<std::array<int64_t, 2>, 3> &p)
+            -> std::array<int64_t, 4> {
+            const auto zero = int128_t(0);
+            const auto s = det2(p[2], p[1]);
+            const auto t = det2(p[0], p[2]);
+            if (det2(p[0], p[1]) == zero || s == zero || t == zero) {
+                throw std::invalid_argument("Projectivity1D: the three points must be distinct");
+            }
+            return narrow_reduced(std::array<int128_t, 4>{s * int128_t(p[0][0]),
+                                                          t * int128_t(p[1][0]),
+                                                          s * int128_t(p[0][1]),
+                                                          t * int128_t(p[1][1])});
+        }
+    };
+
+    /**
+     * @brief Chart coordinates on the line through two points
+     *
+     * X = u A + v B; with n = A x B, X x B = u n and A x X = v n, so one
+     * component of each cross product gives (u, v) up to the common factor
+     * n_k. The raw coordinates are linear in X.
+     *
+     * @tparam Point
+     */
+    template <class Point> class LineChart {
+      private:
+        Point _pt_a;
+        Point _pt_b;
+        std::size_t _k{0};  // index of the largest |n_k|
+
+      public:
+        /**
+         * @brief Construct a new Line Chart object
+         *
+         * @param[in] pt_a point with coordinates (1, 0)
+         * @param[in] pt_b point with coordinates (0, 1)
+         * @exception std::invalid_argument if the points coincide
+         */
+        LineChart(const Point &pt_a, const Point &pt_b) : _pt_a{pt_a}, _pt_b{pt_b} {
+            const auto n = cross_wide(pt_a.coord, pt_b.coord);
+            for (std::size_t i = 1; i != 3; ++i) {
+                const auto ni = n[i] < int128_t(0) ? -n[i] : n[i];
+                const auto nk = n[this->_k] < int128_t(0) ? -n[this->_k] : n[this->_k];
+                if (ni > nk) this->_k = i;
+            }
+            if (n[this->_k] == int128_t(0)) {
+                throw std::invalid_argument("LineChart: the two points coincide");
+            }
+        }
+
+        auto first() const -> const Point & { return this->_pt_a; }
+        auto second() const -> const Point & { return this->_pt_b; }
+
+        /**
+         * @brief The carrier line A x B
+         *
+         * @return Point::Dual
+         */
+        auto line() const -> typename Point::Dual { return this->_pt_a.meet(this->_pt_b); }
+
+        /**
+         * @brief Unreduced chart coordinates, n_k (u, v)
+         *
+         * @param[in] x a point on the line
+         * @return std::array<int128_t, 2>
+         */
+        auto raw(const std::array<int128_t, 3> &x) const -> std::array<int128_t, 2> {
+            const auto i = (this->_k + 1) % 3;
+            const auto j = (this->_k + 2) % 3;
+            const auto &pa = this->_pt_a.coord;
+            const auto &pb = this->_pt_b.coord;
+            return {x[i] * int128_t(pb[j]) - x[j] * int128_t(pb[i]),
+                    int128_t(pa[i]) * x[j] - int128_t(pa[j]) * x[i]};
+        }
+
+        /**
+         * @brief Chart coordinates of a point on the line
+         *
+         * @param[in] pt
+         * @return std::array<int64_t, 2> reduced
+         */
+        auto coords(const Point &pt) const -> std::array<int64_t, 2> {
+            const auto &c = pt.coord;
+            return narrow_reduced(this->raw({int128_t(c[0]), int128_t(c[1]), int128_t(c[2])}));
+        }
+
+        /**
+         * @brief The point u A + v B
+         *
+         * @param[in] uv
+         * @return Point reduced
+         */
+        auto point(const std::array<int64_t, 2> &uv) const -> Point {
+            auto x = std::array<int128_t, 3>{};
+            for (std::size_t i = 0; i != 3; ++i) {
+                x[i] = mul_wide(uv[0], this->_pt_a.coord[i])
+                       + mul_wide(uv[1], this->_pt_b.coord[i]);
+            }
+            return Point{narrow_reduced(x)};
+        }
+    };
+
+    /**
+     * @brief Perspectivity from one line to another with the given center
+     *
+     * X maps to (O x X) x m, where m is the target line. The images of the
+     * two chart points are scaled together, which keeps the matrix exact.
+     *
+     * @tparam Point
+     * @param[in] center
+     * @param[in] from chart of the source line
+     * @param[in] to chart of the target line
+     * @return Projectivity1D from `from` coordinates to `to` coordinates
+     * @exception std::invalid_argument if the center lies on either line
+     */
+    template <class Point>
+    auto perspectivity(const Point &center, const LineChart<Point> &from,
+                       const LineChart<Point> &to) -> Projectivity1D {
+        if (center.incident(from.line()) || center.incident(to.line())) {
+            throw std::invalid_argument("perspectivity: center lies on a line");
+        }
+        const auto joined = [](const std::array<int128_t, 3> &p, const std::array<int128_t, 3> &q) {
+            return narrow_reduced(std::array<int128_t, 6>{p[0], p[1], p[2], q[0], q[1], q[2]});
+        };
+        const auto rays = joined(cross_wide(center.coord, from.first().coord),
+                                 cross_wide(center.coord, from.second().coord));
+        const auto m = to.line().coord;
+        const auto images = joined(cross_wide({rays[0], rays[1], rays[2]}, m),
+                                   cross_wide({rays[3], rays[4], rays[5]}, m));
+        const auto col_a = to.raw({int128_t(images[0]), int128_t(images[1]), int128_t(images[2])});
+        const auto col_b = to.raw({int128_t(images[3]), int128_t(images[4]), int128_t(images[5])});
+        return Projectivity1D{
+            narrow_reduced(std::array<int128_t, 4>{col_a[0], col_b[0], col_a[1], col_b[1]}, true)};
+    }
+
+}  // namespace fun
@@ -0,0 +1,309 @@
+#pragma once
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#    include <sys/socket.h>
+#    include <sys/un.h>
+#    include <unistd.h>
+#    define PROJGEOM_HAS_UNIX_SOCKETS 1
+#endif
+
+/** @file include/pg_protocol.hpp
+ *  This is a C++ Library header.
+ *
+ *  Wire format of the geometry query daemon. Every message, request or
+ *  response, is a 16-byte header
+ *
+ *      magic "PGQ1" | op (u16) | status (u16) | id (u32) | words (u32)
+ *
+ *  followed by `words` int64 values in host byte order (the daemon only
+ *  listens on a local socket). Responses echo the op and id of their
+ *  request, so a client may pipeline several requests on one connection.
+ *
+ *  Request and response payloads:
+ *
+ *  - Incident:  line (3)              -> ids of the loaded points on it
+ *  - Meet:      point, point (6)      -> the line through them (3)
+ *  - Nearest:   point (3), k (1)      -> ids of the k nearest loaded points
+ *  - Collinear: point, point, point   -> 1 or 0
+ *  - Locate:    point (3)             -> Location of the point (0, 1, 2)
+ *  - Stats:     nothing               -> QueryStats::to_words()
+ *
+ *  Meet also accepts two lines and answers their common point.
+ */
+
+namespace fun {
+
+    enum class QueryOp : uint16_t {
+        Incident = 1,
+        Meet = 2,
+        Nearest = 3,
+        Collinear = 4,
+        Locate = 5,
+        Stats = 6
+    };
+
+    constexpr std::size_t NUM_QUERY_OPS = 6;
+
+    enum class QueryStatus : uint16_t {
+        Ok = 0,
+        BadRequest = 1,   ///< unknown op or malformed payload
+        Unavailable = 2,  ///< the dataset for this op is not loaded
+        TooLarge = 3,     ///< the answer exceeds QueryHeader::MAX_WORDS
+    };
+
+    /**
+     * @brief Header of a request or response
+     *
+     */
+    struct QueryHeader {
+        static constexpr std::array<char, 4> MAGIC{'P', 'G', 'Q', '1'};
+        static constexpr uint32_t MAX_WORDS = 1U << 24;
+
+        std::array<char, 4> magic = MAGIC;
+        uint16_t op = 0;
+        uint16_t status = 0;
+        uint32_t id = 0;
+        uint32_t words = 0;
+    };
+
+    static_assert(sizeof(QueryHeader) == 16, "QueryHeader must be 16 bytes");
+
+    /**
+     * @brief Payload length of a request, or -1 if the op is unknown
+     *
+     * @param[in] op
+     * @return int
+     */
+    inline auto request_words(uint16_t op) -> int {
+        switch (static_cast<QueryOp>(op)) {
+            case QueryOp::Incident: return 3;
+            case QueryOp::Meet: return 6;
+            case QueryOp::Nearest: return 4;
+            case QueryOp::Collinear: return 9;
+            case QueryOp::Locate: return 3;
+            case QueryOp::Stats: return 0;
+        }
+        return -1;
+    }
+
+    /**
+     * @brief Server counters, as answered to a Stats request
+     *
+     * Latencies run from the arrival of a request to the completion of its
+     * batch; percentiles are upper bounds of power-of-two buckets.
+     */
+    struct QueryStats {
+        uint64_t requests = 0;
+        uint64_t batches = 0;
+        uint64_t errors = 0;
+        uint64_t uptime_ns = 0;
+        uint64_t p50_ns = 0;
+        uint64_t p90_ns = 0;
+        uint64_t p99_ns = 0;
+        uint64_t max_ns = 0;
+        std::array<uint64_t, NUM_QUERY_OPS> per_op{};
+
+        static constexpr std::size_t WORDS = 8 + NUM_QUERY_OPS;
+
+        /// requests per second since the server started
+        auto throughput() const -> double {
+            return this->uptime_ns == 0 ? 0.0
+                                        : 1e9 * static_cast<double>(this->requests)
+                                              / static_cast<double>(this->uptime_ns);
+        }
+
+        auto to_words() const -> std::vector<int64_t> {
+            auto words = std::vector<int64_t>{};
+            for (const auto v : {this->requests, this->batches, this->errors, this->uptime_ns,
+                                 this->p50_ns, this->p90_ns, this->p99_ns, this->max_ns}) {
+                words.push_back(static_cast<int64_t>(v));
+            }
+            for (const auto v : this->per_op) words.push_back(static_cast<int64_t>(v));
+            return words;
+        }
+
+        static auto from_words(const std::vector<int64_t> &words) -> QueryStats {
+            if (words.size() != WORDS) throw std::runtime_error("malformed stats payload");
+            auto stats = QueryStats{};
+            auto fields = std::array<uint64_t *, 8>{
+                &stats.requests, &stats.batches, &stats.errors, &stats.uptime_ns,
+                &stats.p50_ns,   &stats.p90_ns,  &stats.p99_ns, &stats.max_ns};
+            for (std::size_t i = 0; i != fields.size(); ++i) {
+                *fields[i] = static_cast<uint64_t>(words[i]);
+            }
+            for (std::size_t i = 0; i != NUM_QUERY_OPS; ++i) {
+                stats.per_op[i] = static_cast<uint64_t>(words[8 + i]);
+            }
+            return stats;
+        }
+    };
+
+#ifdef PROJGEOM_HAS_UNIX_SOCKETS
+    namespace detail {
+        inline auto write_fully(int fd, const void *data, std::size_t size) -> bool {
+            const auto *p = static_cast<const char *>(data);
+            while (size != 0) {
+#    ifdef MSG_NOSIGNAL
+                const auto n = ::send(fd, p, size, MSG_NOSIGNAL);
+#    else
+                const auto n = ::write(fd, p, size);
+#    endif
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) return false;
+                p += n;
+                size -= static_cast<std::size_t>(n);
+            }
+            return true;
+        }
+
+        /// false on end of stream before the first byte
+        inline auto read_fully(int fd, void *data, std::size_t size) -> bool {
+            auto *p = static_cast<char *>(data);
+            auto got = std::size_t{0};
+            while (got != size) {
+                const auto n = ::read(fd, p + got, size - got);
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0) throw std::runtime_error("query socket read failed");
+                if (n == 0) {
+                    if (got == 0) return false;
+                    throw std::runtime_error("truncated query message");
+                }
+                got += static_cast<std::size_t>(n);
+            }
+            return true;
+        }
+    }  // namespace detail
+
+    /**
+     * @brief Send one message
+     *
+     * @param[in] fd connected socket
+     * @param[in] header `words` must match the payload
+     * @param[in] words
+     * @return false if the peer is gone
+     */
+    inline auto write_message(int fd, const QueryHeader &header, const int64_t *words) -> bool {
+        return detail::write_fully(fd, &header, sizeof(header))
+               && (header.words == 0
+                   || detail::write_fully(fd, words, header.words * sizeof(int64_t)));
+    }
+
+    /**
+     * @brief Receive one message
+     *
+     * @param[in] fd connected socket
+     * @param[out] header
+     * @param[out] words
+     * @return false at the end of the stream
+     * @exception std::runtime_error on a malformed or truncated message
+     */
+    inline auto read_message(int fd, QueryHeader &header, std::vector<int64_t> &words) -> bool {
+        if (!detail::read_fully(fd, &header, sizeof(header))) return false;
+        if (header.magic != QueryHeader::MAGIC || header.words > QueryHeader::MAX_WORDS) {
+            throw std::runtime_error("malformed query message");
+        }
+        words.resize(header.words);
+        if (header.words != 0 && !detail::read_fully(fd, words.data(), words.size() * 8)) {
+            throw std::runtime_error("truncated query message");
+        }
+        return true;
+    }
+
+    /**
+     * @brief Blocking client of the query daemon
+     *
+     */
+    class QueryClient {
+      private:
+        int _fd{-1};
+        uint32_t _next_id{0};
+
+      public:
+        /**
+         * @brief Connect to a daemon
+         *
+         * @param[in] socket_path
+         * @exception std::runtime_error if the daemon is not reachable
+         */
+        explicit QueryClient(const std::string &socket_path) {
+            auto addr = sockaddr_un{};
+            if (socket_path.size() >= sizeof(addr.sun_path)) {
+                throw std::runtime_error("socket path too long: " + socket_path);
+            }
+            addr.sun_family = AF_UNIX;
+            std::memcpy(addr.sun_path, socket_path.c_str(), socket_path.size() + 1);
+            this->_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (this->_fd < 0
+                || ::connect(this->_fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr))
+                       != 0) {
+                if (this->_fd >= 0) ::close(this->_fd);
+                throw std::runtime_error("cannot connect to " + socket_path);
+            }
+        }
+
+        QueryClient(const QueryClient &) = delete;
+        auto operator=(const QueryClient &) -> QueryClient & = delete;
+
+        ~QueryClient() { ::close(this->_fd); }
+
+        /**
+         * @brief Send a request without waiting for the answer
+         *
+         * @param[in] op
+         * @param[in] words
+         * @return uint32_t id of the request
+         */
+        auto send(QueryOp op, const std::vector<int64_t> &words) -> uint32_t {
+            auto header = QueryHeader{};
+            header.op = static_cast<uint16_t>(op);
+            header.id = this->_next_id++;
+            header.words = static_cast<uint32_t>(words.size());
+            if (!write_message(this->_fd, header, words.data())) {
+                throw std::runtime_error("query daemon closed the connection");
+            }
+            return header.id;
+        }
+
+        /**
+         * @brief Wait for the next response
+         *
+         * @param[out] words
+         * @return QueryHeader
+         */
+        auto receive(std::vector<int64_t> &words) -> QueryHeader {
+            auto header = QueryHeader{};
+            if (!read_message(this->_fd, header, words)) {
+                throw std::runtime_error("query daemon closed the connection");
+            }
+            return header;
+        }
+
+        /**
+         * @brief Send a request and wait for its response
+         *
+         * @param[in] op
+         * @param[in] words
+         * @return std::pair<QueryStatus, std::vector<int64_t>>
+         */
+        auto call(QueryOp op, const std::vector<int64_t> &words)
+            -> std::pair<QueryStatus, std::vector<int64_t>> {
+            const auto id = this->send(op, words);
+            auto result = std::vector<int64_t>{};
+            auto header = this->receive(result);
+            while (header.id != id) header = this->receive(result);
+            return {static_cast<QueryStatus>(header.status), std::move(result)};
+        }
+    };
+#endif
+
+}  // namespace fun
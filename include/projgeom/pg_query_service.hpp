@@ -0,0 +1,357 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "pg_binary_io.hpp"
+#include "pg_incidence_join.hpp"
+#include "pg_mapped_index.hpp"
+#include "pg_object.hpp"
+#include "pg_parallel.hpp"
+#include "pg_polygon.hpp"
+#include "pg_protocol.hpp"
+#include "pg_trace.hpp"
+#include "pg_wide.hpp"
+
+/** @file include/pg_query_service.hpp
+ *  This is a C++ Library header.
+ *
+ *  The engine behind the query daemon: warm datasets (points, a polygon and
+ *  a mapped grid index) and batch execution of protocol requests. A batch
+ *  is split by op so that each op runs once over all of its requests: the
+ *  Incident queries of a batch become the lines of a single incidence join
+ *  over the points (tiled once, when they are loaded), Locate queries go
+ *  through `locate_batch`, and the remaining ops run in parallel. The
+ *  transport lives in the standalone daemon; this class knows nothing about
+ *  sockets.
+ */
+
+namespace fun {
+
+    /**
+     * @brief A request as queued by the transport
+     *
+     */
+    struct QueryRequest {
+        QueryHeader header;
+        std::vector<int64_t> words;
+        std::chrono::steady_clock::time_point received = std::chrono::steady_clock::now();
+    };
+
+    /**
+     * @brief A response; the header echoes the op and id of the request
+     *
+     */
+    struct QueryResponse {
+        QueryHeader header;
+        std::vector<int64_t> words;
+    };
+
+    /**
+     * @brief Warm datasets and batched request execution
+     *
+     * `execute` may be called from one thread at a time; the datasets must
+     * be loaded before serving.
+     */
+    class QueryService {
+      public:
+        using Coord = std::array<int64_t, 3>;
+
+      private:
+        static constexpr std::size_t BUCKETS = 64;  // latency histogram, log2(ns)
+
+        std::vector<PgPoint> _points;
+        std::unique_ptr<PointTiles<PgPoint>> _tiles;  // of _points, shared by all batches
+        std::unique_ptr<PolygonIndex<PgPoint>> _polygon;
+        std::unique_ptr<MappedGridIndex> _grid;
+
+        std::chrono::steady_clock::time_point _started = std::chrono::steady_clock::now();
+        mutable std::mutex _stats_mutex;
+        QueryStats _stats;
+        std::array<uint64_t, BUCKETS> _histogram{};
+
+        static auto coord_at(const std::vector<int64_t> &words, std::size_t at) -> Coord {
+            return {words[at], words[at + 1], words[at + 2]};
+        }
+
+        static auto is_zero(const Coord &c) -> bool { return c[0] == 0 && c[1] == 0 && c[2] == 0; }
+
+        /// reduced by the gcd with the last non-zero entry positive; zero if that overflows
+        static auto reduced(const Coord &c) -> Coord {
+            try {
+                return narrow_reduced<3>(
+                    std::array<int128_t, 3>{int128_t(c[0]), int128_t(c[1]), int128_t(c[2])});
+            } catch (const std::overflow_error &) {
+                return Coord{};
+            }
+        }
+
+        static auto bucket_of(uint64_t ns) -> std::size_t {
+            auto b = std::size_t{0};
+            while (b + 1 < BUCKETS && (uint64_t{1} << b) < ns) ++b;
+            return b;
+        }
+
+        auto percentile(double q) const -> uint64_t {
+            const auto total = this->_stats.requests;
+            if (total == 0) return 0;
+            auto need = static_cast<uint64_t>(q * static_cast<double>(total));
+            need = std::max<uint64_t>(need, 1);
+            auto seen = uint64_t{0};
+            for (std::size_t b = 0; b != BUCKETS; ++b) {
+                seen += this->_histogram[b];
+                if (seen >= need) return std::min(uint64_t{1} << b, this->_stats.max_ns);
+            }
+            return this->_stats.max_ns;
+        }
+
+        /**
+         * @brief Execute a request whose op needs no shared pass
+         *
+         */
+        void execute_single(const QueryRequest &request, QueryResponse &response) const {
+            const auto &w = request.words;
+            auto &status = response.header.status;
+            try {
+                switch (static_cast<QueryOp>(request.header.op)) {
+                    case QueryOp::Meet: {
+                        const auto a = coord_at(w, 0);
+                        const auto b = coord_at(w, 3);
+                        const auto m = narrow_reduced<3>(cross_wide(a, b));
+                        response.words.assign(m.begin(), m.end());
+                        break;
+                    }
+                    case QueryOp::Collinear: {
+                        const auto ln
+                            = narrow_reduced<3>(cross_wide(coord_at(w, 0), coord_at(w, 3)));
+                        const auto on = is_zero(ln) || sign_of(dot_wide(ln, coord_at(w, 6))) == 0;
+                        response.words.assign(1, on ? 1 : 0);
+                        break;
+                    }
+                    case QueryOp::Nearest: {
+                        const auto p = coord_at(w, 0);
+                        if (!this->_grid) {
+                            status = static_cast<uint16_t>(QueryStatus::Unavailable);
+                            break;
+                        }
+                        if (p[2] == 0 || w[3] < 0) {
+                            status = static_cast<uint16_t>(QueryStatus::BadRequest);
+                            break;
+                        }
+                        const auto x = static_cast<double>(p[0]) / static_cast<double>(p[2]);
+                        const auto y = static_cast<double>(p[1]) / static_cast<double>(p[2]);
+                        const auto k = static_cast<std::size_t>(
+                            std::min<int64_t>(w[3], static_cast<int64_t>(QueryHeader::MAX_WORDS)));
+                        for (const auto e : this->_grid->nearest(x, y, k)) {
+                            response.words.push_back(static_cast<int64_t>(this->_grid->id(e)));
+                        }
+                        break;
+                    }
+                    default: status = static_cast<uint16_t>(QueryStatus::BadRequest);
+                }
+            } catch (const std::overflow_error &) {
+                response.words.clear();
+                status = static_cast<uint16_t>(QueryStatus::BadRequest);
+            }
+        }
+
+        void execute_incident(const std::vector<QueryRequest> &batch,
+                              const std::vector<std::size_t> &which,
+                              std::vector<QueryResponse> &responses) const {
+            PG_TRACE_SCOPE("query_service", "incident");
+            auto lines = std::vector<PgLine>{};
+            auto owner = std::vector<std::size_t>{};
+            for (const auto i : which) {
+                const auto ln = coord_at(batch[i].words, 0);
+                if (is_zero(ln)) {
+                    responses[i].header.status = static_cast<uint16_t>(QueryStatus::BadRequest);
+                    continue;
+                }
+                if (!this->_tiles) {
+                    responses[i].header.status = static_cast<uint16_t>(QueryStatus::Unavailable);
+                    continue;
+                }
+                lines.emplace_back(PgLine(ln));
+                owner.push_back(i);
+            }
+            if (lines.empty()) return;
+            const auto join = IncidenceJoin<PgPoint>(std::move(lines));
+            join.run(*this->_tiles, [&](const IncidencePair &pair) {
+                // one word past the limit marks the answer as too large
+                auto &words = responses[owner[pair.line]].words;
+                if (words.size() <= QueryHeader::MAX_WORDS) {
+                    words.push_back(static_cast<int64_t>(pair.point));
+                }
+            });
+            for (const auto i : owner) {
+                std::sort(responses[i].words.begin(), responses[i].words.end());
+            }
+        }
+
+        void execute_locate(const std::vector<QueryRequest> &batch,
+                            const std::vector<std::size_t> &which,
+                            std::vector<QueryResponse> &responses) const {
+            PG_TRACE_SCOPE("query_service", "locate");
+            auto points = std::vector<PgPoint>{};
+            auto owner = std::vector<std::size_t>{};
+            for (const auto i : which) {
+                // the polygon kernel is exact only below 2^20; a reduced
+                // representative may be in range when the query is not
+                const auto pt = reduced(coord_at(batch[i].words, 0));
+                if (pt[2] == 0 || !within_polygon_range(pt)) {
+                    responses[i].header.status = static_cast<uint16_t>(QueryStatus::BadRequest);
+                    continue;
+                }
+                points.emplace_back(PgPoint(pt));
+                owner.push_back(i);
+            }
+            auto where = std::vector<Location>(points.size());
+            this->_polygon->locate_batch(points.begin(), points.end(), where.data());
+            for (std::size_t j = 0; j != owner.size(); ++j) {
+                responses[owner[j]].words.assign(1, static_cast<int64_t>(where[j]));
+            }
+        }
+
+      public:
+        QueryService() = default;
+
+        /// Points answered by Incident (ids are positions in this vector); tiled once here
+        void set_points(std::vector<PgPoint> points) {
+            this->_points = std::move(points);
+            this->_tiles = std::make_unique<PointTiles<PgPoint>>(this->_points);
+        }
+
+        /// Polygon answered by Locate (at least three affine vertices, reduced below 2^20)
+        void set_polygon(const std::vector<PgPoint> &ring) {
+            if (ring.size() < 3) throw std::invalid_argument("polygon needs three vertices");
+            auto vertices = std::vector<PgPoint>{};
+            vertices.reserve(ring.size());
+            for (const auto &pt : ring) {
+                const auto c = reduced(pt.coord);
+                if (c[2] == 0 && !is_zero(c)) {
+                    throw std::invalid_argument("polygon vertex at infinity");
+                }
+                if (is_zero(c) || !within_polygon_range(c)) {
+                    throw std::invalid_argument("polygon vertex out of range");
+                }
+                vertices.emplace_back(PgPoint(c));
+            }
+            this->_polygon = std::make_unique<PolygonIndex<PgPoint>>(vertices);
+        }
+
+        /// Mapped grid index answered by Nearest (ids are the build input positions)
+        void set_grid(const std::string &path) {
+            this->_grid = std::make_unique<MappedGridIndex>(path);
+        }
+
+        auto points() const -> const std::vector<PgPoint> & { return this->_points; }
+
+        /**
+         * @brief Execute a batch of requests
+         *
+         * @param[in] batch
+         * @return std::vector<QueryResponse> one per request, in order
+         */
+        auto execute(const std::vector<QueryRequest> &batch) -> std::vector<QueryResponse> {
+            PG_TRACE_SCOPE("query_service", "batch");
+            auto responses = std::vector<QueryResponse>(batch.size());
+            auto by_op = std::array<std::vector<std::size_t>, NUM_QUERY_OPS + 1>{};
+            for (std::size_t i = 0; i != batch.size(); ++i) {
+                const auto &header = batch[i].header;
+                responses[i].header.op = header.op;
+                responses[i].header.id = header.id;
+                const auto expected = request_words(header.op);
+                if (expected < 0 || batch[i].words.size() != static_cast<std::size_t>(expected)) {
+                    responses[i].header.status = static_cast<uint16_t>(QueryStatus::BadRequest);
+                    continue;
+                }
+                by_op[header.op].push_back(i);
+            }
+
+            const auto &incident = by_op[static_cast<std::size_t>(QueryOp::Incident)];
+            this->execute_incident(batch, incident, responses);
+            const auto &locate = by_op[static_cast<std::size_t>(QueryOp::Locate)];
+            if (!this->_polygon) {
+                for (const auto i : locate) {
+                    responses[i].header.status = static_cast<uint16_t>(QueryStatus::Unavailable);
+                }
+            } else {
+                this->execute_locate(batch, locate, responses);
+            }
+            auto singles = std::vector<std::size_t>{};
+            for (const auto op : {QueryOp::Meet, QueryOp::Nearest, QueryOp::Collinear}) {
+                const auto &ids = by_op[static_cast<std::size_t>(op)];
+                singles.insert(singles.end(), ids.begin(), ids.end());
+            }
+            parallel_for(singles.size(), 16, [&](std::size_t begin, std::size_t end) {
+                for (auto j = begin; j != end; ++j) {
+                    this->execute_single(batch[singles[j]], responses[singles[j]]);
+                }
+            });
+
+            for (auto &response : responses) {
+                if (response.words.size() > QueryHeader::MAX_WORDS) {
+                    response.words.clear();
+                    response.header.status = static_cast<uint16_t>(QueryStatus::TooLarge);
+                }
+            }
+
+            const auto done = std::chrono::steady_clock::now();
+            std::lock_guard<std::mutex> lock(this->_stats_mutex);
+            ++this->_stats.batches;
+            for (std::size_t i = 0; i != batch.size(); ++i) {
+                const auto ns = static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(done - batch[i].received)
+                        .count());
+                ++this->_stats.requests;
+                ++this->_histogram[bucket_of(ns)];
+                this->_stats.max_ns = std::max(this->_stats.max_ns, ns);
+                const auto op = batch[i].header.op;
+                if (op >= 1 && op <= NUM_QUERY_OPS) ++this->_stats.per_op[op - 1];
+                if (responses[i].header.status != 0) ++this->_stats.errors;
+            }
+            // Stats answers include the batch they arrive in
+            const auto &stats = by_op[static_cast<std::size_t>(QueryOp::Stats)];
+            if (!stats.empty()) {
+                const auto words = this->stats_locked(done).to_words();
+                for (const auto i : stats) responses[i].words = words;
+            }
+            for (auto &response : responses) {
+                response.header.words = static_cast<uint32_t>(response.words.size());
+            }
+            return responses;
+        }
+
+        /**
+         * @brief Current counters
+         *
+         * @return QueryStats
+         */
+        auto stats() const -> QueryStats {
+            std::lock_guard<std::mutex> lock(this->_stats_mutex);
+            return this->stats_locked(std::chrono::steady_clock::now());
+        }
+
+      private:
+        auto stats_locked(std::chrono::steady_clock::time_point now) const -> QueryStats {
+            auto result = this->_stats;
+            result.uptime_ns = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(now - this->_started)
+                    .count());
+            result.p50_ns = this->percentile(0.50);
+            result.p90_ns = this->percentile(0.90);
+            result.p99_ns = this->percentile(0.99);
+            return result;
+        }
+    };
+
+}  // namespace fun
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "pg_canonical.hpp"
+#include "pg_parallel.hpp"
+
+/** @file include/pg_ransac.hpp
+ *  This is a C++ Library header.
+ *
+ *  RANSAC line detection. A hypothesis is `p.meet(q)` for two sampled points;
+ *  inliers are points whose Euclidean distance to it, |dot(p, l)| divided by
+ *  |p_z| sqrt(dot1(l, l)), is within a threshold, or (threshold 0) points that
+ *  are exactly incident. Hypotheses are verified in batches across threads
+ *  with an SPRT (Matas & Chum) early exit. Exact incidence needs coordinates
+ *  below 2^19.
+ */
+
+namespace fun {
+
+    /**
+     * @brief Options for ransac_lines()
+     *
+     */
+    struct RansacOptions {
+        double threshold = 1.0;          ///< inlier distance; 0 selects exact incidence
+        std::size_t min_inliers = 3;     ///< smallest support for an accepted line
+        std::size_t max_lines = 1;       ///< lines extracted one after another
+        std::size_t max_hypotheses = 2000;
+        std::size_t batch = 64;          ///< hypotheses verified per parallel round
+        double confidence = 0.99;        ///< for the adaptive hypothesis count
+        bool sprt = true;                ///< early rejection of bad hypotheses
+        double sprt_delta = 0.05;        ///< chance a point supports a wrong line
+        double sprt_epsilon = 0.1;       ///< initial inlier ratio guess
+        uint64_t seed = 1;
+    };
+
+    /**
+     * @brief A detected line and the indices of its inliers
+     *
+     * @tparam Line
+     */
+    template <class Line> struct RansacLine {
+        Line line;
+        std::vector<std::size_t> inliers;
+    };
+
+    /**
+     * @brief SPRT decision threshold A from A = t_M C / m_S + 1 + ln A
+     *
+     * @param[in] epsilon inlier ratio
+     * @param[in] delta chance a point supports a wrong model
+     * @param[in] t_m cost of a hypothesis relative to one point check
+     * @return double
+     */
+    inline auto sprt_threshold(double epsilon, double delta, double t_m = 200.0) -> double {
+        const auto c = (1 - delta) * std::log((1 - delta) / (1 - epsilon))
+                       + delta * std::log(delta / epsilon);
+        const auto base = t_m * c + 1;
+        auto a = base;
+        for (int i = 0; i != 10; ++i) a = base + std::log(a);
+        return a;
+    }
+
+    /**
+     * @brief RANSAC line detector over affine points
+     *
+     * @tparam Point
+     * @tparam Line
+     */
+    template <class Point, class Line = typename Point::Dual> class RansacDetector {
+      private:
+        static constexpr std::size_t BLOCK = 64;  // points between SPRT checks
+
+        const std::vector<Point> &_points;
+        RansacOptions _opts;
+        // SoA copy of the active points in a fixed random order
+        std::vector<std::size_t> _ids;
+        std::vector<int64_t> _ix, _iy, _iz;
+        std::vector<double> _x, _y, _z, _zz;
+
+        void load(const std::vector<std::size_t> &ids) {
+            this->_ids = ids;
+            const auto n = ids.size();
+            this->_ix.resize(n);
+            this->_iy.resize(n);
+            this->_iz.resize(n);
+            this->_x.resize(n);
+            this->_y.resize(n);
+            this->_z.resize(n);
+            this->_zz.resize(n);
+            for (std::size_t k = 0; k != n; ++k) {
+                const auto &c = this->_points[ids[k]].coord;
+                this->_ix[k] = c[0];
+                this->_iy[k] = c[1];
+                this->_iz[k] = c[2];
+                this->_x[k] = static_cast<double>(c[0]);
+                this->_y[k] = static_cast<double>(c[1]);
+                this->_z[k] = static_cast<double>(c[2]);
+                this->_zz[k] = this->_z[k] * this->_z[k];
+            }
+        }
+
+        /**
+         * @brief Inliers among the active points [begin, end)
+         *
+         */
+        auto count(const std::array<int64_t, 3> &ln, std::size_t begin, std::size_t end) const
+            -> std::size_t {
+            std::size_t total = 0;
+            if (this->_opts.threshold == 0) {
+                for (auto k = begin; k != end; ++k) {
+                    const auto d = ln[0] * this->_ix[k] + ln[1] * this->_iy[k]
+                                   + ln[2] * this->_iz[k];
+                    total += d == 0 ? 1 : 0;
+                }
+                return total;
+            }
+            const auto l0 = static_cast<double>(ln[0]);
+            const auto l1 = static_cast<double>(ln[1]);
+            const auto l2 = static_cast<double>(ln[2]);
+            const auto bound = this->_opts.threshold * this->_opts.threshold * (l0 * l0 + l1 * l1);
+            for (auto k = begin; k != end; ++k) {
+                const auto d = l0 * this->_x[k] + l1 * this->_y[k] + l2 * this->_z[k];
+                total += d * d <= bound * this->_zz[k] ? 1 : 0;
+            }
+            return total;
+        }
+
+        /**
+         * @brief Verify one hypothesis, or return 0 if SPRT rejects it
+         *
+         */
+        auto verify(const std::array<int64_t, 3> &ln, double log_a, double epsilon,
+                    double delta) const -> std::size_t {
+            const auto n = this->_ids.size();
+            const auto step_in = std::log(delta / epsilon);
+            const auto step_out = std::log((1 - delta) / (1 - epsilon));
+            std::size_t inliers = 0;
+            for (std::size_t begin = 0; begin < n; begin += BLOCK) {
+                const auto end = std::min(n, begin + BLOCK);
+                inliers += this->count(ln, begin, end);
+                if (!this->_opts.sprt) continue;
+                const auto log_lambda = static_cast<double>(inliers) * step_in
+                                        + static_cast<double>(end - inliers) * step_out;
+                if (log_lambda > log_a) return 0;
+            }
+            return inliers;
+        }
+
+        /**
+         * @brief Hypothesis number `h`: the meet of two sampled active points
+         *
+         */
+        auto hypothesis(uint64_t round, std::size_t h) const -> std::array<int64_t, 3> {
+            auto gen = std::mt19937_64{this->_opts.seed ^ (round * 0x9E3779B97F4A7C15ULL)
+                                       ^ (h * 0xBF58476D1CE4E5B9ULL)};
+            auto pick = std::uniform_int_distribution<std::size_t>{0, this->_ids.size() - 1};
+            const auto i = pick(gen);
+            const auto j = pick(gen);
+            return this->_points[this->_ids[i]].meet(this->_points[this->_ids[j]]).coord;
+        }
+
+        auto best_line(uint64_t round) const -> std::array<int64_t, 3> {
+            const auto n = this->_ids.size();
+            auto epsilon = this->_opts.sprt_epsilon;
+            const auto delta = this->_opts.sprt_delta;
+            auto best = std::array<int64_t, 3>{0, 0, 0};
+            std::size_t best_count = 0;
+            auto needed = this->_opts.max_hypotheses;
+            std::vector<std::array<int64_t, 3>> lines(this->_opts.batch);
+            std::vector<std::size_t> counts(this->_opts.batch);
+            for (std::size_t done = 0; done < needed; done += this->_opts.batch) {
+                const auto log_a = std::log(sprt_threshold(epsilon, std::min(delta, epsilon / 2)));
+                parallel_for(this->_opts.batch, 1, [&](std::size_t begin, std::size_t end) {
+                    for (auto h = begin; h != end; ++h) {
+                        lines[h] = this->hypothesis(round, done + h);
+                        const auto &l = lines[h];
+                        counts[h] = l[0] == 0 && l[1] == 0
+                                        ? 0  // coincident sample or line at infinity
+                                        : this->verify(l, log_a, epsilon,
+                                                       std::min(delta, epsilon / 2));
+                    }
+                });
+                for (std::size_t h = 0; h != this->_opts.batch; ++h) {
+                    if (counts[h] > best_count) {
+                        best_count = counts[h];
+                        best = lines[h];
+                    }
+                }
+                if (best_count < 2) continue;
+                epsilon = std::max(epsilon, static_cast<double>(best_count) / n);
+                if (epsilon >= 1) break;
+                const auto all_in = std::max(1e-12, epsilon * epsilon);
+                const auto k = std::log(1 - this->_opts.confidence) / std::log(1 - all_in);
+                needed = std::min<std::size_t>(this->_opts.max_hypotheses,
+                                               static_cast<std::size_t>(std::ceil(k)));
+            }
+            return best;
+        }
+
+      public:
+        /**
+         * @brief Construct a new Ransac Detector object
+         *
+         * @param[in] points affine points (must outlive the detector)
+         * @param[in] opts
+         */
+        RansacDetector(const std::vector<Point> &points, RansacOptions opts)
+            : _points{points}, _opts{opts} {
+            if (this->_opts.batch == 0) this->_opts.batch = 1;
+        }
+
+        /**
+         * @brief Extract up to max_lines lines, removing inliers after each
+         *
+         * @return std::vector<RansacLine<Line>>
+         */
+        auto run() -> std::vector<RansacLine<Line>> {
+            auto result = std::vector<RansacLine<Line>>{};
+            auto ids = std::vector<std::size_t>(this->_points.size());
+            std::iota(ids.begin(), ids.end(), std::size_t{0});
+            auto gen = std::mt19937_64{this->_opts.seed};
+            std::shuffle(ids.begin(), ids.end(), gen);  // SPRT wants a random order
+
+            for (uint64_t round = 0; round != this->_opts.max_lines; ++round) {
+                if (ids.size() < std::max<std::size_t>(2, this->_opts.min_inliers)) break;
+                this->load(ids);
+                const auto ln = this->best_line(round);
+                if (ln[0] == 0 && ln[1] == 0) break;
+                auto found = RansacLine<Line>{Line{canonical_coord(ln)}, {}};
+                auto rest = std::vector<std::size_t>{};
+                for (std::size_t k = 0; k != ids.size(); ++k) {
+                    (this->count(ln, k, k + 1) != 0 ? found.inliers : rest).push_back(ids[k]);
+                }
+                if (found.inliers.size() < this->_opts.min_inliers) break;
+                std::sort(found.inliers.begin(), found.inliers.end());
+                result.push_back(std::move(found));
+                ids = std::move(rest);
+            }
+            return result;
+        }
+    };
+
+    /**
+     * @brief Detect lines in a point set with RANSAC
+     *
+     * @tparam Point
+     * @param[in] points
+     * @param[in] opts
+     * @return std::vector<RansacLine<typename Point::Dual>>
+     */
+    template <class Point>
+    auto ransac_lines(const std::vector<Point> &points, const RansacOptions &opts = {})
+        -> std::vector<RansacLine<typename Point::Dual>> {
+        return RansacDetector<Point>(points, opts).run();
+    }
+
+}  // namespace fun
@@ -0,0 +1,381 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "pg_binary_io.hpp"
+#include "pg_incidence_join.hpp"
+#include "pg_mapped_index.hpp"
+
+/** @file include/pg_result_cache.hpp
+ *  This is a C++ Library header.
+ *
+ *  A content-addressed cache of batch results on local disk. The key of a
+ *  result hashes the operation name, its parameters and the bytes of its
+ *  input buffers, 64 bits at a time, into two independent 64-bit lanes; the
+ *  result is stored in the binary coordinate format as `<lane 0>.pgr` in the
+ *  cache directory, followed by lane 1 as a digest that a lookup checks.
+ *
+ *  - Writes go to a temporary file that is renamed into place, so readers
+ *    (also in other processes) see either no entry or a complete one.
+ *  - Hits are memory mapped and read in place.
+ *  - A hit refreshes the modification time of its file; when the directory
+ *    grows past its byte budget the least recently used entries go first.
+ *
+ *  The two lanes make an accidental collision unlikely (about 2^-128 per
+ *  pair of inputs), but the hash is not cryptographic: the cache is meant
+ *  for reruns over the same inputs, not as a proof of equality.
+ */
+
+namespace fun {
+
+    /**
+     * @brief Incrementally built content key
+     *
+     * Each word passes through a multiply-xorshift finalizer in both lanes,
+     * so a difference in any bit (also the top one) reaches every bit of the
+     * state. The lanes differ in seed and in how the word enters them.
+     */
+    class ContentKey {
+      private:
+        static constexpr uint64_t GOLDEN = 0x9e3779b97f4a7c15ULL;
+
+        uint64_t _hash{0xcbf29ce484222325ULL};
+        uint64_t _digest{0x6a09e667f3bcc908ULL};
+
+        /// the 64-bit finalizer of MurmurHash3
+        static auto finalize(uint64_t x) -> uint64_t {
+            x ^= x >> 33;
+            x *= 0xff51afd7ed558ccdULL;
+            x ^= x >> 33;
+            x *= 0xc4ceb9fe1a85ec53ULL;
+            x ^= x >> 33;
+            return x;
+        }
+
+        void mix(uint64_t word) {
+            this->_hash = finalize(this->_hash ^ word);
+            this->_digest = finalize((this->_digest + GOLDEN) ^ ((word << 29) | (word >> 35)));
+        }
+
+      public:
+        /**
+         * @brief Hash a buffer, eight bytes at a time
+         *
+         * @param[in] data
+         * @param[in] size
+         * @return ContentKey&
+         */
+        auto add_bytes(const void *data, std::size_t size) -> ContentKey & {
+            const auto *p = static_cast<const uint8_t *>(data);
+            auto i = std::size_t{0};
+            for (; i + 8 <= size; i += 8) {
+                auto word = uint64_t{0};
+                std::memcpy(&word, p + i, 8);
+                this->mix(word);
+            }
+            for (; i != size; ++i) this->mix(p[i]);
+            this->mix(size);  // buffer boundaries are part of the key
+            return *this;
+        }
+
+        auto add(const std::string &text) -> ContentKey & {
+            return this->add_bytes(text.data(), text.size());
+        }
+
+        auto add(int64_t value) -> ContentKey & { return this->add_bytes(&value, sizeof(value)); }
+
+        /**
+         * @brief Hash a buffer of trivially copyable records
+         *
+         * @tparam Record
+         * @param[in] records
+         * @return ContentKey&
+         */
+        template <class Record> auto add_records(const std::vector<Record> &records)
+            -> ContentKey & {
+            return this->add_bytes(records.data(), records.size() * sizeof(Record));
+        }
+
+        /**
+         * @brief Hash the coordinates of points or lines
+         *
+         * @tparam Object
+         * @param[in] objects
+         * @return ContentKey&
+         */
+        template <class Object> auto add_objects(const std::vector<Object> &objects)
+            -> ContentKey & {
+            for (const auto &obj : objects) {
+                for (const auto c : obj.coord) this->mix(static_cast<uint64_t>(c));
+            }
+            this->mix(objects.size());
+            return *this;
+        }
+
+        auto value() const -> uint64_t { return this->_hash; }
+
+        /// the second lane, stored in an entry and checked on lookup
+        auto digest() const -> uint64_t { return this->_digest; }
+
+        /// file name stem: 16 hex digits of the hash
+        auto hex() const -> std::string {
+            static constexpr char digits[] = "0123456789abcdef";
+            auto text = std::string(16, '0');
+            for (std::size_t i = 0; i != 16; ++i) {
+                text[15 - i] = digits[(this->_hash >> (4 * i)) & 15];
+            }
+            return text;
+        }
+    };
+
+    /**
+     * @brief Records of a cache hit, read in place from the mapped file
+     *
+     * @tparam Record
+     */
+    template <class Record> class CachedRecords {
+      private:
+        MappedFile _file;
+        const Record *_data{nullptr};
+        std::size_t _count{0};
+
+      public:
+        CachedRecords(MappedFile file, std::size_t count)
+            : _file{std::move(file)},
+              _data{reinterpret_cast<const Record *>(this->_file.data() + sizeof(FileHeader))},
+              _count{count} {}
+
+        auto size() const -> std::size_t { return this->_count; }
+        auto data() const -> const Record * { return this->_data; }
+        auto begin() const -> const Record * { return this->_data; }
+        auto end() const -> const Record * { return this->_data + this->_count; }
+        auto operator[](std::size_t i) const -> const Record & { return this->_data[i]; }
+
+        auto to_vector() const -> std::vector<Record> { return {this->begin(), this->end()}; }
+    };
+
+    /**
+     * @brief Content-addressed result cache in a local directory
+     *
+     */
+    class ResultCache {
+      private:
+        std::filesystem::path _dir;
+        uint64_t _max_bytes;
+        std::atomic<uint64_t> _hits{0};
+        std::atomic<uint64_t> _misses{0};
+        std::atomic<uint64_t> _sequence{0};
+        uint64_t _salt{std::random_device{}()};  // keeps temporary names unique across processes
+
+        auto entry(const ContentKey &key) const -> std::filesystem::path {
+            return this->_dir / (key.hex() + ".pgr");
+        }
+
+      public:
+        /**
+         * @brief Open (or create) a cache directory
+         *
+         * @param[in] dir
+         * @param[in] max_bytes budget for all entries together
+         */
+        explicit ResultCache(std::filesystem::path dir, uint64_t max_bytes = uint64_t{1} << 30)
+            : _dir{std::move(dir)}, _max_bytes{max_bytes} {
+            std::filesystem::create_directories(this->_dir);
+        }
+
+        auto directory() const -> const std::filesystem::path & { return this->_dir; }
+        auto hits() const -> uint64_t { return this->_hits.load(); }
+        auto misses() const -> uint64_t { return this->_misses.load(); }
+
+        /**
+         * @brief Look up a result
+         *
+         * A damaged entry counts as a miss and is removed; so does an entry
+         * whose digest is not the key's (a collision of the file names).
+         *
+         * @tparam Record trivially copyable
+         * @param[in] key
+         * @param[in] kind record kind the result was stored with
+         * @return std::optional<CachedRecords<Record>>
+         */
+        template <class Record>
+        auto lookup(const ContentKey &key, RecordKind kind)
+            -> std::optional<CachedRecords<Record>> {
+            const auto path = this->entry(key);
+            auto ec = std::error_code{};
+            if (!std::filesystem::exists(path, ec)) {
+                ++this->_misses;
+                return std::nullopt;
+            }
+            try {
+                auto file = MappedFile(path.string());
+                const auto size = file.size();
+                const auto framing = sizeof(FileHeader) + sizeof(uint64_t);  // header, digest
+                auto header = FileHeader{};
+                auto digest = uint64_t{0};
+                if (size >= framing) {
+                    std::memcpy(&header, file.data(), sizeof(header));
+                    std::memcpy(&digest, file.data() + size - sizeof(digest), sizeof(digest));
+                }
+                if (size < framing || header.magic != FileHeader::MAGIC
+                    || header.version != FileHeader::VERSION
+                    || header.kind != static_cast<uint16_t>(kind)
+                    || (size - framing) % sizeof(Record) != 0
+                    || header.count != (size - framing) / sizeof(Record)) {
+                    std::filesystem::remove(path, ec);
+                    ++this->_misses;
+                    return std::nullopt;
+                }
+                if (digest != key.digest()) {  // another input with the same file name
+                    ++this->_misses;
+                    return std::nullopt;
+                }
+                const auto now = std::filesystem::file_time_type::clock::now();
+                std::filesystem::last_write_time(path, now, ec);
+                ++this->_hits;
+                return CachedRecords<Record>(std::move(file),
+                                             static_cast<std::size_t>(header.count));
+            } catch (const std::runtime_error &) {  // evicted by another process meanwhile
+                ++this->_misses;
+                return std::nullopt;
+            }
+        }
+
+        /**
+         * @brief Store a result, then evict down to the budget
+         *
+         * The records are followed by the key's digest.
+         *
+         * @tparam Record
+         * @param[in] key
+         * @param[in] kind
+         * @param[in] records
+         */
+        template <class Record>
+        void store(const ContentKey &key, RecordKind kind, const std::vector<Record> &records) {
+            const auto path = this->entry(key);
+            auto temp = path;
+            const auto thread = std::hash<std::thread::id>{}(std::this_thread::get_id());
+            temp += ".tmp" + std::to_string(thread) + "_"
+                    + std::to_string(this->_salt) + "_"
+                    + std::to_string(this->_sequence++);
+            try {
+                auto writer = RecordWriter<Record>(temp.string(), kind);
+                writer.write(records);
+                writer.close();
+                auto file = detail::open_file(temp.string(), "ab");
+                const auto digest = key.digest();
+                const auto ok = std::fwrite(&digest, sizeof(digest), 1, file.get()) == 1;
+                if (std::fclose(file.release()) != 0 || !ok) {
+                    throw std::runtime_error("cannot write " + temp.string());
+                }
+                std::filesystem::rename(temp, path);
+            } catch (const std::runtime_error &) {
+                auto ec = std::error_code{};
+                std::filesystem::remove(temp, ec);
+                throw;
+            }
+            this->evict();
+        }
+
+        /**
+         * @brief The cached result, or compute, store and return it
+         *
+         * A failure to store (a full disk, say) does not lose the computed
+         * result: it is returned uncached.
+         *
+         * @tparam Record
+         * @tparam Fn callable as fn() -> std::vector<Record>
+         * @param[in] key
+         * @param[in] kind
+         * @param[in] compute
+         * @return std::vector<Record>
+         */
+        template <class Record, class Fn>
+        auto get_or_compute(const ContentKey &key, RecordKind kind, Fn &&compute)
+            -> std::vector<Record> {
+            if (auto hit = this->lookup<Record>(key, kind)) return hit->to_vector();
+            auto records = std::vector<Record>(compute());
+            try {
+                this->store(key, kind, records);
+            } catch (const std::runtime_error &) {  // NOLINT(bugprone-empty-catch)
+                // not cached; std::filesystem::filesystem_error is a runtime_error too
+            }
+            return records;
+        }
+
+        /**
+         * @brief Remove least recently used entries until within budget
+         *
+         */
+        void evict() {
+            auto entries = std::vector<std::pair<std::filesystem::file_time_type,
+                                                 std::pair<std::filesystem::path, uint64_t>>>{};
+            auto total = uint64_t{0};
+            auto ec = std::error_code{};
+            for (const auto &item : std::filesystem::directory_iterator(this->_dir, ec)) {
+                if (item.path().extension() != ".pgr") continue;
+                const auto size = item.file_size(ec);
+                if (ec) continue;
+                const auto time = item.last_write_time(ec);
+                if (ec) continue;
+                entries.push_back({time, {item.path(), size}});
+                total += size;
+            }
+            if (total <= this->_max_bytes) return;
+            std::sort(entries.begin(), entries.end());
+            for (const auto &item : entries) {
+                if (total <= this->_max_bytes) break;
+                if (std::filesystem::remove(item.second.first, ec)) total -= item.second.second;
+            }
+        }
+
+        /**
+         * @brief Remove every entry
+         *
+         */
+        void clear() {
+            auto ec = std::error_code{};
+            for (const auto &item : std::filesystem::directory_iterator(this->_dir, ec)) {
+                if (item.path().extension() == ".pgr") std::filesystem::remove(item.path(), ec);
+            }
+        }
+    };
+
+    /**
+     * @brief `incidence_join` through an optional result cache
+     *
+     * @tparam Point
+     * @tparam Line
+     * @param[in] points
+     * @param[in] lines
+     * @param[in] cache may be null
+     * @return std::vector<IncidencePair>
+     */
+    template <class Point, class Line>
+    auto cached_incidence_join(const std::vector<Point> &points, const std::vector<Line> &lines,
+                               ResultCache *cache) -> std::vector<IncidencePair> {
+        if (cache == nullptr) return incidence_join(points, lines);
+        auto key = ContentKey{};
+        key.add(std::string("incidence_join/1")).add_objects(points).add_objects(lines);
+        return cache->get_or_compute<IncidencePair>(key, RecordKind::IncidencePairs, [&]() {
+            return incidence_join(points, lines);
+        });
+    }
+
+}  // namespace fun
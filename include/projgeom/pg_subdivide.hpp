@@ -0,0 +1,202 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "pg_canonical.hpp"
+#include "pg_parallel.hpp"
+
+/** @file include/pg_subdivide.hpp
+ *  This is a C++ Library header.
+ *
+ *  Uniform midpoint refinement of indexed triangle meshes. Each level splits
+ *  every triangle into four; the midpoint of an edge shared by two triangles
+ *  is computed once, through an edge table keyed by the sorted vertex ids,
+ *  and midpoints are kept in canonical form so coordinates grow only as the
+ *  geometry requires.
+ */
+
+namespace fun {
+
+    /**
+     * @brief Indexed triangle mesh
+     *
+     * @tparam Point
+     */
+    template <class Point> struct TriMesh {
+        std::vector<Point> vertices;
+        std::vector<std::array<uint32_t, 3>> triangles;
+    };
+
+    /**
+     * @brief Euclidean midpoint, as fun::midpoint
+     *
+     */
+    struct EuclidMidpoint {
+        template <class Point>
+        auto operator()(const Point &pt_a, const Point &pt_b) const -> Point {
+            return Point::parametrize(pt_b.coord[2], pt_a, pt_a.coord[2], pt_b);
+        }
+    };
+
+    /**
+     * @brief Midpoint with respect to a line at infinity, as
+     *        persp_euclid_plane::midpoint
+     *
+     * @tparam Line
+     */
+    template <class Line> struct PerspMidpoint {
+        Line l_inf;
+
+        template <class Point>
+        auto operator()(const Point &pt_a, const Point &pt_b) const -> Point {
+            const auto alpha = pt_a.dot(this->l_inf);
+            const auto beta = pt_b.dot(this->l_inf);
+            return Point::parametrize(beta, pt_a, alpha, pt_b);
+        }
+    };
+
+    /**
+     * @brief Midpoint subdivision engine
+     *
+     * Scratch buffers are members, so refining level after level (or mesh
+     * after mesh) reuses the memory of the previous level.
+     *
+     * @tparam Point
+     * @tparam Midpoint callable as mid(Point, Point) -> Point
+     */
+    template <class Point, class Midpoint = EuclidMidpoint> class MeshSubdivider {
+      private:
+        static constexpr uint64_t EMPTY = ~uint64_t{0};
+
+        Midpoint _mid;
+        std::vector<uint64_t> _slot_key;   // open-addressing edge table
+        std::vector<uint32_t> _slot_edge;
+        std::vector<uint64_t> _edges;      // unique edges, (lo << 32) | hi
+        std::vector<uint32_t> _corner;     // edge id of each triangle side
+        std::vector<std::array<uint32_t, 3>> _next;
+
+        static auto edge_key(uint32_t a, uint32_t b) -> uint64_t {
+            return a < b ? (uint64_t{a} << 32) | b : (uint64_t{b} << 32) | a;
+        }
+
+        /**
+         * @brief Edge id of `key`, inserting it if new
+         *
+         */
+        auto find_or_insert(uint64_t key) -> uint32_t {
+            const auto mask = this->_slot_key.size() - 1;
+            auto h = key * 0x9E3779B97F4A7C15ULL;
+            for (auto i = static_cast<std::size_t>(h >> 32) & mask;; i = (i + 1) & mask) {
+                if (this->_slot_key[i] == key) return this->_slot_edge[i];
+                if (this->_slot_key[i] == EMPTY) {
+                    this->_slot_key[i] = key;
+                    this->_slot_edge[i] = static_cast<uint32_t>(this->_edges.size());
+                    this->_edges.push_back(key);
+                    return this->_slot_edge[i];
+                }
+            }
+        }
+
+      public:
+        /**
+         * @brief Construct a new Mesh Subdivider object
+         *
+         * @param[in] mid midpoint rule
+         */
+        explicit MeshSubdivider(Midpoint mid = {}) : _mid{std::move(mid)} {}
+
+        /**
+         * @brief Refine a mesh by one level, in place
+         *
+         * New vertices are appended in edge order; the triangle (a, b, c)
+         * becomes (a, ab, ca), (ab, b, bc), (ca, bc, c) and (ab, bc, ca),
+         * keeping the orientation.
+         *
+         * @param[in,out] mesh
+         * @param[in] grain edges or triangles per chunk
+         */
+        void refine(TriMesh<Point> &mesh, std::size_t grain = 4096) {
+            const auto num_tris = mesh.triangles.size();
+            auto capacity = std::size_t{16};
+            while (capacity < 4 * num_tris) capacity *= 2;  // load factor <= 3/4
+            this->_slot_key.assign(capacity, EMPTY);
+            this->_slot_edge.resize(capacity);
+            this->_edges.clear();
+            this->_corner.resize(3 * num_tris);
+
+            // 1. number the edges (hash of sorted vertex ids)
+            for (std::size_t t = 0; t != num_tris; ++t) {
+                const auto &tri = mesh.triangles[t];
+                for (std::size_t k = 0; k != 3; ++k) {
+                    const auto key = edge_key(tri[k], tri[(k + 1) % 3]);
+                    this->_corner[3 * t + k] = this->find_or_insert(key);
+                }
+            }
+            const auto base = mesh.vertices.size();
+            if (base + this->_edges.size() > uint64_t{UINT32_MAX}) {
+                throw std::length_error("MeshSubdivider: too many vertices for 32-bit indices");
+            }
+
+            // 2. one midpoint per edge, in parallel over the edge list
+            mesh.vertices.resize(base + this->_edges.size(), mesh.vertices.empty()
+                                                                 ? Point{{0, 0, 1}}
+                                                                 : mesh.vertices.front());
+            parallel_for(this->_edges.size(), grain, [&](std::size_t begin, std::size_t end) {
+                for (auto e = begin; e != end; ++e) {
+                    const auto &pt_a = mesh.vertices[this->_edges[e] >> 32];
+                    const auto &pt_b = mesh.vertices[this->_edges[e] & UINT32_MAX];
+                    mesh.vertices[base + e] = canonical(this->_mid(pt_a, pt_b));
+                }
+            });
+
+            // 3. refined index buffer, in parallel over triangles
+            this->_next.resize(4 * num_tris);
+            parallel_for(num_tris, grain, [&](std::size_t begin, std::size_t end) {
+                for (auto t = begin; t != end; ++t) {
+                    const auto [a, b, c] = mesh.triangles[t];
+                    const auto ab = static_cast<uint32_t>(base + this->_corner[3 * t]);
+                    const auto bc = static_cast<uint32_t>(base + this->_corner[3 * t + 1]);
+                    const auto ca = static_cast<uint32_t>(base + this->_corner[3 * t + 2]);
+                    this->_next[4 * t] = {a, ab, ca};
+                    this->_next[4 * t + 1] = {ab, b, bc};
+                    this->_next[4 * t + 2] = {ca, bc, c};
+                    this->_next[4 * t + 3] = {ab, bc, ca};
+                }
+            });
+            mesh.triangles.swap(this->_next);  // the old buffer is reused next level
+        }
+
+        /**
+         * @brief Refine a mesh by several levels, in place
+         *
+         * @param[in,out] mesh
+         * @param[in] levels
+         * @param[in] grain
+         */
+        void refine_levels(TriMesh<Point> &mesh, std::size_t levels, std::size_t grain = 4096) {
+            for (std::size_t i = 0; i != levels; ++i) this->refine(mesh, grain);
+        }
+    };
+
+    /**
+     * @brief Refine a mesh by `levels` levels of midpoint subdivision
+     *
+     * @tparam Point
+     * @tparam Midpoint
+     * @param[in] mesh
+     * @param[in] levels
+     * @param[in] mid midpoint rule
+     * @return TriMesh<Point>
+     */
+    template <class Point, class Midpoint = EuclidMidpoint>
+    auto subdivide(TriMesh<Point> mesh, std::size_t levels, Midpoint mid = {}) -> TriMesh<Point> {
+        MeshSubdivider<Point, Midpoint>(std::move(mid)).refine_levels(mesh, levels);
+        return mesh;
+    }
+
+}  // namespace fun
@@ -0,0 +1,399 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "pg_canonical.hpp"
+#include "pg_parallel.hpp"
+#include "pg_polygon.hpp"
+#include "pg_pool.hpp"
+#include "pg_wide.hpp"
+
+/** @file include/pg_sweep.hpp
+ *  This is a C++ Library header.
+ *
+ *  Bentley-Ottmann sweep over segments with homogeneous integer endpoints.
+ *  Events are ordered lexicographically by (x, y) through cross-multiplied
+ *  int128_t comparisons, and supporting lines and crossing points are cross
+ *  products taken in int128_t and reduced. The sweep is exact for endpoint
+ *  coordinates below 2^14; beyond that, a line or crossing point that does
+ *  not fit int64 after reduction throws std::overflow_error instead of
+ *  wrapping (e.g. when crossing points, of about 2^59, are swept again).
+ */
+
+namespace fun {
+
+    /**
+     * @brief A pair of intersecting segments and their first common point
+     *
+     * For collinear overlapping segments the point is the lexicographically
+     * smallest point of the overlap.
+     *
+     * @tparam Point
+     */
+    template <class Point> struct SegmentHit {
+        std::size_t first;
+        std::size_t second;
+        Point point;
+    };
+
+    /**
+     * @brief Lexicographic (x, then y) comparison of affine coordinates
+     *
+     * @param[in] p Homogeneous coordinate with positive last component
+     * @param[in] q Homogeneous coordinate with positive last component
+     * @return int -1, 0 or 1
+     */
+    inline auto lex_compare(const std::array<int64_t, 3> &p, const std::array<int64_t, 3> &q)
+        -> int {
+        const auto sx = sign_of(mul_wide(p[0], q[2]) - mul_wide(q[0], p[2]));
+        if (sx != 0) return sx;
+        return sign_of(mul_wide(p[1], q[2]) - mul_wide(q[1], p[2]));
+    }
+
+    /**
+     * @brief Comparison of the x-coordinates of affine coordinates
+     *
+     * @param[in] p Homogeneous coordinate with positive last component
+     * @param[in] q Homogeneous coordinate with positive last component
+     * @return int -1, 0 or 1
+     */
+    inline auto x_compare(const std::array<int64_t, 3> &p, const std::array<int64_t, 3> &q)
+        -> int {
+        return sign_of(mul_wide(p[0], q[2]) - mul_wide(q[0], p[2]));
+    }
+
+    /**
+     * @brief Strict lexicographic order on affine coordinates
+     *
+     */
+    struct CoordLess {
+        auto operator()(const std::array<int64_t, 3> &p, const std::array<int64_t, 3> &q) const
+            -> bool {
+            return lex_compare(p, q) < 0;
+        }
+    };
+
+    /**
+     * @brief Segment as seen by a sweep
+     *
+     */
+    struct SweepSegment {
+        std::array<int64_t, 3> a, b;  // a < b lexicographically
+        std::array<int64_t, 3> line;  // supporting line, positive on the left of a -> b
+        int64_t dx, dy;               // direction, positively scaled
+        bool point;                   // zero length
+    };
+
+    /**
+     * @brief Sweep segment between two affine points
+     *
+     * @tparam Point
+     * @param[in] pt_p
+     * @param[in] pt_q
+     * @return SweepSegment
+     * @exception std::overflow_error if the supporting line does not fit int64
+     */
+    template <class Point>
+    auto make_sweep_segment(const Point &pt_p, const Point &pt_q) -> SweepSegment {
+        auto a = canonical_coord(affine_coord(pt_p.coord));
+        auto b = canonical_coord(affine_coord(pt_q.coord));
+        if (lex_compare(b, a) < 0) std::swap(a, b);
+        const auto line = cross_oriented(a, b);
+        // (b0 a2 - a0 b2, b1 a2 - a1 b2) = (l1, -l0) up to the positive reduction
+        if (line[0] == std::numeric_limits<int64_t>::min()) {
+            throw std::overflow_error("make_sweep_segment: exceeds int64");
+        }
+        return {a, b, line, line[1], -line[0], lex_compare(a, b) == 0};
+    }
+
+    /**
+     * @brief Status order of a sweep just after the current event point
+     *
+     * Only valid when at least one operand passes through the event point, which
+     * holds for every comparison std::set makes on insertion. The special id
+     * PROBE stands for the event point itself and sorts before the segments
+     * through it, so `lower_bound(PROBE)` finds the first of them.
+     */
+    struct SweepOrder {
+        static constexpr uint32_t PROBE = ~uint32_t{0};
+
+        const std::vector<SweepSegment> *segs;
+        const std::array<int64_t, 3> *event;
+
+        auto orient(uint32_t s) const -> int {
+            return sign_of(dot_wide((*this->segs)[s].line, *this->event));
+        }
+
+        auto compare(uint32_t s, uint32_t t) const -> int {
+            if (s == t) return 0;
+            if (s == PROBE) {
+                const auto o = this->orient(t);
+                return o != 0 ? o : -1;
+            }
+            if (t == PROBE) return -this->compare(t, s);
+            if (this->orient(s) != 0) {
+                assert(this->orient(t) == 0);
+                return -this->compare(t, s);
+            }
+            const auto ot = this->orient(t);
+            if (ot != 0) return ot;
+            const auto &ss = (*this->segs)[s];
+            const auto &st = (*this->segs)[t];
+            const auto slope = sign_of(mul_wide(ss.dy, st.dx) - mul_wide(st.dy, ss.dx));
+            if (slope != 0) return slope;
+            return s < t ? -1 : 1;
+        }
+
+        auto operator()(uint32_t s, uint32_t t) const -> bool { return this->compare(s, t) < 0; }
+    };
+
+    /**
+     * @brief Sweep-line segment intersection engine
+     *
+     * The status structure is a red-black tree (std::set) whose nodes come from a
+     * NodePool; the event queue is a pooled std::map keyed by canonical points.
+     * Degeneracies are handled as in de Berg et al.: every segment containing an
+     * event point is found in the status, so shared endpoints, crossings through
+     * a common point, vertical and zero-length segments, and collinear overlaps
+     * are all reported.
+     *
+     * @tparam Point
+     */
+    template <class Point> class SegmentSweep {
+        using Coord = std::array<int64_t, 3>;
+
+        static constexpr uint32_t PROBE = SweepOrder::PROBE;
+
+        struct Event {
+            std::vector<uint32_t> upper;   // segments starting here
+            std::vector<uint32_t> points;  // zero-length segments here
+        };
+
+        using Status = std::set<uint32_t, SweepOrder, PoolAllocator<uint32_t>>;
+        using Queue
+            = std::map<Coord, Event, CoordLess, PoolAllocator<std::pair<const Coord, Event>>>;
+
+        std::vector<SweepSegment> _segs;
+
+        auto orient(uint32_t s, const Coord &p) const -> int {
+            return sign_of(dot_wide(this->_segs[s].line, p));
+        }
+
+        auto within(uint32_t s, const Coord &p) const -> bool {
+            return lex_compare(this->_segs[s].a, p) <= 0 && lex_compare(p, this->_segs[s].b) <= 0;
+        }
+
+        void find_event(uint32_t s, uint32_t t, const Coord &p, Queue &queue) const {
+            const auto c = narrow_reduced<3>(cross_wide(this->_segs[s].line, this->_segs[t].line));
+            if (c[2] == 0) return;  // parallel or collinear
+            const auto q = canonical_coord(c);
+            if (!this->within(s, q) || !this->within(t, q)) return;
+            if (lex_compare(q, p) <= 0) return;
+            queue[q];
+        }
+
+        /**
+         * @brief Sweep the given segments, reporting hits with x in [x_lo, x_hi)
+         *
+         */
+        void sweep(const std::vector<uint32_t> &subset, const Coord *x_lo, const Coord *x_hi,
+                   std::vector<SegmentHit<Point>> &hits) const {
+            auto alloc = PoolAllocator<uint32_t>{};
+            auto queue = Queue{CoordLess{}, alloc};
+            for (const auto id : subset) {
+                auto &event = queue[this->_segs[id].a];
+                (this->_segs[id].point ? event.points : event.upper).push_back(id);
+                if (!this->_segs[id].point) queue[this->_segs[id].b];
+            }
+
+            auto current = Coord{0, 0, 1};
+            auto status = Status{SweepOrder{&this->_segs, &current}, alloc};
+            auto where = std::vector<typename Status::iterator>(this->_segs.size(), status.end());
+            auto through = std::vector<uint32_t>{};
+            auto all = std::vector<uint32_t>{};
+
+            while (!queue.empty()) {
+                const auto node = queue.begin();
+                current = node->first;
+                const auto event = std::move(node->second);
+                queue.erase(node);
+                if (x_hi != nullptr && x_compare(current, *x_hi) >= 0) break;
+
+                // segments containing the event point are contiguous in the status
+                through.clear();
+                for (auto it = status.lower_bound(PROBE);
+                     it != status.end() && this->orient(*it, current) == 0; ++it) {
+                    through.push_back(*it);
+                }
+
+                all.assign(event.upper.begin(), event.upper.end());
+                all.insert(all.end(), through.begin(), through.end());
+                all.insert(all.end(), event.points.begin(), event.points.end());
+                if (all.size() > 1 && (x_lo == nullptr || x_compare(current, *x_lo) >= 0)) {
+                    for (std::size_t i = 0; i != all.size(); ++i) {
+                        for (auto j = i + 1; j != all.size(); ++j) {
+                            hits.push_back({std::min<std::size_t>(all[i], all[j]),
+                                            std::max<std::size_t>(all[i], all[j]),
+                                            Point{current}});
+                        }
+                    }
+                }
+
+                for (const auto id : through) {
+                    status.erase(where[id]);
+                    where[id] = status.end();
+                }
+                auto inserted = false;
+                for (const auto id : event.upper) {
+                    where[id] = status.insert(id).first;
+                    inserted = true;
+                }
+                for (const auto id : through) {
+                    if (lex_compare(this->_segs[id].b, current) == 0) continue;
+                    where[id] = status.insert(id).first;
+                    inserted = true;
+                }
+
+                auto lowest = status.lower_bound(PROBE);
+                if (!inserted) {
+                    if (lowest != status.end() && lowest != status.begin()) {
+                        this->find_event(*std::prev(lowest), *lowest, current, queue);
+                    }
+                    continue;
+                }
+                auto highest = lowest;
+                while (std::next(highest) != status.end()
+                       && this->orient(*std::next(highest), current) == 0) {
+                    ++highest;
+                }
+                if (lowest != status.begin()) {
+                    this->find_event(*std::prev(lowest), *lowest, current, queue);
+                }
+                if (std::next(highest) != status.end()) {
+                    this->find_event(*highest, *std::next(highest), current, queue);
+                }
+            }
+        }
+
+        static void finish(std::vector<SegmentHit<Point>> &hits) {
+            std::sort(hits.begin(), hits.end(), [](const auto &h1, const auto &h2) {
+                if (h1.first != h2.first) return h1.first < h2.first;
+                if (h1.second != h2.second) return h1.second < h2.second;
+                return lex_compare(h1.point.coord, h2.point.coord) < 0;
+            });
+            hits.erase(std::unique(hits.begin(), hits.end(),
+                                   [](const auto &h1, const auto &h2) {
+                                       return h1.first == h2.first && h1.second == h2.second;
+                                   }),
+                       hits.end());
+        }
+
+      public:
+        /**
+         * @brief Construct a new Segment Sweep object
+         *
+         * @param[in] segments pairs of affine endpoints
+         */
+        explicit SegmentSweep(const std::vector<std::array<Point, 2>> &segments) {
+            this->_segs.reserve(segments.size());
+            for (const auto &[pt_p, pt_q] : segments) {
+                this->_segs.push_back(make_sweep_segment(pt_p, pt_q));
+            }
+        }
+
+        /**
+         * @brief Number of segments
+         *
+         * @return std::size_t
+         */
+        auto size() const -> std::size_t { return this->_segs.size(); }
+
+        /**
+         * @brief All intersecting pairs, sorted by (first, second)
+         *
+         * @return std::vector<SegmentHit<Point>>
+         */
+        auto run() const -> std::vector<SegmentHit<Point>> {
+            auto subset = std::vector<uint32_t>(this->_segs.size());
+            for (std::size_t i = 0; i != subset.size(); ++i) subset[i] = static_cast<uint32_t>(i);
+            auto hits = std::vector<SegmentHit<Point>>{};
+            this->sweep(subset, nullptr, nullptr, hits);
+            finish(hits);
+            return hits;
+        }
+
+        /**
+         * @brief All intersecting pairs, computed over vertical slabs in parallel
+         *
+         * The x-range is cut at endpoint quantiles. Each slab sweeps the segments
+         * overlapping it and keeps the hits whose point falls inside the slab, so
+         * the result equals run(). Segments spanning many slabs are swept once per
+         * slab they overlap.
+         *
+         * @param[in] num_slabs number of slabs (0 selects num_workers())
+         * @return std::vector<SegmentHit<Point>>
+         */
+        auto run_parallel(std::size_t num_slabs = 0) const -> std::vector<SegmentHit<Point>> {
+            if (num_slabs == 0) num_slabs = num_workers();
+            auto xs = std::vector<Coord>{};
+            xs.reserve(2 * this->_segs.size());
+            for (const auto &seg : this->_segs) {
+                xs.push_back(seg.a);
+                xs.push_back(seg.b);
+            }
+            std::sort(xs.begin(), xs.end(),
+                      [](const Coord &p, const Coord &q) { return x_compare(p, q) < 0; });
+            auto cuts = std::vector<Coord>{};
+            for (std::size_t k = 1; k < num_slabs && !xs.empty(); ++k) {
+                const auto &cut = xs[k * xs.size() / num_slabs];
+                if (cuts.empty() || x_compare(cuts.back(), cut) < 0) cuts.push_back(cut);
+            }
+
+            const auto slabs = cuts.size() + 1;
+            auto partial = std::vector<std::vector<SegmentHit<Point>>>(slabs);
+            parallel_for(slabs, 1, [&](std::size_t begin, std::size_t end) {
+                for (auto k = begin; k != end; ++k) {
+                    const auto *lo = k == 0 ? nullptr : &cuts[k - 1];
+                    const auto *hi = k + 1 == slabs ? nullptr : &cuts[k];
+                    auto subset = std::vector<uint32_t>{};
+                    for (std::size_t i = 0; i != this->_segs.size(); ++i) {
+                        const auto &seg = this->_segs[i];
+                        if (hi != nullptr && x_compare(seg.a, *hi) > 0) continue;
+                        if (lo != nullptr && x_compare(seg.b, *lo) < 0) continue;
+                        subset.push_back(static_cast<uint32_t>(i));
+                    }
+                    this->sweep(subset, lo, hi, partial[k]);
+                }
+            });
+            auto hits = std::vector<SegmentHit<Point>>{};
+            for (auto &part : partial) hits.insert(hits.end(), part.begin(), part.end());
+            finish(hits);
+            return hits;
+        }
+    };
+
+    /**
+     * @brief All intersecting pairs among segments
+     *
+     * @tparam Point
+     * @param[in] segments
+     * @return std::vector<SegmentHit<Point>>
+     */
+    template <class Point>
+    auto segment_intersections(const std::vector<std::array<Point, 2>> &segments)
+        -> std::vector<SegmentHit<Point>> {
+        return SegmentSweep<Point>(segments).run();
+    }
+
+}  // namespace fun
@@ -0,0 +1,278 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "pg_parallel.hpp"
+#include "pg_trace.hpp"
+#include "pg_wide.hpp"
+
+/** @file include/pg_validate.hpp
+ *  This is a C++ Library header.
+ *
+ *  Bulk validation of claimed incidences ("point i lies on line j") and
+ *  concurrencies ("lines a, b, c meet in a point"). Claims are grouped by
+ *  line in CSR form, so a line is loaded once and its points stream past it.
+ *
+ *  Incidence is decided exactly without 128-bit arithmetic in the common
+ *  case: the dot product is evaluated with wrapping 64-bit arithmetic, and
+ *  a floating-point bound on |x l0| + |y l1| + |z l2| below 2^62 proves that
+ *  the wrapped value is the true one. Only claims with larger terms fall back
+ *  to `dot_wide`.
+ */
+
+namespace fun {
+
+    /**
+     * @brief Incidence claims grouped by line (CSR)
+     *
+     * Line j claims the points `points[start[j], start[j + 1])`. Claims from
+     * `start.back()` to `size()` name lines that do not exist; they always
+     * fail. When built by `group_by_line`, `source[k]` is the input position
+     * of claim k.
+     *
+     */
+    struct IncidenceClaims {
+        std::vector<std::size_t> start{0};
+        std::vector<uint32_t> points;
+        std::vector<std::size_t> source;
+
+        auto size() const -> std::size_t { return this->points.size(); }
+
+        /**
+         * @brief Group (point, line) claims by line, keeping input order per line
+         *
+         * Claims on lines `num_lines` and beyond are kept, in input order, in
+         * a trailing bucket after the last line.
+         *
+         * @param[in] claims (point index, line index) pairs
+         * @param[in] num_lines
+         * @return IncidenceClaims
+         */
+        static auto group_by_line(const std::vector<std::pair<uint32_t, uint32_t>> &claims,
+                                  std::size_t num_lines) -> IncidenceClaims {
+            auto result = IncidenceClaims{};
+            result.start.assign(num_lines + 2, 0);
+            for (const auto &claim : claims) {
+                ++result.start[std::min<std::size_t>(claim.second, num_lines) + 2];
+            }
+            for (std::size_t j = 2; j < result.start.size(); ++j) {
+                result.start[j] += result.start[j - 1];
+            }
+            result.points.resize(claims.size());
+            result.source.resize(claims.size());
+            for (std::size_t k = 0; k != claims.size(); ++k) {
+                const auto j = std::min<std::size_t>(claims[k].second, num_lines);
+                const auto slot = result.start[j + 1]++;
+                result.points[slot] = claims[k].first;
+                result.source[slot] = k;
+            }
+            result.start.pop_back();  // the trailing bucket runs to the end
+            return result;
+        }
+    };
+
+    /**
+     * @brief One bit per claim, set when the claim fails
+     *
+     */
+    struct FailureMask {
+        std::vector<uint64_t> words;
+        std::size_t count{0};
+
+        explicit FailureMask(std::size_t count = 0) : words((count + 63) / 64), count{count} {}
+
+        auto test(std::size_t k) const -> bool {
+            return ((this->words[k / 64] >> (k % 64)) & 1U) != 0;
+        }
+
+        /**
+         * @brief Number of failed claims
+         *
+         * @return std::size_t
+         */
+        auto failures() const -> std::size_t {
+            auto total = std::size_t{0};
+            for (const auto w : this->words) total += std::bitset<64>(w).count();
+            return total;
+        }
+
+        /**
+         * @brief Indices of the failed claims, ascending
+         *
+         * @return std::vector<std::size_t>
+         */
+        auto indices() const -> std::vector<std::size_t> {
+            auto result = std::vector<std::size_t>{};
+            for (std::size_t w = 0; w != this->words.size(); ++w) {
+                for (auto bits = this->words[w]; bits != 0; bits &= bits - 1) {
+                    auto b = std::size_t{0};
+                    while (((bits >> b) & 1U) == 0) ++b;
+                    result.push_back(64 * w + b);
+                }
+            }
+            return result;
+        }
+    };
+
+    /**
+     * @brief Validate incidence claims
+     *
+     * Work is split into runs of whole 64-bit mask words, so chunks never
+     * share an output word. A claim naming a point or a line that does not
+     * exist fails.
+     *
+     * @tparam Point
+     * @tparam Line
+     * @param[in] points
+     * @param[in] lines
+     * @param[in] claims
+     * @param[in] grain mask words per chunk
+     * @return FailureMask over the CSR claim order
+     */
+    template <class Point, class Line>
+    auto validate_incidences(const std::vector<Point> &points, const std::vector<Line> &lines,
+                             const IncidenceClaims &claims, std::size_t grain = 64)
+        -> FailureMask {
+        auto mask = FailureMask{claims.size()};
+        const auto num_points = points.size();
+        const auto num_lines = std::min(lines.size(), claims.start.size() - 1);
+        constexpr auto safe = 4611686018427387904.0;  // 2^62
+        if (num_points == 0) {
+            for (std::size_t k = 0; k != mask.count; ++k) {
+                mask.words[k / 64] |= uint64_t{1} << (k % 64);
+            }
+            return mask;
+        }
+        parallel_for(mask.words.size(), grain, [&](std::size_t w_begin, std::size_t w_end) {
+            PG_TRACE_CHUNK("validate", "incidences", w_begin);
+            auto failed = std::array<uint8_t, 64>{};
+            auto wide = std::array<uint8_t, 64>{};
+            auto px = std::array<int64_t, 64>{};
+            auto py = std::array<int64_t, 64>{};
+            auto pz = std::array<int64_t, 64>{};
+            auto mag = std::array<double, 64>{};  // x l0 + y l1 + z l2 term bound
+            for (auto w = w_begin; w != w_end; ++w) {
+                const auto k_begin = 64 * w;
+                const auto k_end = std::min(claims.size(), k_begin + 64);
+                failed.fill(1);  // claims beyond the known lines fail
+                auto j = static_cast<std::size_t>(
+                    std::upper_bound(claims.start.begin(), claims.start.end(), k_begin)
+                    - claims.start.begin() - 1);
+                for (auto k = k_begin; k < k_end && j < num_lines; ++j) {
+                    const auto seg_begin = k;
+                    const auto seg_end = std::min(k_end, claims.start[j + 1]);
+                    const auto &l = lines[j].coord;
+                    const auto l0 = static_cast<uint64_t>(l[0]);
+                    const auto l1 = static_cast<uint64_t>(l[1]);
+                    const auto l2 = static_cast<uint64_t>(l[2]);
+                    const auto m0 = std::fabs(static_cast<double>(l[0]));
+                    const auto m1 = std::fabs(static_cast<double>(l[1]));
+                    const auto m2 = std::fabs(static_cast<double>(l[2]));
+                    for (auto i = seg_begin; i != seg_end; ++i) {  // gather, then stream
+                        const auto idx = claims.points[i];
+                        const auto valid = idx < num_points;
+                        const auto &p = points[valid ? idx : 0].coord;
+                        px[i - k_begin] = p[0];
+                        py[i - k_begin] = p[1];
+                        pz[i - k_begin] = p[2];
+                        mag[i - k_begin] = std::fabs(static_cast<double>(p[0])) * m0
+                                           + std::fabs(static_cast<double>(p[1])) * m1
+                                           + std::fabs(static_cast<double>(p[2])) * m2;
+                        failed[i - k_begin] = static_cast<uint8_t>(!valid);
+                    }
+                    for (auto i = seg_begin - k_begin; i != seg_end - k_begin; ++i) {
+                        const auto wrapped = static_cast<uint64_t>(px[i]) * l0
+                                             + static_cast<uint64_t>(py[i]) * l1
+                                             + static_cast<uint64_t>(pz[i]) * l2;
+                        wide[i] = static_cast<uint8_t>((failed[i] == 0) & (mag[i] >= safe));
+                        failed[i] = static_cast<uint8_t>(failed[i] | (wrapped != 0));
+                    }
+                    k = seg_end;
+                    // terms too large for the wrapped sum to be conclusive
+                    for (auto i = seg_begin; i != seg_end; ++i) {
+                        if (wide[i - k_begin] == 0) continue;
+                        const auto &p = points[claims.points[i]].coord;
+                        failed[i - k_begin] = static_cast<uint8_t>(dot_wide(p, l) != int128_t(0));
+                    }
+                }
+                auto bits = uint64_t{0};
+                for (auto k = k_begin; k != k_end; ++k) {
+                    bits |= uint64_t{failed[k - k_begin]} << (k - k_begin);
+                }
+                mask.words[w] = bits;
+            }
+        });
+        return mask;
+    }
+
+    /**
+     * @brief Validate concurrency claims det[l_a, l_b, l_c] = 0
+     *
+     * A floating-point filter rejects clearly non-concurrent triples; the
+     * rest are decided exactly (for coordinates below 2^31). A triple naming
+     * a line that does not exist fails. Applied to points instead of lines,
+     * this validates collinearity claims.
+     *
+     * @tparam Line
+     * @param[in] lines
+     * @param[in] triples
+     * @param[in] grain mask words per chunk
+     * @return FailureMask
+     */
+    template <class Line>
+    auto validate_concurrencies(const std::vector<Line> &lines,
+                                const std::vector<std::array<uint32_t, 3>> &triples,
+                                std::size_t grain = 64) -> FailureMask {
+        auto mask = FailureMask{triples.size()};
+        const auto num_lines = lines.size();
+        const auto tol = 64 * std::numeric_limits<double>::epsilon();
+        parallel_for(mask.words.size(), grain, [&](std::size_t w_begin, std::size_t w_end) {
+            PG_TRACE_CHUNK("validate", "concurrencies", w_begin);
+            for (auto w = w_begin; w != w_end; ++w) {
+                const auto k_begin = 64 * w;
+                const auto k_end = std::min(triples.size(), k_begin + 64);
+                auto bits = uint64_t{0};
+                for (auto k = k_begin; k != k_end; ++k) {
+                    const auto &[a, b, c] = triples[k];
+                    auto failed = a >= num_lines || b >= num_lines || c >= num_lines;
+                    if (!failed) {
+                        const auto &la = lines[a].coord;
+                        const auto &lb = lines[b].coord;
+                        const auto &lc = lines[c].coord;
+                        auto det = 0.0;
+                        auto bound = 0.0;
+                        for (std::size_t i = 0; i != 3; ++i) {
+                            const auto i1 = (i + 1) % 3;
+                            const auto i2 = (i + 2) % 3;
+                            const auto x = static_cast<double>(la[i]);
+                            const auto y1 = static_cast<double>(lb[i1])
+                                            * static_cast<double>(lc[i2]);
+                            const auto y2 = static_cast<double>(lb[i2])
+                                            * static_cast<double>(lc[i1]);
+                            det += x * (y1 - y2);
+                            bound += std::fabs(x) * (std::fabs(y1) + std::fabs(y2));
+                        }
+                        if (std::fabs(det) <= tol * bound) {
+                            const auto meet = narrow_reduced(cross_wide(lb, lc));
+                            failed = dot_wide(la, meet) != int128_t(0);
+                        } else {
+                            failed = true;
+                        }
+                    }
+                    bits |= uint64_t{failed} << (k - k_begin);
+                }
+                mask.words[w] = bits;
+            }
+        });
+        return mask;
+    }
+
+}  // namespace fun
@@ -0,0 +1,305 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+/** @file include/pg_wide.hpp
+ *  This is a C++ Library header.
+ *
+ *  128-bit signed integer used for exact intermediate products of int64_t
+ *  coordinates. GCC and Clang provide `__int128`; elsewhere (or when
+ *  PROJGEOM_NO_INT128 is defined) a small two's-complement class stands in.
+ */
+
+namespace fun {
+
+#if defined(__SIZEOF_INT128__) && !defined(PROJGEOM_NO_INT128)
+
+    __extension__ using int128_t = __int128;
+
+#else
+
+    /**
+     * @brief Portable two's-complement 128-bit integer (+, -, *, /, %, comparisons)
+     *
+     */
+    class int128_t {
+      private:
+        uint64_t _lo{0};
+        uint64_t _hi{0};
+
+        constexpr int128_t(uint64_t hi, uint64_t lo) : _lo{lo}, _hi{hi} {}
+
+        static constexpr auto mul_64x64(uint64_t a, uint64_t b) -> int128_t {
+            const auto a0 = a & 0xFFFFFFFFU;
+            const auto a1 = a >> 32;
+            const auto b0 = b & 0xFFFFFFFFU;
+            const auto b1 = b >> 32;
+            const auto p00 = a0 * b0;
+            const auto p01 = a0 * b1;
+            const auto p10 = a1 * b0;
+            const auto p11 = a1 * b1;
+            const auto mid = (p00 >> 32) + (p01 & 0xFFFFFFFFU) + (p10 & 0xFFFFFFFFU);
+            const auto lo = (p00 & 0xFFFFFFFFU) | (mid << 32);
+            const auto hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+            return {hi, lo};
+        }
+
+        static constexpr auto less_unsigned(const int128_t &a, const int128_t &b) -> bool {
+            return a._hi != b._hi ? a._hi < b._hi : a._lo < b._lo;
+        }
+
+        /**
+         * @brief Truncating division, bit by bit on the magnitudes
+         *
+         */
+        static constexpr auto divmod(const int128_t &n, const int128_t &d, int128_t &rem)
+            -> int128_t {
+            const auto neg_n = static_cast<int64_t>(n._hi) < 0;
+            const auto neg_d = static_cast<int64_t>(d._hi) < 0;
+            const auto un = neg_n ? -n : n;
+            const auto ud = neg_d ? -d : d;
+            auto q = int128_t{};
+            auto r = int128_t{};
+            for (int i = 127; i >= 0; --i) {
+                r = {(r._hi << 1) | (r._lo >> 63), r._lo << 1};
+                r._lo |= (i >= 64 ? un._hi >> (i - 64) : un._lo >> i) & 1U;
+                if (!less_unsigned(r, ud)) {
+                    r = r - ud;
+                    if (i >= 64) {
+                        q._hi |= uint64_t{1} << (i - 64);
+                    } else {
+                        q._lo |= uint64_t{1} << i;
+                    }
+                }
+            }
+            rem = neg_n ? -r : r;
+            return neg_n != neg_d ? -q : q;
+        }
+
+      public:
+        constexpr int128_t() = default;
+
+        constexpr int128_t(int64_t value)  // NOLINT(google-explicit-constructor)
+            : _lo{static_cast<uint64_t>(value)}, _hi{value < 0 ? ~uint64_t{0} : uint64_t{0}} {}
+
+        constexpr explicit operator int64_t() const { return static_cast<int64_t>(this->_lo); }
+
+        constexpr explicit operator double() const {
+            if (static_cast<int64_t>(this->_hi) < 0) return -static_cast<double>(-*this);
+            return static_cast<double>(this->_hi) * 18446744073709551616.0
+                   + static_cast<double>(this->_lo);
+        }
+
+        friend constexpr auto operator+(const int128_t &a, const int128_t &b) -> int128_t {
+            const auto lo = a._lo + b._lo;
+            return {a._hi + b._hi + (lo < a._lo ? 1U : 0U), lo};
+        }
+
+        friend constexpr auto operator-(const int128_t &a) -> int128_t {
+            const auto lo = ~a._lo + 1;
+            return {~a._hi + (lo == 0 ? 1U : 0U), lo};
+        }
+
+        friend constexpr auto operator-(const int128_t &a, const int128_t &b) -> int128_t {
+            return a + (-b);
+        }
+
+        friend constexpr auto operator*(const int128_t &a, const int128_t &b) -> int128_t {
+            auto result = mul_64x64(a._lo, b._lo);
+            result._hi += a._lo * b._hi + a._hi * b._lo;
+            return result;
+        }
+
+        friend constexpr auto operator/(const int128_t &a, const int128_t &b) -> int128_t {
+            auto rem = int128_t{};
+            return divmod(a, b, rem);
+        }
+
+        friend constexpr auto operator%(const int128_t &a, const int128_t &b) -> int128_t {
+            auto rem = int128_t{};
+            divmod(a, b, rem);
+            return rem;
+        }
+
+        constexpr auto operator+=(const int128_t &b) -> int128_t & { return *this = *this + b; }
+        constexpr auto operator-=(const int128_t &b) -> int128_t & { return *this = *this - b; }
+        constexpr auto operator*=(const int128_t &b) -> int128_t & { return *this = *this * b; }
+
+        friend constexpr auto operator==(const int128_t &a, const int128_t &b) -> bool {
+            return a._lo == b._lo && a._hi == b._hi;
+        }
+
+        friend constexpr auto operator!=(const int128_t &a, const int128_t &b) -> bool {
+            return !(a == b);
+        }
+
+        friend constexpr auto operator<(const int128_t &a, const int128_t &b) -> bool {
+            const auto ha = static_cast<int64_t>(a._hi);
+            const auto hb = static_cast<int64_t>(b._hi);
+            return ha != hb ? ha < hb : a._lo < b._lo;
+        }
+
+        friend constexpr auto operator>(const int128_t &a, const int128_t &b) -> bool {
+            return b < a;
+        }
+
+        friend constexpr auto operator<=(const int128_t &a, const int128_t &b) -> bool {
+            return !(b < a);
+        }
+
+        friend constexpr auto operator>=(const int128_t &a, const int128_t &b) -> bool {
+            return !(a < b);
+        }
+    };
+
+#endif
+
+    /**
+     * @brief Exact product of two int64_t values
+     *
+     * @param[in] a
+     * @param[in] b
+     * @return int128_t
+     */
+    constexpr auto mul_wide(int64_t a, int64_t b) -> int128_t {
+        return int128_t(a) * int128_t(b);
+    }
+
+    /**
+     * @brief Sign of a wide value
+     *
+     * @param[in] a
+     * @return int -1, 0 or 1
+     */
+    constexpr auto sign_of(const int128_t &a) -> int {
+        return a < int128_t(0) ? -1 : a > int128_t(0) ? 1 : 0;
+    }
+
+    /**
+     * @brief Exact `dot` of two int64_t coordinates
+     *
+     * @param[in] v
+     * @param[in] w
+     * @return int128_t
+     */
+    template <class Array> constexpr auto dot_wide(const Array &v, const Array &w) -> int128_t {
+        return mul_wide(v[0], w[0]) + mul_wide(v[1], w[1]) + mul_wide(v[2], w[2]);
+    }
+
+    /**
+     * @brief Greatest common divisor of wide values (non-negative)
+     *
+     * @param[in] a
+     * @param[in] b
+     * @return int128_t
+     */
+    constexpr auto gcd_wide(int128_t a, int128_t b) -> int128_t {
+        if (a < int128_t(0)) a = -a;
+        if (b < int128_t(0)) b = -b;
+        while (b != int128_t(0)) {
+            const auto r = a % b;
+            a = b;
+            b = r;
+        }
+        return a;
+    }
+
+    /**
+     * @brief Reduce wide coordinates by their gcd and narrow to int64
+     *
+     * The first non-zero entry is made positive when `first_positive` is set,
+     * otherwise the last one (as canonical_coord does).
+     *
+     * @param[in] v
+     * @param[in] first_positive
+     * @return std::array<int64_t, N>
+     * @exception std::overflow_error if a reduced entry does not fit
+     */
+    template <std::size_t N>
+    auto narrow_reduced(std::array<int128_t, N> v, bool first_positive = false)
+        -> std::array<int64_t, N> {
+        auto g = int128_t(0);
+        for (const auto &x : v) g = gcd_wide(g, x);
+        auto result = std::array<int64_t, N>{};
+        if (g == int128_t(0)) return result;
+        auto lead = int128_t(0);
+        for (std::size_t i = 0; i != N; ++i) {
+            const auto &x = v[first_positive ? i : N - 1 - i];
+            if (x != int128_t(0)) {
+                lead = x;
+                break;
+            }
+        }
+        if (lead < int128_t(0)) g = -g;
+        const auto lo = int128_t(std::numeric_limits<int64_t>::min());
+        const auto hi = int128_t(std::numeric_limits<int64_t>::max());
+        for (std::size_t i = 0; i != N; ++i) {
+            const auto x = v[i] / g;
+            if (x < lo || x > hi) throw std::overflow_error("narrow_reduced: exceeds int64");
+            result[i] = static_cast<int64_t>(x);
+        }
+        return result;
+    }
+
+    /**
+     * @brief Exact cross product of two int64_t coordinates
+     *
+     * @param[in] v
+     * @param[in] w
+     * @return std::array<int128_t, 3>
+     */
+    inline auto cross_wide(const std::array<int64_t, 3> &v, const std::array<int64_t, 3> &w)
+        -> std::array<int128_t, 3> {
+        return {mul_wide(v[1], w[2]) - mul_wide(v[2], w[1]),
+                mul_wide(v[2], w[0]) - mul_wide(v[0], w[2]),
+                mul_wide(v[0], w[1]) - mul_wide(v[1], w[0])};
+    }
+
+    /**
+     * @brief Exact cross product, reduced by the gcd but keeping its sign
+     *
+     * Unlike narrow_reduced(), the result is a positive multiple of v x w, so
+     * a line through two points keeps its orientation.
+     *
+     * @param[in] v
+     * @param[in] w
+     * @return std::array<int64_t, 3>
+     * @exception std::overflow_error if a reduced entry does not fit
+     */
+    inline auto cross_oriented(const std::array<int64_t, 3> &v, const std::array<int64_t, 3> &w)
+        -> std::array<int64_t, 3> {
+        const auto wide = cross_wide(v, w);
+        auto result = narrow_reduced<3>(wide);
+        for (std::size_t i = 3; i-- != 0;) {
+            if (wide[i] == int128_t(0)) continue;
+            if ((wide[i] < int128_t(0)) == (result[i] < 0)) break;
+            for (auto &c : result) {
+                if (c == std::numeric_limits<int64_t>::min()) {
+                    throw std::overflow_error("cross_oriented: exceeds int64");
+                }
+                c = -c;
+            }
+            break;
+        }
+        return result;
+    }
+
+    /**
+     * @brief Floor of the square root of a non-negative wide value below 2^126
+     *
+     * @param[in] n
+     * @return int64_t
+     */
+    inline auto isqrt_wide(const int128_t &n) -> int64_t {
+        auto s = static_cast<int64_t>(std::sqrt(static_cast<double>(n)));
+        while (s > 0 && mul_wide(s, s) > n) --s;
+        while (mul_wide(s + 1, s + 1) <= n) ++s;
+        return s;
+    }
+
+}  // namespace fun
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "pg_parallel.hpp"
+#include "pg_trace.hpp"
+
+/** @file include/pg_workload.hpp
+ *  This is a C++ Library header.
+ *
+ *  Reproducible synthetic point sets for benchmarks and verification. The
+ *  random source is Philox4x32-10, a counter-based generator: element i of
+ *  a workload is a pure function of (seed, distribution, i), so a set comes
+ *  out the same at any scale prefix, on any machine and with any number of
+ *  worker threads.
+ *
+ *  The distributions lean on the cases that break fast paths:
+ *
+ *  - Uniform:        affine points in a square, small positive weights
+ *  - NearCollinear:  points on one line, half of them moved off it by one
+ *                    unit, scaled by random factors
+ *  - AtInfinity:     half of the points at infinity (z = 0)
+ *  - MixedMagnitude: coordinates drawn either tiny (|c| <= 16) or huge
+ *                    (around `huge`), independently per coordinate
+ *  - Concyclic:      points exactly on one circle (rational parametrization)
+ *
+ *  Bounded integers are taken as a 64-bit draw modulo the span; the bias is
+ *  below 2^-32 for every span used here. `range` and `huge` are limited to
+ *  MAX_WORKLOAD_BOUND = 2^59, which keeps every distribution's arithmetic
+ *  (spans, the scaled near-collinear points, the concyclic shift) inside
+ *  int64.
+ */
+
+namespace fun {
+
+    /**
+     * @brief Philox4x32 with 10 rounds (Salmon et al., SC'11)
+     *
+     */
+    class Philox4x32 {
+      private:
+        static constexpr uint32_t M0 = 0xD2511F53U;
+        static constexpr uint32_t M1 = 0xCD9E8D57U;
+        static constexpr uint32_t W0 = 0x9E3779B9U;
+        static constexpr uint32_t W1 = 0xBB67AE85U;
+
+        std::array<uint32_t, 2> _key;
+
+      public:
+        using Counter = std::array<uint32_t, 4>;
+
+        explicit Philox4x32(uint64_t seed)
+            : _key{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)} {}
+
+        /**
+         * @brief The four random words of a counter
+         *
+         * @param[in] ctr
+         * @return Counter
+         */
+        auto operator()(Counter ctr) const -> Counter {
+            auto key = this->_key;
+            for (int round = 0; round != 10; ++round) {
+                const auto p0 = uint64_t{M0} * ctr[0];
+                const auto p1 = uint64_t{M1} * ctr[2];
+                ctr = {static_cast<uint32_t>(p1 >> 32) ^ ctr[1] ^ key[0],
+                       static_cast<uint32_t>(p1),
+                       static_cast<uint32_t>(p0 >> 32) ^ ctr[3] ^ key[1],
+                       static_cast<uint32_t>(p0)};
+                key[0] += W0;
+                key[1] += W1;
+            }
+            return ctr;
+        }
+    };
+
+    enum class Workload : uint32_t {
+        Uniform = 1,
+        NearCollinear = 2,
+        AtInfinity = 3,
+        MixedMagnitude = 4,
+        Concyclic = 5
+    };
+
+    /**
+     * @brief Command-line name of a distribution
+     *
+     * @param[in] kind
+     * @return const char*
+     */
+    inline auto workload_name(Workload kind) -> const char * {
+        switch (kind) {
+            case Workload::Uniform: return "uniform";
+            case Workload::NearCollinear: return "near-collinear";
+            case Workload::AtInfinity: return "infinity";
+            case Workload::MixedMagnitude: return "mixed-magnitude";
+            case Workload::Concyclic: return "concyclic";
+        }
+        return "unknown";
+    }
+
+    /**
+     * @brief Distribution of a command-line name
+     *
+     * @param[in] name
+     * @return Workload
+     * @exception std::invalid_argument if the name is unknown
+     */
+    inline auto parse_workload(const std::string &name) -> Workload {
+        for (const auto kind : {Workload::Uniform, Workload::NearCollinear, Workload::AtInfinity,
+                                Workload::MixedMagnitude, Workload::Concyclic}) {
+            if (name == workload_name(kind)) return kind;
+        }
+        throw std::invalid_argument("unknown workload: " + name);
+    }
+
+    /// largest `range` and `huge` a workload accepts
+    constexpr int64_t MAX_WORKLOAD_BOUND = int64_t{1} << 59;
+
+    /**
+     * @brief What to generate
+     *
+     */
+    struct WorkloadSpec {
+        Workload kind = Workload::Uniform;
+        std::size_t count = 0;
+        uint64_t seed = 1;
+        int64_t range = int64_t{1} << 20;  ///< bound of the affine coordinates
+        int64_t huge = int64_t{1} << 30;   ///< magnitude of the huge coordinates
+    };
+
+    namespace detail {
+        /**
+         * @brief Random draws of one workload element
+         *
+         */
+        class ElementDraws {
+          private:
+            const Philox4x32 &_rng;
+            Philox4x32::Counter _ctr;
+            Philox4x32::Counter _words{};
+            std::size_t _used = 4;
+
+          public:
+            ElementDraws(const Philox4x32 &rng, uint64_t index, Workload kind)
+                : _rng{rng},
+                  _ctr{static_cast<uint32_t>(index), static_cast<uint32_t>(index >> 32), 0,
+                       static_cast<uint32_t>(kind)} {}
+
+            auto word() -> uint32_t {
+                if (this->_used == 4) {
+                    this->_words = this->_rng(this->_ctr);
+                    ++this->_ctr[2];
+                    this->_used = 0;
+                }
+                return this->_words[this->_used++];
+            }
+
+            /// uniform in [lo, hi]
+            auto uniform(int64_t lo, int64_t hi) -> int64_t {
+                const auto wide = (uint64_t{this->word()} << 32) | this->word();
+                const auto span = static_cast<uint64_t>(hi - lo) + 1;
+                return lo + static_cast<int64_t>(wide % span);
+            }
+
+            auto coin() -> bool { return (this->word() & 1U) != 0; }
+        };
+
+        /// one element of a workload; the shape parameters come from index 2^64 - 1
+        inline auto workload_element(const Philox4x32 &rng, const WorkloadSpec &spec,
+                                     uint64_t index) -> std::array<int64_t, 3> {
+            auto draw = ElementDraws(rng, index, spec.kind);
+            auto shape = ElementDraws(rng, ~uint64_t{0}, spec.kind);
+            const auto range = spec.range;
+            switch (spec.kind) {
+                case Workload::Uniform: break;
+                case Workload::NearCollinear: {
+                    const auto ax = shape.uniform(-range / 2, range / 2);
+                    const auto ay = shape.uniform(-range / 2, range / 2);
+                    const auto dx = shape.uniform(1, 7);
+                    const auto dy = shape.uniform(-7, 7);
+                    const auto t = draw.uniform(-range / 16, range / 16);
+                    const auto off = draw.coin() ? draw.uniform(0, 1) * 2 - 1 : 0;
+                    const auto w = draw.uniform(1, 4);
+                    return {w * (ax + t * dx), w * (ay + t * dy + off), w};
+                }
+                case Workload::AtInfinity: {
+                    if (!draw.coin()) break;
+                    const auto x = draw.uniform(-range, range);
+                    const auto y = draw.uniform(-range, range);
+                    return {x == 0 && y == 0 ? 1 : x, y, 0};
+                }
+                case Workload::MixedMagnitude: {
+                    auto coord = std::array<int64_t, 3>{};
+                    for (auto &c : coord) {
+                        c = draw.coin() ? draw.uniform(spec.huge / 2, spec.huge)
+                                        : draw.uniform(0, 16);
+                        if (draw.coin()) c = -c;
+                    }
+                    if (coord[2] < 0) coord[2] = -coord[2];
+                    if (coord[2] == 0) coord[2] = 1;
+                    return coord;
+                }
+                case Workload::Concyclic: {
+                    // x^2 + y^2 = z^2 for (q^2 - p^2, 2pq, q^2 + p^2); then scale and shift
+                    const auto cx = shape.uniform(-8, 8);
+                    const auto cy = shape.uniform(-8, 8);
+                    const auto r = shape.uniform(1, 8);
+                    const auto m = std::max<int64_t>(
+                        1, static_cast<int64_t>(std::sqrt(static_cast<double>(range) / 32)));
+                    const auto p = draw.uniform(-m, m);
+                    const auto q = draw.uniform(1, m);
+                    const auto z = q * q + p * p;
+                    return {r * (q * q - p * p) + cx * z, r * 2 * p * q + cy * z, z};
+                }
+            }
+            return {draw.uniform(-range, range), draw.uniform(-range, range), draw.uniform(1, 8)};
+        }
+    }  // namespace detail
+
+    /**
+     * @brief Homogeneous coordinates of a workload, generated in parallel
+     *
+     * @param[in] spec
+     * @param[in] workers 0 for the default; the result does not depend on it
+     * @return std::vector<std::array<int64_t, 3>>
+     * @exception std::invalid_argument unless 1 <= range and 2 <= huge, both at most
+     *            MAX_WORKLOAD_BOUND
+     */
+    inline auto generate_coords(const WorkloadSpec &spec, std::size_t workers = 0)
+        -> std::vector<std::array<int64_t, 3>> {
+        if (spec.range < 1 || spec.huge < 2 || spec.range > MAX_WORKLOAD_BOUND
+            || spec.huge > MAX_WORKLOAD_BOUND) {
+            throw std::invalid_argument("bad workload bounds");
+        }
+        auto result = std::vector<std::array<int64_t, 3>>(spec.count);
+        const auto rng = Philox4x32(spec.seed);
+        parallel_for(
+            spec.count, 4096,
+            [&](std::size_t begin, std::size_t end) {
+                PG_TRACE_CHUNK("workload", "generate", begin);
+                for (auto i = begin; i != end; ++i) {
+                    result[i] = detail::workload_element(rng, spec, i);
+                }
+            },
+            workers);
+        return result;
+    }
+
+    /**
+     * @brief A workload as points (or lines)
+     *
+     * @tparam Object
+     * @param[in] spec
+     * @param[in] workers
+     * @return std::vector<Object>
+     */
+    template <class Object>
+    auto generate_objects(const WorkloadSpec &spec, std::size_t workers = 0)
+        -> std::vector<Object> {
+        auto result = std::vector<Object>{};
+        result.reserve(spec.count);
+        for (const auto &coord : generate_coords(spec, workers)) result.emplace_back(Object(coord));
+        return result;
+    }
+
+}  // namespace fun
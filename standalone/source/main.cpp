@@ -1,11 +1,129 @@
-#include <projgeom/greeter.h>  // for LanguageCode, LanguageCode::DE, Langua...
-#include <projgeom/version.h>  // for PROJGEOM_VERSION
+#include <projgeom/greeter.h>            // for LanguageCode, LanguageCode::DE, Langua...
+#include <projgeom/pg_binary_io.hpp>     // for read_objects
+#include <projgeom/pg_mapped_index.hpp>  // for MappedGridIndex
+#include <projgeom/pg_object.hpp>        // for PgPoint, PgLine
+#include <projgeom/pg_result_cache.hpp>  // for ResultCache, cached_incidence_join
+#include <projgeom/pg_trace.hpp>         // for Tracer
+#include <projgeom/pg_workload.hpp>      // for WorkloadSpec, generate_objects
+#include <projgeom/version.h>            // for PROJGEOM_VERSION
 
+#include <csignal>        // for signal, SIGINT, SIGTERM
+#include <cstddef>        // for size_t
 #include <cxxopts.hpp>    // for value, OptionAdder, Options, OptionValue
+#include <exception>      // for exception
 #include <iostream>       // for string, operator<<, endl, basic_ostream
 #include <memory>         // for shared_ptr
 #include <string>         // for char_traits, hash, operator==
 #include <unordered_map>  // for operator==, unordered_map, __hash_map_...
+#include <vector>         // for vector
+
+#include "query_server.hpp"  // for QueryServer
+
+namespace {
+#ifdef PROJGEOM_HAS_UNIX_SOCKETS
+    QueryServer *running_server = nullptr;
+
+    void stop_server(int /* signal */) {
+        if (running_server != nullptr) running_server->stop();
+    }
+#endif
+
+    struct ServeOptions {
+        std::string socket;
+        std::string points;
+        std::string polygon;
+        std::string grid;
+        std::size_t max_batch;
+    };
+
+    /**
+     * @brief Load the datasets, then answer queries until SIGINT or SIGTERM
+     *
+     */
+    auto serve(const ServeOptions &opts) -> int {
+#ifndef PROJGEOM_HAS_UNIX_SOCKETS
+        (void)opts;
+        std::cerr << "--serve needs Unix domain sockets, which this platform lacks" << std::endl;
+        return 1;
+#else
+        auto service = fun::QueryService{};
+        if (!opts.points.empty()) service.set_points(fun::read_objects<PgPoint>(opts.points));
+        if (!opts.polygon.empty()) service.set_polygon(fun::read_objects<PgPoint>(opts.polygon));
+        if (!opts.grid.empty()) {
+            service.set_grid(opts.grid);
+        } else if (!opts.points.empty()) {
+            const auto grid = opts.socket + ".grid";
+            fun::MappedGridIndex::build_objects(grid, service.points());
+            service.set_grid(grid);
+        }
+
+        auto server = QueryServer(service, opts.socket, opts.max_batch);
+        running_server = &server;
+        std::signal(SIGINT, stop_server);
+        std::signal(SIGTERM, stop_server);
+        std::cerr << "serving " << service.points().size() << " points on " << opts.socket
+                  << std::endl;
+        server.run();
+        running_server = nullptr;
+
+        const auto stats = service.stats();
+        std::cerr << stats.requests << " requests in " << stats.batches << " batches, "
+                  << stats.errors << " errors, " << stats.throughput() << " req/s, p50 "
+                  << stats.p50_ns << " ns, p99 " << stats.p99_ns << " ns" << std::endl;
+        return 0;
+#endif
+    }
+
+    struct JoinOptions {
+        std::vector<std::string> inputs;  // points file, lines file
+        std::string out;
+        std::string cache;
+        std::size_t cache_mib;
+    };
+
+    /**
+     * @brief Incidence join of two files, through the result cache if given
+     *
+     */
+    auto join(const JoinOptions &opts) -> int {
+        if (opts.inputs.size() != 2 || opts.out.empty()) {
+            std::cerr << "--join needs a points file, a lines file and --out" << std::endl;
+            return 1;
+        }
+        const auto points = fun::read_objects<PgPoint>(opts.inputs[0]);
+        const auto lines = fun::read_objects<PgLine>(opts.inputs[1], fun::RecordKind::Lines);
+        auto cache = std::unique_ptr<fun::ResultCache>{};
+        if (!opts.cache.empty()) {
+            cache = std::make_unique<fun::ResultCache>(opts.cache,
+                                                       uint64_t{opts.cache_mib} << 20);
+        }
+        const auto pairs = fun::cached_incidence_join(points, lines, cache.get());
+        auto writer = fun::RecordWriter<fun::IncidencePair>(opts.out,
+                                                            fun::RecordKind::IncidencePairs);
+        writer.write(pairs);
+        writer.close();
+        std::cerr << pairs.size() << " incident pairs"
+                  << (cache && cache->hits() != 0 ? " (cached)" : "") << std::endl;
+        return 0;
+    }
+
+    /**
+     * @brief Write a synthetic point set in the binary format
+     *
+     */
+    auto generate(const std::string &kind, fun::WorkloadSpec spec, const std::string &out)
+        -> int {
+        if (out.empty()) {
+            std::cerr << "--generate needs --out" << std::endl;
+            return 1;
+        }
+        spec.kind = fun::parse_workload(kind);
+        fun::write_objects(out, fun::generate_objects<PgPoint>(spec));
+        std::cerr << spec.count << " " << fun::workload_name(spec.kind) << " points (seed "
+                  << spec.seed << ")" << std::endl;
+        return 0;
+    }
+}  // namespace
 
 auto main(int argc, char **argv) -> int {
     const std::unordered_map<std::string, projgeom::LanguageCode> languages{
@@ -19,6 +137,11 @@ auto main(int argc, char **argv) -> int {
 
     std::string language;
     std::string name;
+    auto serve_opts = ServeOptions{};
+    auto join_opts = JoinOptions{};
+    std::string trace_path;
+    std::string workload;
+    auto workload_spec = fun::WorkloadSpec{};
 
     // clang-format off
   options.add_options()
@@ -26,6 +149,30 @@ auto main(int argc, char **argv) -> int {
     ("v,version", "Print the current version number")
     ("n,name", "Name to greet", cxxopts::value(name)->default_value("World"))
     ("l,lang", "Language code to use", cxxopts::value(language)->default_value("en"))
+    ("serve", "Serve geometry queries on this Unix domain socket",
+     cxxopts::value(serve_opts.socket))
+    ("points", "Points file (binary format) for incident and nearest queries",
+     cxxopts::value(serve_opts.points))
+    ("polygon", "Polygon vertices file (binary format) for locate queries",
+     cxxopts::value(serve_opts.polygon))
+    ("grid", "Prebuilt grid index for nearest queries (default: built from --points)",
+     cxxopts::value(serve_opts.grid))
+    ("batch", "Maximum requests per batch",
+     cxxopts::value(serve_opts.max_batch)->default_value("1024"))
+    ("join", "Incidence join of a points file and a lines file (binary format)",
+     cxxopts::value(join_opts.inputs))
+    ("out", "Output file of --join and --generate", cxxopts::value(join_opts.out))
+    ("cache", "Result cache directory; repeated inputs skip the computation",
+     cxxopts::value(join_opts.cache))
+    ("cache-limit", "Result cache budget in MiB",
+     cxxopts::value(join_opts.cache_mib)->default_value("1024"))
+    ("trace", "Write a Chrome trace-event JSON file of the run", cxxopts::value(trace_path))
+    ("generate", "Write synthetic points: uniform, near-collinear, infinity, "
+     "mixed-magnitude or concyclic", cxxopts::value(workload))
+    ("count", "Points to generate", cxxopts::value(workload_spec.count)->default_value("1000000"))
+    ("seed", "Seed of --generate", cxxopts::value(workload_spec.seed)->default_value("1"))
+    ("range", "Coordinate bound of --generate (at most 2^59)",
+     cxxopts::value(workload_spec.range)->default_value("1048576"))
   ;
     // clang-format on
 
@@ -41,6 +188,26 @@ auto main(int argc, char **argv) -> int {
         return 0;
     }
 
+    if (result.count("generate") != 0 || result.count("serve") != 0
+        || result.count("join") != 0) {
+        if (!trace_path.empty()) fun::Tracer::instance().enable();
+        try {
+            auto status = 0;
+            if (result.count("generate") != 0) {
+                status = generate(workload, workload_spec, join_opts.out);
+            } else if (result.count("serve") != 0) {
+                status = serve(serve_opts);
+            } else {
+                status = join(join_opts);
+            }
+            if (!trace_path.empty()) fun::Tracer::instance().write_json(trace_path);
+            return status;
+        } catch (const std::exception &err) {
+            std::cerr << err.what() << std::endl;
+            return 1;
+        }
+    }
+
     auto langIt = languages.find(language);
     if (langIt == languages.end()) {
         std::cerr << "unknown language code: " << language << std::endl;
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <projgeom/pg_protocol.hpp>       // for QueryHeader, read_message, write_message
+#include <projgeom/pg_query_service.hpp>  // for QueryService, QueryRequest
+
+#include <algorithm>           // for max
+#include <atomic>              // for atomic
+#include <chrono>              // for milliseconds, microseconds
+#include <condition_variable>  // for condition_variable
+#include <cstddef>             // for size_t
+#include <cstring>             // for memcpy
+#include <deque>               // for deque
+#include <list>                // for list
+#include <memory>              // for shared_ptr
+#include <mutex>               // for mutex, lock_guard, unique_lock
+#include <stdexcept>           // for runtime_error
+#include <string>              // for string
+#include <thread>              // for thread
+#include <utility>             // for move
+#include <vector>              // for vector
+
+#ifdef PROJGEOM_HAS_UNIX_SOCKETS  // from pg_protocol.hpp
+#    include <poll.h>        // for poll
+#    include <sys/socket.h>  // for socket, bind, listen, accept
+#    include <sys/un.h>      // for sockaddr_un
+#    include <unistd.h>      // for close, unlink
+
+/**
+ * @brief Unix domain socket front end of a QueryService
+ *
+ * One reader thread per connection queues requests; a single dispatcher
+ * drains the queue in batches of up to `max_batch` requests (waiting up to
+ * `linger` for a batch to fill once the first request is in) and executes
+ * them with the service. Responses go to the outbox of their connection,
+ * which its own writer thread sends, so a client that does not read its
+ * socket stalls only itself.
+ *
+ * Backpressure: a reader stops reading its socket while the shared queue
+ * holds `max_queue` requests, or while its connection has PER_CONNECTION
+ * requests queued or answered but not yet sent.
+ */
+class QueryServer {
+  public:
+    static constexpr std::size_t PER_CONNECTION = 4096;
+
+  private:
+    struct Connection {
+        int fd;
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::deque<fun::QueryResponse> outbox;
+        std::size_t in_flight{0};  // queued or answered, not yet sent
+        bool reading{true};
+        std::thread reader;
+        std::thread writer;
+        std::atomic<bool> reader_done{false};
+        std::atomic<bool> writer_done{false};
+
+        explicit Connection(int fd) : fd{fd} {}
+        ~Connection() { ::close(this->fd); }
+    };
+
+    struct Pending {
+        std::shared_ptr<Connection> conn;
+        fun::QueryRequest request;
+    };
+
+    fun::QueryService &_service;
+    std::string _path;
+    std::size_t _max_batch;
+    std::chrono::microseconds _linger;
+    std::size_t _max_queue;
+    int _listen_fd{-1};
+    std::atomic<bool> _stopping{false};
+
+    std::mutex _queue_mutex;
+    std::condition_variable _queue_ready;
+    std::condition_variable _queue_space;
+    std::deque<Pending> _queue;
+
+    std::list<std::shared_ptr<Connection>> _connections;
+
+    /// wait for room for one more request of `conn`; false when stopping
+    auto admit(Connection &conn) -> bool {
+        {
+            std::unique_lock<std::mutex> lock(conn.mutex);
+            conn.changed.wait(lock, [&] {
+                return this->_stopping || conn.in_flight < PER_CONNECTION;
+            });
+            if (this->_stopping) return false;
+            ++conn.in_flight;
+        }
+        std::unique_lock<std::mutex> lock(this->_queue_mutex);
+        this->_queue_space.wait(
+            lock, [this] { return this->_stopping || this->_queue.size() < this->_max_queue; });
+        return !this->_stopping;
+    }
+
+    void read_loop(const std::shared_ptr<Connection> &conn) {
+        try {
+            auto request = fun::QueryRequest{};
+            while (fun::read_message(conn->fd, request.header, request.words)) {
+                request.received = std::chrono::steady_clock::now();
+                if (!this->admit(*conn)) break;
+                {
+                    std::lock_guard<std::mutex> lock(this->_queue_mutex);
+                    this->_queue.push_back(Pending{conn, std::move(request)});
+                }
+                this->_queue_ready.notify_one();
+                request = fun::QueryRequest{};
+            }
+        } catch (const std::runtime_error &) {  // malformed stream: drop the client
+        }
+        {
+            std::lock_guard<std::mutex> lock(conn->mutex);
+            conn->reading = false;
+        }
+        conn->changed.notify_all();
+    }
+
+    void write_loop(const std::shared_ptr<Connection> &conn) {
+        auto broken = false;  // the client is gone: drop its responses
+        while (true) {
+            auto response = fun::QueryResponse{};
+            {
+                std::unique_lock<std::mutex> lock(conn->mutex);
+                conn->changed.wait(lock, [&] {
+                    return !conn->outbox.empty() || this->_stopping
+                           || (!conn->reading && conn->in_flight == 0);
+                });
+                if (conn->outbox.empty()) break;
+                response = std::move(conn->outbox.front());
+                conn->outbox.pop_front();
+            }
+            if (!broken) {
+                broken = !fun::write_message(conn->fd, response.header, response.words.data());
+                if (broken) ::shutdown(conn->fd, SHUT_RDWR);  // also stops the reader
+            }
+            {
+                std::lock_guard<std::mutex> lock(conn->mutex);
+                --conn->in_flight;
+            }
+            conn->changed.notify_all();
+        }
+    }
+
+    void dispatch_loop() {
+        auto batch = std::vector<Pending>{};
+        auto requests = std::vector<fun::QueryRequest>{};
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(this->_queue_mutex);
+                this->_queue_ready.wait(
+                    lock, [this] { return this->_stopping || !this->_queue.empty(); });
+                if (this->_queue.empty()) return;  // stopping
+                if (this->_queue.size() < this->_max_batch) {
+                    this->_queue_ready.wait_for(lock, this->_linger, [this] {
+                        return this->_stopping || this->_queue.size() >= this->_max_batch;
+                    });
+                }
+                while (!this->_queue.empty() && batch.size() != this->_max_batch) {
+                    batch.push_back(std::move(this->_queue.front()));
+                    this->_queue.pop_front();
+                }
+            }
+            this->_queue_space.notify_all();
+            requests.clear();
+            for (auto &pending : batch) requests.push_back(std::move(pending.request));
+            auto responses = this->_service.execute(requests);
+            for (std::size_t i = 0; i != batch.size(); ++i) {
+                auto &conn = *batch[i].conn;
+                {
+                    std::lock_guard<std::mutex> lock(conn.mutex);
+                    conn.outbox.push_back(std::move(responses[i]));
+                }
+                conn.changed.notify_all();
+            }
+            batch.clear();
+        }
+    }
+
+    void reap_connections() {
+        for (auto it = this->_connections.begin(); it != this->_connections.end();) {
+            if (!(*it)->reader_done || !(*it)->writer_done) {
+                ++it;
+                continue;
+            }
+            (*it)->reader.join();
+            (*it)->writer.join();
+            it = this->_connections.erase(it);
+        }
+    }
+
+    /// wake every thread that waits for room or for responses
+    void wake_all() {
+        { std::lock_guard<std::mutex> lock(this->_queue_mutex); }  // no lost wake-up
+        this->_queue_ready.notify_all();
+        this->_queue_space.notify_all();
+        for (auto &conn : this->_connections) {
+            { std::lock_guard<std::mutex> lock(conn->mutex); }
+            conn->changed.notify_all();
+        }
+    }
+
+  public:
+    /**
+     * @brief Bind the socket (an existing socket file is replaced)
+     *
+     * @param[in] service
+     * @param[in] path
+     * @param[in] max_batch
+     * @param[in] linger
+     * @param[in] max_queue requests queued for the dispatcher at most
+     */
+    QueryServer(fun::QueryService &service, std::string path, std::size_t max_batch = 1024,
+                std::chrono::microseconds linger = std::chrono::microseconds{200},
+                std::size_t max_queue = 65536)
+        : _service{service},
+          _path{std::move(path)},
+          _max_batch{std::max<std::size_t>(max_batch, 1)},
+          _linger{linger},
+          _max_queue{std::max<std::size_t>(max_queue, 1)} {
+        auto addr = sockaddr_un{};
+        if (this->_path.size() >= sizeof(addr.sun_path)) {
+            throw std::runtime_error("socket path too long: " + this->_path);
+        }
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, this->_path.c_str(), this->_path.size() + 1);
+        ::unlink(this->_path.c_str());
+        this->_listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (this->_listen_fd < 0
+            || ::bind(this->_listen_fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr))
+                   != 0
+            || ::listen(this->_listen_fd, 64) != 0) {
+            if (this->_listen_fd >= 0) ::close(this->_listen_fd);
+            throw std::runtime_error("cannot listen on " + this->_path);
+        }
+    }
+
+    QueryServer(const QueryServer &) = delete;
+    auto operator=(const QueryServer &) -> QueryServer & = delete;
+
+    ~QueryServer() {
+        ::close(this->_listen_fd);
+        ::unlink(this->_path.c_str());
+    }
+
+    /**
+     * @brief Serve until stop() is called
+     *
+     */
+    void run() {
+        auto dispatcher = std::thread([this] { this->dispatch_loop(); });
+        while (!this->_stopping) {
+            auto waiting = pollfd{this->_listen_fd, POLLIN, 0};
+            if (::poll(&waiting, 1, 100) > 0) {
+                const auto fd = ::accept(this->_listen_fd, nullptr, nullptr);
+                if (fd >= 0) {
+                    auto conn = std::make_shared<Connection>(fd);
+                    conn->reader = std::thread([this, conn] {
+                        this->read_loop(conn);
+                        conn->reader_done = true;
+                    });
+                    conn->writer = std::thread([this, conn] {
+                        this->write_loop(conn);
+                        conn->writer_done = true;
+                    });
+                    this->_connections.push_back(conn);
+                }
+            }
+            this->reap_connections();
+        }
+        for (auto &conn : this->_connections) ::shutdown(conn->fd, SHUT_RDWR);
+        this->wake_all();
+        for (auto &conn : this->_connections) conn->reader.join();
+        this->wake_all();
+        dispatcher.join();
+        this->wake_all();
+        for (auto &conn : this->_connections) conn->writer.join();
+        this->_connections.clear();
+    }
+
+    /**
+     * @brief Ask run() to return; safe to call from a signal handler
+     *
+     */
+    void stop() { this->_stopping = true; }
+};
+#endif  // PROJGEOM_HAS_UNIX_SOCKETS
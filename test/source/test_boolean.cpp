@@ -0,0 +1,102 @@
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <projgeom/pg_boolean.hpp>
+#include <projgeom/pg_object.hpp>
+#include <stdexcept>
+#include <vector>
+
+using Rings = fun::PolygonRings<PgPoint>;
+
+/**
+ * @brief Signed area of a set of rings (holes count negative)
+ *
+ */
+static auto area(const Rings &rings) -> double {
+    auto sum = 0.0;
+    for (const auto &ring : rings) {
+        const auto n = ring.size();
+        for (std::size_t i = 0; i != n; ++i) {
+            const auto &a = ring[i].coord;
+            const auto &b = ring[(i + 1) % n].coord;
+            sum += (double(a[0]) / a[2]) * (double(b[1]) / b[2])
+                   - (double(b[0]) / b[2]) * (double(a[1]) / a[2]);
+        }
+    }
+    return sum / 2;
+}
+
+static auto box(int64_t x0, int64_t y0, int64_t x1, int64_t y1) -> std::vector<PgPoint> {
+    return {PgPoint({x0, y0, 1}), PgPoint({x1, y0, 1}), PgPoint({x1, y1, 1}),
+            PgPoint({x0, y1, 1})};
+}
+
+TEST_CASE("Polygon boolean (overlapping squares)") {
+    const auto a = Rings{box(0, 0, 4, 4)};
+    const auto b = Rings{box(2, 2, 6, 6)};
+    CHECK(area(fun::polygon_boolean(a, b, fun::BooleanOp::Intersection)) == doctest::Approx(4));
+    CHECK(area(fun::polygon_boolean(a, b, fun::BooleanOp::Union)) == doctest::Approx(28));
+    CHECK(area(fun::polygon_boolean(a, b, fun::BooleanOp::Difference)) == doctest::Approx(12));
+
+    // shared edge
+    const auto c = Rings{box(4, 0, 8, 4)};
+    CHECK(fun::polygon_boolean(a, c, fun::BooleanOp::Intersection).empty());
+    CHECK(area(fun::polygon_boolean(a, c, fun::BooleanOp::Union)) == doctest::Approx(32));
+    CHECK(area(fun::polygon_boolean(a, c, fun::BooleanOp::Difference)) == doctest::Approx(16));
+}
+
+TEST_CASE("Polygon boolean (holes and exact vertices)") {
+    auto hole = box(3, 3, 7, 7);
+    const auto a = Rings{box(0, 0, 10, 10), hole};
+    const auto b = Rings{box(5, 4, 12, 6)};
+    const auto meet = fun::polygon_boolean(a, b, fun::BooleanOp::Intersection);
+    CHECK(area(meet) == doctest::Approx(6));
+    CHECK(area(fun::polygon_boolean(a, b, fun::BooleanOp::Union)) == doctest::Approx(92));
+    CHECK(area(fun::polygon_boolean(a, b, fun::BooleanOp::Difference)) == doctest::Approx(78));
+
+    // a slanted clip creates rational intersection vertices
+    const auto tri = Rings{{PgPoint({-1, 0, 1}), PgPoint({2, 0, 1}), PgPoint({0, 3, 2})}};
+    const auto unit = Rings{box(0, 0, 1, 1)};
+    const auto cut = fun::polygon_boolean(tri, unit, fun::BooleanOp::Intersection);
+    REQUIRE(cut.size() == 1);
+    auto on_hypotenuse = 0;
+    for (const auto &pt_p : cut[0]) {
+        on_hypotenuse += PgPoint({2, 0, 1}).meet(PgPoint({0, 3, 2})).incident(pt_p) ? 1 : 0;
+    }
+    CHECK(on_hypotenuse == 2);  // (2/3, 1) and (1, 3/4)
+    CHECK(area(cut) == doctest::Approx(1.0 - (1.0 / 3) * (1.0 / 4) / 2));
+
+    const auto batch = fun::polygon_boolean_batch(std::vector<Rings>{a, tri},
+                                                  std::vector<Rings>{b, unit},
+                                                  fun::BooleanOp::Intersection, 1);
+    CHECK(area(batch[0]) == doctest::Approx(6));
+    CHECK(area(batch[1]) == doctest::Approx(area(cut)));
+}
+
+TEST_CASE("Polygon boolean (results fed back, overflow throws)") {
+    const auto op = fun::BooleanOp::Intersection;
+    const auto a
+        = Rings{{PgPoint({1, 16000, 1}), PgPoint({16383, 3, 1}), PgPoint({16383, 16000, 1})}};
+    const auto b = Rings{{PgPoint({7, 5, 1}), PgPoint({16381, 5, 1}), PgPoint({16381, 16002, 1})}};
+    const auto d
+        = Rings{{PgPoint({0, 10000, 1}), PgPoint({16383, 0, 1}), PgPoint({16383, 10000, 1})}};
+    const auto ab = fun::polygon_boolean(a, b, op);
+    REQUIRE(ab.size() == 1);
+    auto largest = int64_t{0};
+    for (const auto &pt : ab[0]) largest = std::max(largest, pt.coord[0]);
+    CHECK(largest > int64_t{1} << 39);  // a far larger vertex than any input
+    const auto left = fun::polygon_boolean(ab, d, op);
+    const auto right = fun::polygon_boolean(a, fun::polygon_boolean(b, d, op), op);
+    REQUIRE(left.size() == 1);
+    REQUIRE(right.size() == 1);
+    CHECK(area(left) == doctest::Approx(area(right)));
+    CHECK(left[0].size() == right[0].size());
+
+    const auto big = (int64_t{1} << 25) + 5;
+    const auto mid = (int64_t{1} << 24) + 3;
+    const auto f = Rings{{PgPoint({3, mid, 1}), PgPoint({big, 7, 1}), PgPoint({big, mid, 1})}};
+    const auto g = Rings{{PgPoint({11, 5, 1}), PgPoint({big - 1, 5, 1}),
+                          PgPoint({big - 1, mid + 9, 1})}};
+    CHECK_THROWS_AS(fun::polygon_boolean(f, g, op), std::overflow_error);
+}
@@ -0,0 +1,106 @@
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <projgeom/persp_object.hpp>
+#include <projgeom/pg_classes.hpp>
+#include <projgeom/pg_object.hpp>
+#include <random>
+#include <vector>
+
+/**
+ * @brief Class index of every item
+ *
+ */
+template <class Point> static auto class_of(const fun::ClassBuckets<Point> &buckets, std::size_t n)
+    -> std::vector<std::size_t> {
+    auto result = std::vector<std::size_t>(n, n);
+    for (std::size_t c = 0; c != buckets.size(); ++c) {
+        for (auto k = buckets.start[c]; k != buckets.start[c + 1]; ++k) {
+            result[buckets.members[k]] = c;
+        }
+    }
+    return result;
+}
+
+template <class Line> static auto random_lines(std::size_t n) -> std::vector<Line> {
+    auto gen = std::mt19937{17};
+    auto coord = std::uniform_int_distribution<int64_t>{-3, 3};
+    auto lines = std::vector<Line>{};
+    while (lines.size() != n) {
+        const auto ln = Line({coord(gen), coord(gen), coord(gen)});
+        if (ln.coord[0] == 0 && ln.coord[1] == 0) continue;  // skip the line at infinity
+        lines.push_back(ln);
+    }
+    return lines;
+}
+
+TEST_CASE("Parallel and perpendicular classes (Euclid)") {
+    const auto lines = random_lines<PgLine>(300);
+    const auto par = fun::parallel_classes(lines);
+    const auto perp = fun::perpendicular_classes(lines);
+    CHECK(par.members.size() == lines.size());
+    const auto par_of = class_of(par, lines.size());
+    const auto perp_of = class_of(perp, lines.size());
+    for (std::size_t i = 0; i != lines.size(); ++i) {
+        const auto &l = lines[i].coord;
+        for (std::size_t j = 0; j != lines.size(); ++j) {
+            const auto &m = lines[j].coord;
+            const auto parallel = l[0] * m[1] - l[1] * m[0] == 0;
+            const auto perpendicular = l[0] * m[0] + l[1] * m[1] == 0;
+            CHECK((par_of[i] == par_of[j]) == parallel);
+            // j is perpendicular to i exactly when j's direction is i's perp key
+            CHECK((par.keys[par_of[j]] == perp.keys[perp_of[i]]) == perpendicular);
+        }
+    }
+    for (std::size_t c = 0; c != par.size(); ++c) {
+        CHECK(par.class_size(c) >= 1);
+        CHECK(par.keys[c].coord[2] == 0);
+    }
+    // classes ordered by smallest member, members ascending
+    for (std::size_t c = 1; c < par.size(); ++c) {
+        CHECK(par.members[par.start[c - 1]] < par.members[par.start[c]]);
+    }
+    CHECK(std::is_sorted(par.members.begin() + static_cast<std::ptrdiff_t>(par.start[0]),
+                         par.members.begin() + static_cast<std::ptrdiff_t>(par.start[1])));
+}
+
+TEST_CASE("Parallel and perpendicular classes (perspective)") {
+    const auto lines = random_lines<PerspLine>(200);
+    const auto dir = fun::PerspDirection<PerspLine>{L_INF, I_RE, I_IM};
+    const auto par = fun::parallel_classes(lines, dir);
+    const auto perp = fun::perpendicular_classes(lines, dir);
+    const auto par_of = class_of(par, lines.size());
+    const auto perp_of = class_of(perp, lines.size());
+    for (std::size_t i = 0; i != lines.size(); ++i) {
+        if (lines[i] == L_INF) continue;
+        for (std::size_t j = 0; j != lines.size(); ++j) {
+            if (lines[j] == L_INF) continue;
+            const auto parallel = L_INF.incident(lines[i].meet(lines[j]));
+            const auto perpendicular = lines[j].incident(lines[i].perp());
+            CHECK((par_of[i] == par_of[j]) == parallel);
+            CHECK((par.keys[par_of[j]] == perp.keys[perp_of[i]]) == perpendicular);
+        }
+    }
+}
+
+TEST_CASE("Perpendicular classes of another perspective plane") {
+    // line at infinity z = 0 with the Euclidean polarity, unlike L_INF
+    const auto l_inf = PerspLine({0, 0, 1});
+    const auto i_re = PerspPoint({0, 1, 0});
+    const auto i_im = PerspPoint({1, 0, 0});
+    const auto dir = fun::PerspDirection<PerspLine>{l_inf, i_re, i_im};
+    const auto lines = random_lines<PerspLine>(200);
+    const auto par = fun::parallel_classes(lines, dir);
+    const auto perp = fun::perpendicular_classes(lines, dir);
+    const auto par_of = class_of(par, lines.size());
+    const auto perp_of = class_of(perp, lines.size());
+    for (std::size_t i = 0; i != lines.size(); ++i) {
+        const auto pole = PerspPoint::parametrize(lines[i].dot(i_re), i_re,
+                                                  lines[i].dot(i_im), i_im);
+        CHECK(l_inf.incident(pole));
+        for (std::size_t j = 0; j != lines.size(); ++j) {
+            const auto perpendicular = lines[j].incident(pole);
+            CHECK((par.keys[par_of[j]] == perp.keys[perp_of[i]]) == perpendicular);
+        }
+    }
+}
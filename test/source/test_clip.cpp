@@ -0,0 +1,92 @@
+#include <doctest/doctest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <projgeom/pg_clip.hpp>
+#include <projgeom/pg_object.hpp>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * @brief Twice the signed area of an affine polygon
+ *
+ * @param[in] polygon
+ * @return double
+ */
+static auto area2(const std::vector<PgPoint> &polygon) -> double {
+    auto sum = 0.0;
+    const auto n = polygon.size();
+    for (std::size_t i = 0; i != n; ++i) {
+        const auto &a = polygon[i].coord;
+        const auto &b = polygon[(i + 1) % n].coord;
+        sum += (double(a[0]) / a[2]) * (double(b[1]) / b[2])
+               - (double(b[0]) / b[2]) * (double(a[1]) / a[2]);
+    }
+    return sum;
+}
+
+TEST_CASE("Clip triangle against square window") {
+    const auto window = fun::ConvexWindow<PgPoint>(std::vector<PgPoint>{
+        PgPoint({0, 0, 1}), PgPoint({0, 10, 1}), PgPoint({10, 10, 1}), PgPoint({10, 0, 1})});
+    CHECK(window.contains(PgPoint({5, 5, 1})));
+    CHECK(!window.contains(PgPoint({-1, 5, 1})));
+
+    const auto tri = std::vector<PgPoint>{PgPoint({-5, 0, 1}), PgPoint({5, 0, 1}),
+                                          PgPoint({5, 10, 1})};
+    const auto clipped = window.clip(tri);
+    REQUIRE(clipped.size() == 4);
+    CHECK(area2(clipped) == doctest::Approx(75.0));
+    for (const auto &pt_p : clipped) CHECK(window.contains(pt_p));
+
+    // entirely outside
+    CHECK(window.clip(std::vector<PgPoint>{PgPoint({20, 20, 1}), PgPoint({30, 20, 1}),
+                                           PgPoint({30, 30, 1})})
+              .empty());
+}
+
+TEST_CASE("Clip polygons in batch") {
+    const auto window = fun::ConvexWindow<PgPoint>(std::vector<PgPoint>{
+        PgPoint({0, 0, 1}), PgPoint({6, 0, 1}), PgPoint({0, 6, 1})});
+    auto polygons = std::vector<std::vector<PgPoint>>{};
+    for (int64_t k = 0; k != 40; ++k) {
+        polygons.push_back(std::vector<PgPoint>{PgPoint({k - 20, -1, 3}), PgPoint({k, -1, 1}),
+                                                PgPoint({k, 7, 1}), PgPoint({k - 20, 7, 3})});
+    }
+    const auto result = fun::clip_polygons(window, polygons, 3);
+    REQUIRE(result.size() == polygons.size());
+    for (std::size_t i = 0; i != polygons.size(); ++i) {
+        const auto single = window.clip(polygons[i]);
+        REQUIRE(result[i].size() == single.size());
+        for (std::size_t j = 0; j != single.size(); ++j) CHECK(result[i][j] == single[j]);
+        for (const auto &pt_p : result[i]) CHECK(window.contains(pt_p));
+    }
+}
+
+TEST_CASE("Clip against a window away from the origin") {
+    const auto window = fun::ConvexWindow<PgPoint>(std::vector<PgPoint>{
+        PgPoint({10, 10, 1}), PgPoint({20, 10, 1}), PgPoint({20, 20, 1}), PgPoint({10, 20, 1})});
+    CHECK(window.contains(PgPoint({15, 15, 1})));
+    CHECK(!window.contains(PgPoint({5, 15, 1})));
+    CHECK(!window.contains(PgPoint({25, 15, 1})));
+    const auto clipped = window.clip(std::vector<PgPoint>{
+        PgPoint({0, 0, 1}), PgPoint({30, 0, 1}), PgPoint({30, 30, 1}), PgPoint({0, 30, 1})});
+    CHECK(std::abs(area2(clipped)) == doctest::Approx(200.0));
+}
+
+TEST_CASE("Clip with huge coordinates") {
+    const auto window = fun::ConvexWindow<PgPoint>(std::vector<PgPoint>{
+        PgPoint({0, 0, 1}), PgPoint({10, 0, 1}), PgPoint({10, 10, 1}), PgPoint({0, 10, 1})});
+    // edge lines above 2^63 that reduce to small ones, e.g. (2, -1, 2^40)
+    const auto big = int64_t{1} << 40;
+    const auto tri = std::vector<PgPoint>{PgPoint({big, 0, 1}), PgPoint({0, big, 1}),
+                                          PgPoint({-big, -big, 1})};
+    const auto clipped = window.clip(tri);
+    CHECK(area2(clipped) == doctest::Approx(200.0));
+    for (const auto &pt_p : clipped) CHECK(window.contains(pt_p));
+
+    // crossings that do not fit int64 throw instead of wrapping
+    const auto huge = int64_t{1} << 61;
+    const auto wide = std::vector<PgPoint>{PgPoint({-huge, 3, 1}), PgPoint({huge, 5, 7}),
+                                           PgPoint({5, huge - 1, 3})};
+    CHECK_THROWS_AS(window.clip(wide), std::overflow_error);
+}
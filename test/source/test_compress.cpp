@@ -0,0 +1,136 @@
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <limits>
+#include <projgeom/pg_binary_io.hpp>
+#include <projgeom/pg_canonical.hpp>
+#include <projgeom/pg_compress.hpp>
+#include <projgeom/pg_object.hpp>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using Coord = std::array<int64_t, 3>;
+
+static auto expected_set(const std::vector<Coord> &coords) -> std::vector<Coord> {
+    auto keys = std::set<Coord>{};
+    for (const auto &coord : coords) keys.insert(fun::canonical_coord(coord));
+    return {keys.begin(), keys.end()};
+}
+
+TEST_CASE("Compressed coordinates round trip") {
+    auto gen = std::mt19937{94};
+    auto small = std::uniform_int_distribution<int64_t>{-200, 200};
+    auto coords = std::vector<Coord>{};
+    for (std::size_t k = 0; k != 5000; ++k) {
+        const auto pt = Coord{small(gen), small(gen), small(gen) % 3 + 2};
+        coords.push_back(pt);
+        if (k % 5 == 0) coords.push_back({-3 * pt[0], -3 * pt[1], -3 * pt[2]});  // same point
+    }
+    const auto expected = expected_set(coords);
+    const auto packed = fun::CompressedCoords::encode(coords, 100);
+    CHECK(packed.size() == expected.size());
+    CHECK(packed.blocks() == (expected.size() + 99) / 100);
+    CHECK(packed.to_vector() == expected);
+    CHECK(packed.bytes() < 24 * packed.size() / 2);
+
+    // random access by block
+    auto x = std::vector<int64_t>(100);
+    auto y = std::vector<int64_t>(100);
+    auto z = std::vector<int64_t>(100);
+    const auto last = packed.blocks() - 1;
+    for (const auto b : {std::size_t{0}, std::size_t{7}, last}) {
+        const auto n = packed.decode_block(b, x.data(), y.data(), z.data());
+        REQUIRE(n == packed.block_size(b));
+        for (std::size_t i = 0; i != n; ++i) {
+            CHECK(Coord{x[i], y[i], z[i]} == expected[b * 100 + i]);
+        }
+    }
+
+    // streaming decode
+    auto streamed = std::vector<Coord>{};
+    packed.for_each_block(
+        [&](const int64_t *bx, const int64_t *by, const int64_t *bz, std::size_t n) {
+            for (std::size_t i = 0; i != n; ++i) streamed.push_back({bx[i], by[i], bz[i]});
+        });
+    CHECK(streamed == expected);
+}
+
+TEST_CASE("Compressed coordinates with extreme values") {
+    constexpr auto big = std::numeric_limits<int64_t>::max();
+    auto coords = std::vector<Coord>{{big, 1, 0},  {-big, 3, 1}, {big, -big, 1}, {0, 0, 1},
+                                     {1, big, 2},  {5, 7, -1},   {big - 1, big, big},
+                                     {0, 1, 0},    {-1, 0, 0}};
+    const auto expected = expected_set(coords);
+    for (const auto block : {std::size_t{1}, std::size_t{3}, std::size_t{64}}) {
+        const auto packed = fun::CompressedCoords::encode(coords, block);
+        CHECK(packed.to_vector() == expected);
+    }
+    const auto empty = fun::CompressedCoords::encode({});
+    CHECK(empty.size() == 0);
+    CHECK(empty.blocks() == 0);
+    CHECK(empty.to_vector().empty());
+}
+
+TEST_CASE("Compressed coordinate files") {
+    const auto dir = std::filesystem::temp_directory_path() / "projgeom_compress";
+    std::filesystem::create_directories(dir);
+    const auto path = (dir / "points.pgc").string();
+    auto points = std::vector<PgPoint>{};
+    for (int64_t i = 0; i != 700; ++i) points.emplace_back(PgPoint({i, i * i % 97, 1}));
+    const auto packed = fun::CompressedCoords::from_objects(points, 128);
+    packed.save(path);
+    const auto back = fun::CompressedCoords::load(path);
+    CHECK(back.size() == packed.size());
+    CHECK(back.block_capacity() == 128);
+    CHECK(back.to_vector() == packed.to_vector());
+    CHECK_THROWS_AS(fun::read_objects<PgPoint>(path), std::runtime_error);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Corrupt compressed coordinate files") {
+    const auto dir = std::filesystem::temp_directory_path() / "projgeom_compress";
+    std::filesystem::create_directories(dir);
+    const auto path = (dir / "corrupt.pgc").string();
+    auto points = std::vector<PgPoint>{};
+    for (int64_t i = 0; i != 700; ++i) points.emplace_back(PgPoint({i, i * i % 97, 1}));
+    const auto packed = fun::CompressedCoords::from_objects(points, 128);
+
+    // count, block and blocks, then 7 offsets, then the blocks
+    const auto offsets = sizeof(fun::FileHeader) + 3 * sizeof(uint64_t);
+    const auto data = offsets + 7 * sizeof(uint64_t);
+    auto patch = [&path](std::size_t at, const void *bytes, std::size_t size) {
+        auto *file = std::fopen(path.c_str(), "r+b");
+        REQUIRE(file != nullptr);
+        std::fseek(file, static_cast<long>(at), SEEK_SET);
+        std::fwrite(bytes, 1, size, file);
+        std::fclose(file);
+    };
+    const auto huge = uint64_t{1} << 40;
+    packed.save(path);
+    patch(offsets + sizeof(uint64_t), &huge, sizeof(huge));  // past the end
+    CHECK_THROWS_AS(fun::CompressedCoords::load(path), std::runtime_error);
+
+    packed.save(path);
+    const auto shifted = uint64_t{3};  // block 0 too short for its columns
+    patch(offsets + sizeof(uint64_t), &shifted, sizeof(shifted));
+    CHECK_THROWS_AS(fun::CompressedCoords::load(path), std::runtime_error);
+
+    packed.save(path);
+    const auto width = uint8_t{65};
+    patch(data + 3 * sizeof(int64_t), &width, 1);
+    CHECK_THROWS_AS(fun::CompressedCoords::load(path), std::runtime_error);
+
+    packed.save(path);
+    const auto wider = uint8_t{9};  // a valid width, but the columns no longer fill the block
+    patch(data + 3 * sizeof(int64_t), &wider, 1);
+    CHECK_THROWS_AS(fun::CompressedCoords::load(path), std::runtime_error);
+
+    packed.save(path);
+    CHECK(fun::CompressedCoords::load(path).to_vector() == packed.to_vector());
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,74 @@
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <projgeom/pg_canonical.hpp>
+#include <projgeom/pg_concurrent_set.hpp>
+#include <projgeom/pg_object.hpp>
+#include <projgeom/pg_parallel.hpp>
+#include <vector>
+
+TEST_CASE("Concurrent coordinate set (projective equality)") {
+    auto set = fun::ConcurrentCoordSet{4};
+    CHECK(set.insert_object(PgPoint({2, 4, 2})));
+    CHECK(!set.insert_object(PgPoint({-1, -2, -1})));
+    CHECK(!set.insert({3, 6, 3}));
+    CHECK(set.insert({1, 2, 0}));
+    CHECK(set.contains({-5, -10, -5}));
+    CHECK(!set.contains({1, 2, 3}));
+    CHECK(set.size() == 2);
+}
+
+TEST_CASE("Concurrent coordinate map (parallel inserts with resizes)") {
+    // 40000 inserts of 5000 distinct points, each under several representatives
+    const auto n = std::size_t{40000};
+    const auto distinct = int64_t{5000};
+    auto map = fun::ConcurrentCoordMap<std::size_t>{16};
+    auto fresh = std::atomic<std::size_t>{0};
+    auto mismatched = std::atomic<std::size_t>{0};
+    const auto scales = std::array<int64_t, 3>{2, -1, 3};
+    fun::parallel_for(
+        n, 97,
+        [&](std::size_t begin, std::size_t end) {
+            for (auto i = begin; i != end; ++i) {
+                const auto k = static_cast<int64_t>(i) % distinct;
+                const auto scale = scales[i / static_cast<std::size_t>(distinct) % 3];
+                const auto coord = std::array<int64_t, 3>{scale * k, scale * (k % 7), scale};
+                const auto [value, inserted] = map.try_emplace(coord, i);
+                if (inserted) fresh.fetch_add(1);
+                if (static_cast<int64_t>(value) % distinct != k) mismatched.fetch_add(1);
+            }
+        },
+        8);
+    CHECK(fresh.load() == static_cast<std::size_t>(distinct));
+    CHECK(mismatched.load() == 0);
+    CHECK(map.size() == static_cast<std::size_t>(distinct));
+    CHECK(map.capacity() >= 4 * static_cast<std::size_t>(distinct) / 3);
+    const auto entries = map.entries();
+    CHECK(entries.size() == static_cast<std::size_t>(distinct));
+    for (const auto &[key, value] : entries) {
+        CHECK(key == fun::canonical_coord(key));
+        CHECK(map.find(key) == value);
+    }
+    CHECK(!map.find({1, 1, 0}).has_value());
+}
+
+TEST_CASE("Sharded coordinate map") {
+    auto sharded = fun::ShardedCoordMap<int>{};
+    fun::parallel_for(
+        20000, 100,
+        [&](std::size_t begin, std::size_t end) {
+            for (auto i = begin; i != end; ++i) {
+                const auto k = static_cast<int64_t>(i % 1000);
+                const auto s = static_cast<int64_t>(i % 2 == 0 ? 1 : -3);
+                sharded.try_emplace({s * k, s * 1, s * (k + 1)}, static_cast<int>(k));
+            }
+        },
+        4);
+    const auto merged = sharded.merge();
+    REQUIRE(merged.size() == 1000);
+    CHECK(std::is_sorted(merged.begin(), merged.end()));
+    for (const auto &[key, value] : merged) {
+        CHECK(key == fun::canonical_coord({value, 1, value + 1}));
+    }
+}
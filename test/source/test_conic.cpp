@@ -0,0 +1,111 @@
+#include <doctest/doctest.h>
+
+#include <projgeom/pg_conic.hpp>
+#include <projgeom/pg_object.hpp>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using Conic = fun::Conic<PgPoint>;
+
+TEST_CASE("Wide division and gcd") {
+    const auto a = fun::mul_wide(-123456789012, 1000000007);
+    CHECK(a / fun::int128_t(1000000007) == fun::int128_t(-123456789012));
+    CHECK(a % fun::int128_t(1000000007) == fun::int128_t(0));
+    CHECK((a + fun::int128_t(5)) % fun::int128_t(1000000007) == fun::int128_t(-1000000002));
+    CHECK(fun::int128_t(-7) / fun::int128_t(2) == fun::int128_t(-3));
+    CHECK(fun::gcd_wide(fun::mul_wide(15, 1LL << 62), fun::mul_wide(-10, 1LL << 62))
+          == fun::mul_wide(5, 1LL << 62));
+}
+
+TEST_CASE("Conic (five points, incidence, polarity)") {
+    const auto circle = fun::conic_through<PgPoint>({PgPoint({5, 0, 1}), PgPoint({0, 5, 1}),
+                                                     PgPoint({-5, 0, 1}), PgPoint({3, 4, 1}),
+                                                     PgPoint({4, -3, 1})});
+    CHECK(circle.coef == std::array<int64_t, 6>{1, 1, -25, 0, 0, 0});
+    CHECK(circle == Conic({-2, -2, 50, 0, 0, 0}));
+    CHECK(circle.incident(PgPoint({-3, -4, 1})));
+    CHECK(circle.incident(PgPoint({0, -10, 2})));
+    CHECK(!circle.incident(PgPoint({1, 1, 1})));
+
+    CHECK(circle.polar(PgPoint({5, 0, 1})) == PgLine({1, 0, -5}));  // tangent x = 5
+    for (const auto &p : {PgPoint({7, 1, 1}), PgPoint({1, 2, 3}), PgPoint({1, 0, 0})}) {
+        CHECK(circle.pole(circle.polar(p)) == p);
+    }
+
+    const auto on_axis = circle.intersect(PgLine({0, 1, 0}));
+    REQUIRE(on_axis.size() == 2);
+    CHECK(((on_axis[0] == PgPoint({5, 0, 1}) && on_axis[1] == PgPoint({-5, 0, 1}))
+           || (on_axis[1] == PgPoint({5, 0, 1}) && on_axis[0] == PgPoint({-5, 0, 1}))));
+    CHECK(circle.intersect(PgLine({0, 1, -1})).empty());          // x^2 = 24
+    CHECK(circle.intersect(PgLine({0, 1, -6})).empty());          // misses
+    CHECK(circle.intersect(PgLine({1, 0, -5})).size() == 1);      // tangent
+
+    const auto from = PgPoint({7, 1, 1});
+    const auto tangents = circle.tangents(from);
+    REQUIRE(tangents.size() == 2);
+    for (const auto &t : tangents) {
+        CHECK(t.incident(from));
+        CHECK(circle.intersect(t).size() == 1);
+    }
+    CHECK(circle.tangents(PgPoint({3, 4, 1})).size() == 1);
+    CHECK(circle.tangents(PgPoint({1, 1, 1})).empty());  // inside
+
+    CHECK_THROWS_AS(fun::conic_through<PgPoint>({PgPoint({0, 0, 1}), PgPoint({0, 0, 1}),
+                                                 PgPoint({1, 0, 1}), PgPoint({0, 1, 1}),
+                                                 PgPoint({2, 3, 1})}),
+                    std::invalid_argument);
+}
+
+TEST_CASE("Conic (random five-point construction)") {
+    auto gen = std::mt19937{23};
+    auto coord = std::uniform_int_distribution<int64_t>{-40, 40};
+    for (int trial = 0; trial != 50; ++trial) {
+        auto random_point = [&]() { return PgPoint({coord(gen), coord(gen), 1 + trial % 3}); };
+        const auto pts = std::array<PgPoint, 5>{random_point(), random_point(), random_point(),
+                                                random_point(), random_point()};
+        try {
+            const auto conic = fun::conic_through(pts);
+            for (const auto &p : pts) CHECK(conic.incident(p));
+        } catch (const std::invalid_argument &) {
+            // four collinear or repeated points
+        }
+    }
+}
+
+TEST_CASE("Conic (SoA batch signs)") {
+    const auto hyperbola = Conic({1, -1, -1, 0, 0, 0});
+    auto gen = std::mt19937{29};
+    auto coord = std::uniform_int_distribution<int64_t>{-30, 30};
+    auto x = std::vector<int64_t>{};
+    auto y = std::vector<int64_t>{};
+    auto z = std::vector<int64_t>{};
+    for (int i = 0; i != 2000; ++i) {
+        x.push_back(coord(gen));
+        y.push_back(coord(gen));
+        z.push_back(i % 7 == 0 ? 0 : coord(gen));
+    }
+    x.push_back(1LL << 40);  // on the conic, large: decided exactly
+    y.push_back(1LL << 40);
+    z.push_back(0);
+    auto out = std::vector<int8_t>(x.size());
+    hyperbola.signs(x.data(), y.data(), z.data(), x.size(), out.data(), 256);
+    for (std::size_t i = 0; i != x.size(); ++i) {
+        const auto pt = PgPoint({x[i], y[i], z[i]});
+        CHECK(out[i] == fun::sign_of(hyperbola.value(pt)));
+    }
+    CHECK(out.back() == 0);
+
+    auto batch = fun::ConicBatch<PgPoint>{};
+    for (int i = 0; i != 500; ++i) {
+        batch.push_back(Conic({coord(gen), coord(gen), coord(gen), coord(gen), coord(gen), 0}));
+    }
+    batch.push_back(hyperbola);
+    const auto pt = PgPoint({5, 4, 3});
+    auto signs = std::vector<int8_t>(batch.size());
+    batch.signs(pt, signs.data(), 64);
+    for (std::size_t i = 0; i != batch.size(); ++i) {
+        CHECK(signs[i] == fun::sign_of(batch[i].value(pt)));
+    }
+    CHECK(signs.back() == 0);
+}
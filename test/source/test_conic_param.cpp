@@ -0,0 +1,69 @@
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <numeric>
+#include <projgeom/hyp_object.hpp>
+#include <projgeom/pg_conic_param.hpp>
+#include <projgeom/pg_object.hpp>
+#include <stdexcept>
+#include <vector>
+
+TEST_CASE("Conic parametrization (hyperbolic absolute)") {
+    const auto absolute = fun::Conic<HyperbolicPoint>({1, 1, -1, 0, 0, 0});
+    const auto param = fun::ConicParametrization<HyperbolicPoint>(
+        absolute, HyperbolicPoint({-1, 0, 1}));
+    CHECK(param.point(2, 1) == HyperbolicPoint({-3, 4, 5}));  // uc_point(1, 2)
+
+    const auto points = param.enumerate(10);
+    for (const auto &p : points) {
+        CHECK(absolute.incident(p));
+        CHECK(p.perp().incident(p));  // self-conjugate: on the absolute
+    }
+    // z is s^2 + t^2 or half of it, so parameters up to 10 reach every height <= 50
+    auto expected = std::vector<std::array<int64_t, 3>>{};
+    for (int64_t z = 1; z <= 50; ++z) {
+        for (int64_t x = -z; x <= z; ++x) {
+            for (int64_t y = -z; y <= z; ++y) {
+                if (x * x + y * y == z * z && std::gcd(std::gcd(x, y), z) == 1) {
+                    expected.push_back({x, y, z});
+                }
+            }
+        }
+    }
+    auto low = std::vector<std::array<int64_t, 3>>{};
+    for (const auto &p : points) {
+        if (fun::height(p.coord) <= 50) low.push_back(p.coord);
+    }
+    std::sort(expected.begin(), expected.end());
+    std::sort(low.begin(), low.end());
+    CHECK(low == expected);
+}
+
+TEST_CASE("Conic parametrization (ellipse and hyperbola)") {
+    const auto ellipse = fun::Conic<PgPoint>({2, 3, -5, 0, 0, 0});
+    const auto hyperbola = fun::Conic<PgPoint>({1, -2, -1, 0, 0, 0});
+    const auto cases = {std::make_pair(ellipse, PgPoint({1, 1, 1})),
+                        std::make_pair(hyperbola, PgPoint({3, 2, 1}))};
+    for (const auto &[conic, base] : cases) {
+        const auto param = fun::ConicParametrization<PgPoint>(conic, base);
+        const auto points = param.enumerate(12, 1);
+        CHECK(points.size() > 100);
+        for (const auto &p : points) CHECK(conic.incident(p));
+        for (std::size_t i = 1; i < points.size(); ++i) {
+            CHECK(points[i - 1].coord != points[i].coord);  // deduplicated
+            CHECK(fun::height(points[i - 1].coord) <= fun::height(points[i].coord));
+        }
+        CHECK(std::find(points.begin(), points.end(), base) != points.end());
+        // splitting the parameter rows gives the same points
+        auto split = param.enumerate_range(0, 5, 12);
+        const auto rest = param.enumerate_range(5, 13, 12);
+        split.insert(split.end(), rest.begin(), rest.end());
+        auto coords = std::vector<std::array<int64_t, 3>>{};
+        for (const auto &p : split) coords.push_back(p.coord);
+        std::sort(coords.begin(), coords.end());
+        coords.erase(std::unique(coords.begin(), coords.end()), coords.end());
+        CHECK(coords.size() == points.size());
+    }
+    CHECK_THROWS_AS(fun::ConicParametrization<PgPoint>(ellipse, PgPoint({1, 0, 1})),
+                    std::invalid_argument);
+}
@@ -0,0 +1,94 @@
+#include <doctest/doctest.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <projgeom/pg_binary_io.hpp>
+#include <projgeom/pg_canonical.hpp>
+#include <projgeom/pg_external_dedup.hpp>
+#include <projgeom/pg_object.hpp>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static auto scratch_dir(const std::string &name) -> std::string {
+    const auto dir = std::filesystem::temp_directory_path() / ("projgeom_" + name);
+    std::filesystem::create_directories(dir);
+    return dir.string();
+}
+
+TEST_CASE("Binary coordinate files") {
+    const auto path = scratch_dir("binary_io") + "/points.bin";
+    const auto points = std::vector<PgPoint>{PgPoint({1, 2, 3}), PgPoint({-4, 5, 0}),
+                                             PgPoint({7, -8, 9})};
+    fun::write_objects(path, points);
+    const auto back = fun::read_objects<PgPoint>(path);
+    REQUIRE(back.size() == points.size());
+    for (std::size_t i = 0; i != points.size(); ++i) CHECK(back[i].coord == points[i].coord);
+    CHECK_THROWS_AS(fun::read_objects<PgLine>(path, fun::RecordKind::Lines), std::runtime_error);
+    CHECK_THROWS_AS(fun::read_objects<PgPoint>(path + ".missing"), std::runtime_error);
+
+    // a header count beyond the file is rejected before anything is allocated
+    {
+        auto file = std::fstream(path, std::ios::in | std::ios::out | std::ios::binary);
+        const auto huge = uint64_t{1} << 60;
+        file.seekp(offsetof(fun::FileHeader, count));
+        file.write(reinterpret_cast<const char *>(&huge), sizeof(huge));
+    }
+    CHECK_THROWS_AS(fun::read_objects<PgPoint>(path), std::runtime_error);
+    CHECK_THROWS_AS((fun::RecordReader<std::array<int64_t, 3>>{path, fun::RecordKind::Points}),
+                    std::runtime_error);
+
+    // so are trailing bytes that are not whole records
+    fun::write_objects(path, points);
+    {
+        auto file = std::ofstream(path, std::ios::app | std::ios::binary);
+        file.put('\0');
+    }
+    CHECK_THROWS_AS(fun::read_objects<PgPoint>(path), std::runtime_error);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("External grouping of points with line ids") {
+    const auto dir = scratch_dir("external_dedup");
+    auto gen = std::mt19937{61};
+    auto coord = std::uniform_int_distribution<int64_t>{-30, 30};
+    auto expected = std::map<std::array<int64_t, 3>, std::set<uint64_t>>{};
+    auto options = fun::ExternalGroupOptions{};
+    options.spill_dir = dir;
+    options.partitions = 7;
+    options.buffer_records = 50;  // many background flushes
+    auto grouped = std::size_t{0};
+    auto mismatches = std::size_t{0};
+    {
+        auto grouper = fun::ExternalGrouper(options);
+        for (std::size_t k = 0; k != 20000; ++k) {
+            const auto scale = int64_t{k % 2 == 0 ? 2 : -1};
+            const auto pt = std::array<int64_t, 3>{coord(gen), coord(gen) % 4, 1};
+            const auto line = static_cast<uint64_t>(gen() % 40);
+            grouper.add({scale * pt[0], scale * pt[1], scale * pt[2]}, line);
+            expected[fun::canonical_coord(pt)].insert(line);
+        }
+        CHECK(grouper.records() == 20000);
+        auto seen = std::set<std::array<int64_t, 3>>{};
+        const auto distinct = grouper.finish(
+            [&](const std::array<int64_t, 3> &pt, const std::vector<uint64_t> &lines) {
+                ++grouped;
+                CHECK(seen.insert(pt).second);
+                const auto it = expected.find(pt);
+                if (it == expected.end()
+                    || std::vector<uint64_t>(it->second.begin(), it->second.end()) != lines) {
+                    ++mismatches;
+                }
+            });
+        CHECK(distinct == expected.size());
+    }
+    CHECK(grouped == expected.size());
+    CHECK(mismatches == 0);
+    CHECK(std::filesystem::is_empty(dir));  // spill files are removed
+}
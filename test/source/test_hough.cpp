@@ -0,0 +1,66 @@
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <projgeom/pg_hough.hpp>
+#include <projgeom/pg_object.hpp>
+#include <random>
+#include <vector>
+
+TEST_CASE("Dual Hough (vanishing points, one at infinity)") {
+    const auto targets = std::vector<PgPoint>{
+        PgPoint({100, 50, 1}), PgPoint({3, 7, 1}), PgPoint({1, 2, 0})};
+    auto gen = std::mt19937{5};
+    auto coord = std::uniform_int_distribution<int64_t>{-300, 300};
+    auto lines = std::vector<PgLine>{};
+    for (const auto &p : targets) {
+        for (int i = 0; i != 20; ++i) {
+            lines.push_back(p.meet(PgPoint({coord(gen), coord(gen), 1})));
+        }
+    }
+    for (int i = 0; i != 40; ++i) {
+        const auto p = PgPoint({coord(gen), coord(gen), 1});
+        lines.push_back(p.meet(PgPoint({coord(gen), coord(gen), 1})));
+    }
+
+    auto hough = fun::DualHough<PgLine>(48, 300.0);
+    const auto peaks = hough.detect(lines, 3, 10);
+    REQUIRE(peaks.size() == 3);
+    for (const auto &p : targets) {
+        const auto hit = std::find_if(peaks.begin(), peaks.end(),
+                                      [&](const auto &peak) { return peak.point == p; });
+        REQUIRE(hit != peaks.end());
+        CHECK(hit->lines.size() >= 20);
+        for (const auto j : hit->lines) CHECK(lines[j].incident(p));
+    }
+
+    // every line votes along its great circle, so the target bins are hot
+    for (const auto &p : targets) CHECK(hough.votes()[hough.bin_of(p)] >= 10);
+
+    // the accumulator is reused across frames
+    CHECK(hough.detect(lines, 3, 10).size() == 3);
+    CHECK(fun::concurrent_points(lines, 1, 10, 32, 300.0).size() == 1);
+}
+
+TEST_CASE("Dual Hough (noise lines listed first)") {
+    // many candidate lines near the target that do not pass through it come
+    // first; the refined point must not depend on the order of the lines
+    const auto target = PgPoint({37, -21, 1});
+    auto gen = std::mt19937{81};
+    auto coord = std::uniform_int_distribution<int64_t>{-300, 300};
+    auto near = std::uniform_int_distribution<int64_t>{-4, 4};
+    for (int trial = 0; trial != 10; ++trial) {
+        auto lines = std::vector<PgLine>{};
+        while (lines.size() != 40) {
+            const auto p = PgPoint({37 * 8 + near(gen), -21 * 8 + near(gen), 8});
+            if (p == target) continue;
+            lines.push_back(p.meet(PgPoint({coord(gen), coord(gen), 1})));
+        }
+        for (int i = 0; i != 15; ++i) {
+            lines.push_back(target.meet(PgPoint({coord(gen), coord(gen), 1})));
+        }
+        const auto peaks = fun::concurrent_points(lines, 1, 10, 32, 300.0);
+        REQUIRE(peaks.size() == 1);
+        CHECK(peaks[0].point == target);
+        CHECK(peaks[0].lines.size() >= 15);
+    }
+}
@@ -0,0 +1,141 @@
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <projgeom/pg_incidence_join.hpp>
+#include <projgeom/pg_object.hpp>
+#include <projgeom/pg_wide.hpp>
+#include <projgeom/pg_workload.hpp>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+static auto brute_force(const std::vector<PgPoint> &points, const std::vector<PgLine> &lines)
+    -> std::vector<fun::IncidencePair> {
+    auto result = std::vector<fun::IncidencePair>{};
+    for (std::size_t i = 0; i != points.size(); ++i) {
+        const auto &c = points[i].coord;
+        if (c[0] == 0 && c[1] == 0 && c[2] == 0) continue;
+        for (std::size_t j = 0; j != lines.size(); ++j) {
+            if (points[i].incident(lines[j])) result.push_back(fun::IncidencePair{i, j});
+        }
+    }
+    return result;
+}
+
+TEST_CASE("Incidence join (grid points, lines through them)") {
+    auto gen = std::mt19937{53};
+    auto coord = std::uniform_int_distribution<int64_t>{-20, 20};
+    auto weight = std::uniform_int_distribution<int64_t>{1, 3};
+    auto points = std::vector<PgPoint>{};
+    for (std::size_t i = 0; i != 1500; ++i) {
+        points.push_back(PgPoint({coord(gen), coord(gen), weight(gen)}));
+    }
+    points.push_back(PgPoint({2, 1, 0}));   // at infinity
+    points.push_back(PgPoint({-4, -2, 0}));
+    points.push_back(PgPoint({0, 0, 0}));   // not a point
+    auto lines = std::vector<PgLine>{};
+    for (std::size_t j = 0; j != 400; ++j) {
+        const auto &p = points[gen() % 1500];
+        const auto &q = points[gen() % 1500];
+        if (p == q) continue;
+        lines.push_back(p.meet(q));
+    }
+    lines.push_back(PgLine({1, -2, 7}));   // direction (2, 1)
+    lines.push_back(PgLine({0, 0, -3}));   // line at infinity
+    lines.push_back(PgLine({1, 0, 0}));    // x = 0
+    lines.push_back(lines.front());        // duplicate line
+
+    const auto expected = brute_force(points, lines);
+    CHECK(expected.size() > 1000);
+    for (const auto tile : {std::size_t{1}, std::size_t{64}, std::size_t{4096}}) {
+        CHECK(fun::incidence_join(points, lines, tile) == expected);
+    }
+    CHECK(fun::IncidenceJoin<PgPoint>(lines).directions() < lines.size());
+
+    // one tiling of the points serves several line sets
+    const auto tiles = fun::PointTiles<PgPoint>(points, 64);
+    for (const auto half : {std::size_t{0}, std::size_t{1}}) {
+        auto subset = std::vector<PgLine>{};
+        for (auto j = half; j < lines.size(); j += 2) subset.push_back(lines[j]);
+        auto pairs = std::vector<fun::IncidencePair>{};
+        fun::IncidenceJoin<PgPoint>(subset).run(
+            tiles, [&](const fun::IncidencePair &pair) { pairs.push_back(pair); });
+        std::sort(pairs.begin(), pairs.end());
+        CHECK(pairs == brute_force(points, subset));
+    }
+}
+
+TEST_CASE("Incidence join (large coordinates)") {
+    const auto big = int64_t{1} << 40;
+    auto points = std::vector<PgPoint>{};
+    auto lines = std::vector<PgLine>{};
+    for (int64_t k = 1; k <= 50; ++k) {
+        lines.push_back(PgLine({k, big + k, -big}));
+        points.push_back(PgPoint({big, 1, k + 1}));
+        points.push_back(PgPoint({big + k, -k, 1}));  // k (big + k) - (big + k) k = 0
+    }
+    const auto expected = brute_force(points, lines);
+    CHECK(!expected.empty());
+    CHECK(fun::incidence_join(points, lines, 16) == expected);
+}
+
+TEST_CASE("Incidence join (large cancelling terms, non-unit z)") {
+    // a X + b Y is small on these lines while a X and b Y are huge, and
+    // X = x / z, Y = y / z are not exact doubles
+    auto gen = std::mt19937_64{91};
+    auto small = std::uniform_int_distribution<int64_t>{-9, 9};
+    auto weight = std::uniform_int_distribution<int64_t>{3, 22};
+    auto low = std::uniform_int_distribution<int64_t>{0, 1 << 16};
+    auto lines = std::vector<PgLine>{};
+    for (int64_t b = 1; b <= 6; ++b) {
+        lines.push_back(PgLine({1, b, small(gen)}));
+        lines.push_back(PgLine({1, -b, small(gen)}));
+    }
+    for (const auto shift : {20, 26, 30, 36, 44}) {
+        auto points = std::vector<PgPoint>{};
+        for (std::size_t i = 0; i != 800; ++i) {
+            const auto &l = lines[i % lines.size()].coord;
+            const auto y = (int64_t{1} << shift) + low(gen);
+            const auto z = weight(gen);
+            points.push_back(PgPoint({-(l[1] * y + l[2] * z), y, z}));  // on line l
+        }
+        const auto expected = brute_force(points, lines);
+        CHECK(expected.size() >= points.size());
+        for (const auto tile : {std::size_t{1}, std::size_t{16}}) {
+            CHECK(fun::incidence_join(points, lines, tile) == expected);
+        }
+    }
+}
+
+TEST_CASE("Incidence join (degenerate workloads)") {
+    for (const auto kind : {fun::Workload::NearCollinear, fun::Workload::AtInfinity,
+                            fun::Workload::MixedMagnitude, fun::Workload::Concyclic}) {
+        auto spec = fun::WorkloadSpec{};
+        spec.kind = kind;
+        spec.count = 3000;
+        const auto points = fun::generate_objects<PgPoint>(spec);
+        // lines through pairs of the first points, some with terms near 2^61
+        auto lines = std::vector<PgLine>{};
+        for (std::size_t i = 0; i != 8; ++i) {
+            for (auto j = i + 1; j != 8; ++j) {
+                try {
+                    const auto ln = fun::narrow_reduced<3>(
+                        fun::cross_wide(points[i].coord, points[j].coord));
+                    if (ln[0] != 0 || ln[1] != 0 || ln[2] != 0) lines.push_back(PgLine(ln));
+                } catch (const std::overflow_error &) {
+                }
+            }
+        }
+        REQUIRE(!lines.empty());
+        auto expected = std::vector<fun::IncidencePair>{};
+        for (std::size_t i = 0; i != points.size(); ++i) {
+            for (std::size_t j = 0; j != lines.size(); ++j) {
+                if (fun::sign_of(fun::dot_wide(points[i].coord, lines[j].coord)) == 0) {
+                    expected.push_back(fun::IncidencePair{i, j});
+                }
+            }
+        }
+        CHECK(expected.size() >= 2 * lines.size());
+        CHECK(fun::incidence_join(points, lines, 64) == expected);
+    }
+}
@@ -0,0 +1,181 @@
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <projgeom/pg_canonical.hpp>
+#include <projgeom/pg_mapped_index.hpp>
+#include <projgeom/pg_object.hpp>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using Coord = std::array<int64_t, 3>;
+
+static auto index_path(const std::string &name) -> std::string {
+    const auto dir = std::filesystem::temp_directory_path() / "projgeom_mapped_index";
+    std::filesystem::create_directories(dir);
+    return (dir / name).string();
+}
+
+TEST_CASE("Mapped hash index") {
+    const auto path = index_path("hash.pgi");
+    auto gen = std::mt19937{95};
+    auto coord = std::uniform_int_distribution<int64_t>{-50, 50};
+    auto points = std::vector<PgPoint>{};
+    auto keys = std::set<Coord>{};
+    for (std::size_t k = 0; k != 3000; ++k) {
+        const auto pt = Coord{coord(gen), coord(gen), coord(gen) % 4};
+        if (pt == Coord{0, 0, 0}) continue;
+        points.emplace_back(PgPoint(pt));
+        keys.insert(fun::canonical_coord(pt));
+    }
+    CHECK(fun::MappedHashIndex::build_objects(path, points) == keys.size());
+
+    const auto index = fun::MappedHashIndex(path);
+    const auto other = fun::MappedHashIndex(path);  // a second, independent mapping
+    REQUIRE(index.size() == keys.size());
+    CHECK(index.coord(0) == fun::canonical_coord(points[0].coord));
+    for (const auto &pt : points) {
+        const auto id = index.find({-2 * pt.coord[0], -2 * pt.coord[1], -2 * pt.coord[2]});
+        REQUIRE(id != fun::MappedHashIndex::npos);
+        CHECK(index.object<PgPoint>(id) == pt);
+        CHECK(other.contains_object(pt));
+    }
+    CHECK_FALSE(index.contains({1000, 1, 1}));
+    CHECK_THROWS_AS(fun::MappedGridIndex{path}, std::runtime_error);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Mapped grid index") {
+    const auto path = index_path("grid.pgi");
+    auto gen = std::mt19937{96};
+    auto coord = std::uniform_int_distribution<int64_t>{-1000, 1000};
+    auto points = std::vector<Coord>{};
+    for (std::size_t k = 0; k != 4000; ++k) {
+        const auto z = int64_t{1 + static_cast<int64_t>(gen() % 3)};
+        points.push_back({coord(gen) * z, coord(gen) * z, k % 2 == 0 ? z : -z});
+    }
+    points.push_back({1, 2, 0});
+    points.push_back({3, -1, 0});
+    fun::MappedGridIndex::build(path, points);
+    const auto grid = fun::MappedGridIndex(path);
+    REQUIRE(grid.size() == points.size());
+    CHECK(grid.infinite_begin() == points.size() - 2);
+    for (std::size_t i = 0; i != grid.size(); ++i) {
+        CHECK(grid.coord(i) == fun::canonical_coord(points[grid.id(i)]));
+    }
+
+    // box query agrees with a scan
+    auto hits = std::vector<std::size_t>{};
+    grid.query_box(-100, 20, 250, 400, [&](std::size_t i) { hits.push_back(grid.id(i)); });
+    auto expected = std::vector<std::size_t>{};
+    for (std::size_t i = 0; i != points.size(); ++i) {
+        const auto p = fun::canonical_coord(points[i]);
+        if (p[2] != 0 && -100 * p[2] <= p[0] && p[0] <= 250 * p[2] && 20 * p[2] <= p[1]
+            && p[1] <= 400 * p[2]) {
+            expected.push_back(i);
+        }
+    }
+    std::sort(hits.begin(), hits.end());
+    CHECK(hits == expected);
+
+    // kNN agrees with a scan
+    for (const auto &q : {std::array<double, 2>{0.5, -3.0}, std::array<double, 2>{5000, 5000}}) {
+        const auto near = grid.nearest(q[0], q[1], 10);
+        REQUIRE(near.size() == 10);
+        auto dists = std::vector<double>{};
+        for (std::size_t i = 0; i != grid.infinite_begin(); ++i) {
+            const auto &p = grid.coord(i);
+            const auto dx = static_cast<double>(p[0]) / static_cast<double>(p[2]) - q[0];
+            const auto dy = static_cast<double>(p[1]) / static_cast<double>(p[2]) - q[1];
+            dists.push_back(dx * dx + dy * dy);
+        }
+        auto sorted = dists;
+        std::sort(sorted.begin(), sorted.end());
+        for (std::size_t j = 0; j != near.size(); ++j) CHECK(dists[near[j]] == sorted[j]);
+    }
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Mapped index validation") {
+    const auto path = index_path("bad.pgi");
+    fun::MappedHashIndex::build(path, {{1, 2, 3}, {4, 5, 6}});
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 8);
+    CHECK_THROWS_AS(fun::MappedHashIndex{path}, std::runtime_error);
+    fun::write_objects(path, std::vector<PgPoint>{PgPoint({1, 2, 3})});
+    CHECK_THROWS_AS(fun::MappedHashIndex{path}, std::runtime_error);
+    CHECK_THROWS_AS(fun::MappedHashIndex{path + ".missing"}, std::runtime_error);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Mapped index rebuilt while mapped") {
+    const auto path = index_path("rebuilt.pgi");
+    auto points = std::vector<Coord>{};
+    for (int64_t k = 0; k != 5000; ++k) points.push_back({k, -k, 1});
+    fun::MappedGridIndex::build(path, points);
+    const auto old = fun::MappedGridIndex(path);
+    fun::MappedGridIndex::build(path, std::vector<Coord>{{7, 7, 1}});  // smaller file
+    const auto rebuilt = fun::MappedGridIndex(path);
+    CHECK(rebuilt.size() == 1);
+    REQUIRE(old.size() == points.size());
+    for (std::size_t i = 0; i != old.size(); ++i) {
+        CHECK(old.coord(i) == fun::canonical_coord(points[old.id(i)]));
+    }
+    auto leftovers = 0;
+    for (const auto &entry : std::filesystem::directory_iterator(index_path(""))) {
+        leftovers += entry.path().string().find(".tmp") != std::string::npos ? 1 : 0;
+    }
+    CHECK(leftovers == 0);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Mapped grid index with an oversized cell table") {
+    const auto path = index_path("cells.pgi");
+    fun::MappedGridIndex::build(path, std::vector<Coord>{{1, 2, 1}, {3, 4, 1}});
+    {
+        // columns = rows = 2^31: (columns * rows + 1) * 8 wraps to 8
+        const auto dims = std::array<uint64_t, 2>{uint64_t{1} << 31, uint64_t{1} << 31};
+        auto *file = std::fopen(path.c_str(), "r+b");
+        REQUIRE(file != nullptr);
+        const auto at = sizeof(fun::FileHeader) + offsetof(fun::IndexHeader, dims);
+        std::fseek(file, static_cast<long>(at), SEEK_SET);
+        std::fwrite(dims.data(), sizeof(uint64_t), 2, file);
+        std::fclose(file);
+    }
+    CHECK_THROWS_AS(fun::MappedGridIndex{path}, std::runtime_error);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Mapped hash index without empty slots") {
+    const auto path = index_path("full.pgi");
+    fun::MappedHashIndex::build(path, std::vector<Coord>{{1, 2, 3}, {4, 5, 6}});
+    {
+        // point every slot at entry 1, so that no probe ever meets an empty slot
+        auto *file = std::fopen(path.c_str(), "r+b");
+        REQUIRE(file != nullptr);
+        auto sections = std::array<uint64_t, 4>{};
+        auto capacity = uint64_t{0};
+        std::fseek(file, static_cast<long>(sizeof(fun::FileHeader)
+                                           + offsetof(fun::IndexHeader, sections)),
+                   SEEK_SET);
+        REQUIRE(std::fread(sections.data(), sizeof(uint64_t), 4, file) == 4);
+        std::fseek(file, static_cast<long>(sizeof(fun::FileHeader)
+                                           + offsetof(fun::IndexHeader, dims)),
+                   SEEK_SET);
+        REQUIRE(std::fread(&capacity, sizeof(uint64_t), 1, file) == 1);
+        const auto slots = std::vector<uint64_t>(capacity, 1);
+        std::fseek(file, static_cast<long>(sections[1]), SEEK_SET);
+        std::fwrite(slots.data(), sizeof(uint64_t), slots.size(), file);
+        std::fclose(file);
+    }
+    const auto index = fun::MappedHashIndex(path);
+    CHECK(index.find({7, 8, 9}) == fun::MappedHashIndex::npos);
+    CHECK(index.find({1, 2, 3}) == 0);
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,57 @@
+#include <doctest/doctest.h>
+
+#include <limits>
+#include <projgeom/pg_object.hpp>
+#include <projgeom/pg_pencil.hpp>
+#include <stdexcept>
+#include <vector>
+
+TEST_CASE("Pencil of points (forward differencing)") {
+    const auto p = PgPoint({1, 2, 1});
+    const auto q = PgPoint({-3, 5, 2});
+    const auto pencil = fun::Pencil<PgPoint>(p, q, 7, -4, -2, 3, 50);
+    CHECK(pencil.size() == 50);
+    int64_t k = 0;
+    for (const auto pt : pencil) {
+        CHECK(pt.coord == PgPoint::parametrize(7 - 2 * k, p, -4 + 3 * k, q).coord);
+        CHECK(p.meet(q).incident(pt));
+        ++k;
+    }
+    CHECK(k == 50);
+
+    auto x = std::vector<int64_t>(50);
+    auto y = std::vector<int64_t>(50);
+    auto z = std::vector<int64_t>(50);
+    pencil.fill(x.data(), y.data(), z.data());
+    const auto objects = pencil.to_vector();
+    for (std::size_t i = 0; i != 50; ++i) {
+        CHECK(objects[i].coord == std::array<int64_t, 3>{x[i], y[i], z[i]});
+    }
+}
+
+TEST_CASE("Pencil of lines (dual)") {
+    const auto l = PgLine({1, 0, -2});
+    const auto m = PgLine({0, 1, -3});
+    const auto center = l.meet(m);
+    for (const auto ln : fun::Pencil<PgLine>(l, m, 1, 0, 0, 1, 20)) CHECK(ln.incident(center));
+}
+
+TEST_CASE("Pencil (overflow check)") {
+    const auto big = std::numeric_limits<int64_t>::max() / 4;
+    const auto p = PgPoint({big, 1, 1});
+    const auto q = PgPoint({1, 1, 1});
+    CHECK_NOTHROW(fun::Pencil<PgPoint>(p, q, 1, 0, 1, 0, 4));
+    CHECK_THROWS_AS(fun::Pencil<PgPoint>(p, q, 1, 0, 1, 0, 5), std::overflow_error);
+    CHECK(fun::Pencil<PgPoint>(p, q, 1, 0, 1, 0, 0).size() == 0);
+
+    // the last member is 4 big; stepping past it must not overflow
+    const auto edge = fun::Pencil<PgPoint>(p, q, 1, 0, 1, 0, 4);
+    const auto members = edge.to_vector();
+    REQUIRE(members.size() == 4);
+    CHECK(members[3].coord == std::array<int64_t, 3>{4 * big, 4, 4});
+    auto x = std::vector<int64_t>(4);
+    auto y = std::vector<int64_t>(4);
+    auto z = std::vector<int64_t>(4);
+    edge.fill(x.data(), y.data(), z.data());
+    CHECK(x[3] == 4 * big);
+}
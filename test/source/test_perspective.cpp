@@ -0,0 +1,99 @@
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <array>
+#include <projgeom/pg_object.hpp>
+#include <projgeom/pg_perspective.hpp>
+#include <projgeom/pg_plane.hpp>
+#include <random>
+#include <utility>
+#include <vector>
+
+using Triangle = std::array<PgPoint, 3>;
+
+static auto planted_triangles(std::vector<PgPoint> &centers) -> std::vector<Triangle> {
+    auto gen = std::mt19937{29};
+    auto coord = std::uniform_int_distribution<int64_t>{-6, 6};
+    auto weight = std::uniform_int_distribution<int64_t>{1, 3};
+    auto random_point = [&]() { return PgPoint({coord(gen), coord(gen), weight(gen)}); };
+    auto triangles = std::vector<Triangle>{};
+    while (triangles.size() < 120) {
+        const auto tri = Triangle{random_point(), random_point(), random_point()};
+        if (fun::coincident(tri[0], tri[1], tri[2])) continue;
+        triangles.push_back(tri);
+        if (triangles.size() % 4 != 0) continue;
+        // a partner perspective from a random center
+        const auto center = random_point();
+        auto partner = tri;
+        for (auto &pt : partner) pt = PgPoint::parametrize(weight(gen), pt, weight(gen), center);
+        if (fun::coincident(partner[0], partner[1], partner[2])) continue;
+        triangles.push_back(partner);
+        centers.push_back(center);
+    }
+    triangles.push_back(triangles[3]);  // an exact copy
+    triangles.push_back(Triangle{PgPoint({0, 0, 1}), PgPoint({1, 1, 1}), PgPoint({2, 2, 1})});
+    return triangles;
+}
+
+static auto brute_force(const std::vector<Triangle> &triangles)
+    -> std::vector<std::pair<std::size_t, std::size_t>> {
+    auto result = std::vector<std::pair<std::size_t, std::size_t>>{};
+    for (std::size_t i = 0; i != triangles.size(); ++i) {
+        const auto &t1 = triangles[i];
+        if (fun::coincident(t1[0], t1[1], t1[2])) continue;
+        for (auto j = i + 1; j != triangles.size(); ++j) {
+            const auto &t2 = triangles[j];
+            if (fun::coincident(t2[0], t2[1], t2[2])) continue;
+            if (t1[0] == t2[0] || t1[1] == t2[1] || t1[2] == t2[2]) continue;
+            if (fun::persp(t1, t2)) result.emplace_back(i, j);
+        }
+    }
+    return result;
+}
+
+TEST_CASE("Perspective triangle pairs (all pairs)") {
+    auto centers = std::vector<PgPoint>{};
+    const auto triangles = planted_triangles(centers);
+    const auto expected = brute_force(triangles);
+    CHECK(expected.size() >= centers.size());
+
+    for (const auto tile : {std::size_t{7}, std::size_t{256}}) {
+        const auto found = fun::perspective_pairs(triangles, tile);
+        REQUIRE(found.size() == expected.size());
+        for (std::size_t k = 0; k != found.size(); ++k) {
+            const auto &pair = found[k];
+            CHECK(std::make_pair(pair.first, pair.second) == expected[k]);
+            const auto &t1 = triangles[pair.first];
+            const auto &t2 = triangles[pair.second];
+            for (std::size_t v = 0; v != 3; ++v) {
+                CHECK(t1[v].meet(t2[v]).incident(pair.perspector));
+                const auto w = (v + 1) % 3;
+                const auto meet = t1[v].meet(t1[w]).meet(t2[v].meet(t2[w]));
+                CHECK(meet.incident(pair.perspectrix));
+            }
+        }
+    }
+    CHECK(fun::PerspectiveFinder<PgPoint>(triangles).distinct() == triangles.size() - 2);
+}
+
+TEST_CASE("Perspective triangle pairs (known centers)") {
+    auto centers = std::vector<PgPoint>{};
+    const auto triangles = planted_triangles(centers);
+    const auto finder = fun::PerspectiveFinder<PgPoint>(triangles);
+    auto found = std::vector<std::pair<std::size_t, std::size_t>>{};
+    finder.from_centers(centers, [&](const fun::PerspectivePair<PgPoint> &pair) {
+        CHECK(std::find(centers.begin(), centers.end(), pair.perspector) != centers.end());
+        found.emplace_back(pair.first, pair.second);
+    });
+    std::sort(found.begin(), found.end());
+    CHECK(std::adjacent_find(found.begin(), found.end()) == found.end());
+
+    auto expected = std::vector<std::pair<std::size_t, std::size_t>>{};
+    for (const auto &pair : fun::perspective_pairs(triangles)) {
+        if (std::find(centers.begin(), centers.end(), pair.perspector) != centers.end()) {
+            expected.emplace_back(pair.first, pair.second);
+        }
+    }
+    CHECK(found == expected);
+    CHECK(found.size() >= centers.size());
+}
@@ -0,0 +1,85 @@
+#include <doctest/doctest.h>
+
+#include <projgeom/pg3_object.hpp>
+#include <projgeom/pg_wide.hpp>
+#include <random>
+#include <vector>
+
+template <typename T> static void check_pg3(int64_t range) {
+    using Point = Pg3Point<T>;
+    auto gen = std::mt19937{31};
+    auto coord = std::uniform_int_distribution<int64_t>{-range, range};
+    auto random_point = [&]() {
+        return Point{{T(coord(gen)), T(coord(gen)), T(coord(gen)), T(3 + coord(gen) % 3)}};
+    };
+    for (int trial = 0; trial != 100; ++trial) {
+        const auto p = random_point();
+        const auto q = random_point();
+        const auto r = random_point();
+        const auto s = random_point();
+        const auto pq = p.join(q);
+        if (pq.is_zero()) continue;
+        CHECK(pq.is_valid());
+        CHECK(pq.incident(p));
+        CHECK(p.incident(pq));
+        CHECK(pq.incident(Point::parametrize(T(3), p, T(-2), q)));
+
+        const auto plane = pq.join(r);
+        if (plane.is_zero()) continue;
+        CHECK(plane.incident(p));
+        CHECK(plane.incident(q));
+        CHECK(plane.incident(r));
+        CHECK(plane.incident(pq));
+        CHECK(r.join(pq) == plane);
+
+        // the line where two planes through pq meet is pq again
+        const auto other = pq.join(s);
+        if (other.is_zero() || other == plane) continue;
+        CHECK(plane.meet(other) == pq);
+        CHECK(plane.meet(other).dual() == Pg3Line<T>{fun::pg3::wedge(plane.coord, other.coord)});
+
+        // a line meets a plane in a point on both
+        const auto rs = r.join(s);
+        const auto x = rs.meet(other);
+        if (!x.is_zero()) {
+            CHECK(rs.incident(x));
+            CHECK(other.incident(x));
+            CHECK(other.meet(rs) == x);
+            if (x != p) CHECK(x.join(p).intersects(rs));
+        }
+        // pq and rs are coplanar exactly when p, q, r, s are
+        CHECK(pq.intersects(rs) == plane.incident(s));
+    }
+}
+
+// meeting two planes through three points each is degree 6 in the coordinates
+TEST_CASE("PG(3) join, meet and incidence (int64)") { check_pg3<int64_t>(30); }
+
+TEST_CASE("PG(3) join, meet and incidence (int128)") { check_pg3<fun::int128_t>(1 << 14); }
+
+TEST_CASE("PG(3) SoA kernels") {
+    auto gen = std::mt19937{37};
+    auto coord = std::uniform_int_distribution<int64_t>{-50, 50};
+    auto pts_p = fun::Pg3PointsSoA<int64_t>{};
+    auto pts_q = fun::Pg3PointsSoA<int64_t>{};
+    for (int i = 0; i != 1000; ++i) {
+        pts_p.push_back(Pg3Point<int64_t>{{coord(gen), coord(gen), coord(gen), 1}});
+        pts_q.push_back(Pg3Point<int64_t>{{coord(gen), coord(gen), 0, coord(gen)}});
+    }
+    const auto lines = fun::pg3_join_batch(pts_p, pts_q, 128);
+    REQUIRE(lines.size() == 1000);
+    for (std::size_t i = 0; i != lines.size(); ++i) {
+        CHECK(lines[i].coord == pts_p[i].join(pts_q[i]).coord);
+    }
+
+    const auto plane = Pg3Plane<int64_t>{{1, -1, 2, 0}};
+    auto on = std::vector<uint8_t>(pts_p.size());
+    fun::pg3_incident_batch(plane, pts_p, on.data(), 128);
+    auto rec = std::vector<int64_t>(lines.size());
+    fun::pg3_reciprocal_batch(lines[0], lines, rec.data(), 128);
+    for (std::size_t i = 0; i != pts_p.size(); ++i) {
+        CHECK((on[i] == 1) == plane.incident(pts_p[i]));
+        CHECK(rec[i] == lines[0].reciprocal(lines[i]));
+    }
+    CHECK(rec[0] == 0);
+}
@@ -0,0 +1,59 @@
+#include <doctest/doctest.h>
+
+#include <projgeom/pg_object.hpp>
+#include <projgeom/pg_polygon.hpp>
+#include <vector>
+
+using fun::Location;
+
+TEST_CASE("Point in polygon (square)") {
+    const auto square = std::vector<PgPoint>{PgPoint({0, 0, 1}), PgPoint({4, 0, 1}),
+                                             PgPoint({4, 4, 1}), PgPoint({0, 4, 1})};
+    const auto index = fun::PolygonIndex<PgPoint>(square);
+    CHECK(index.locate(PgPoint({1, 1, 1})) == Location::Inside);
+    CHECK(index.locate(PgPoint({5, 1, 1})) == Location::Outside);
+    CHECK(index.locate(PgPoint({4, 2, 1})) == Location::Boundary);
+    CHECK(index.locate(PgPoint({0, 0, 1})) == Location::Boundary);
+    CHECK(index.locate(PgPoint({-6, -2, -2})) == Location::Inside);  // (3, 1)
+    CHECK(index.locate(PgPoint({8, 3, 2})) == Location::Boundary);   // (4, 3/2)
+    CHECK(index.locate(PgPoint({9, 3, 2})) == Location::Outside);    // (9/2, 3/2)
+}
+
+TEST_CASE("Point in polygon (batch agrees with single)") {
+    // concave "C" shape, clockwise
+    const auto shape = std::vector<PgPoint>{
+        PgPoint({0, 0, 1}), PgPoint({0, 6, 1}), PgPoint({6, 6, 1}), PgPoint({6, 4, 1}),
+        PgPoint({2, 4, 1}), PgPoint({2, 2, 1}), PgPoint({6, 2, 1}), PgPoint({6, 0, 1}),
+    };
+    const auto index = fun::PolygonIndex<PgPoint>(shape, 3);
+    auto points = std::vector<PgPoint>{};
+    for (int64_t x = -1; x <= 14; ++x) {
+        for (int64_t y = -1; y <= 14; ++y) points.emplace_back(std::array<int64_t, 3>{x, y, 2});
+    }
+    const auto result = fun::locate_points(index, points, 7);
+    for (std::size_t i = 0; i != points.size(); ++i) {
+        CHECK(result[i] == index.locate(points[i]));
+    }
+    CHECK(index.locate(PgPoint({3, 3, 1})) == Location::Outside);
+    CHECK(index.locate(PgPoint({1, 3, 1})) == Location::Inside);
+    CHECK(index.locate(PgPoint({4, 4, 1})) == Location::Boundary);
+
+    const auto hits = fun::locate_hits(std::vector<fun::PolygonIndex<PgPoint>>{index, index},
+                                       points, 5);
+    std::size_t inside = 0;
+    for (const auto &loc : result) inside += loc != Location::Outside ? 1 : 0;
+    CHECK(hits.size() == 2 * inside);
+}
+
+TEST_CASE("Point in polygon (points at infinity)") {
+    const auto square = std::vector<PgPoint>{PgPoint({0, 0, 1}), PgPoint({4, 0, 1}),
+                                             PgPoint({4, 4, 1}), PgPoint({0, 4, 1})};
+    const auto index = fun::PolygonIndex<PgPoint>(square);
+    CHECK(index.locate(PgPoint({1, 1, 0})) == Location::Outside);
+    CHECK(index.locate(PgPoint({0, -3, 0})) == Location::Outside);
+    const auto points = std::vector<PgPoint>{PgPoint({1, 1, 1}), PgPoint({1, 1, 0}),
+                                             PgPoint({4, 2, 1}), PgPoint({2, 0, 0})};
+    const auto result = fun::locate_points(index, points, 1);
+    CHECK(result == std::vector<Location>{Location::Inside, Location::Outside,
+                                          Location::Boundary, Location::Outside});
+}
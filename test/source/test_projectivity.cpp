@@ -0,0 +1,87 @@
+#include <doctest/doctest.h>
+
+#include <array>
+#include <limits>
+#include <projgeom/pg_object.hpp>
+#include <projgeom/pg_projectivity.hpp>
+#include <stdexcept>
+#include <vector>
+
+TEST_CASE("Projectivity1D (three pairs)") {
+    const auto x = std::array<std::array<int64_t, 2>, 3>{{{1, 0}, {3, 1}, {-2, 5}}};
+    const auto y = std::array<std::array<int64_t, 2>, 3>{{{4, 1}, {0, 1}, {7, -3}}};
+    const auto f = fun::Projectivity1D::from_pairs(x, y);
+    CHECK(f.det() != 0);
+    for (std::size_t i = 0; i != 3; ++i) {
+        const auto img = f.apply(x[i]);
+        CHECK(img[0] * y[i][1] == img[1] * y[i][0]);
+    }
+    const auto g = f.inverse();
+    CHECK(g.compose(f) == fun::Projectivity1D::identity());
+    CHECK(f.compose(g) == fun::Projectivity1D::identity());
+    CHECK(f != fun::Projectivity1D::identity());
+    for (std::size_t i = 0; i != 3; ++i) {
+        const auto back = g.apply(y[i]);
+        CHECK(back[0] * x[i][1] == back[1] * x[i][0]);
+    }
+    const auto same = std::array<std::array<int64_t, 2>, 3>{{{1, 0}, {2, 0}, {0, 1}}};
+    CHECK_THROWS_AS(fun::Projectivity1D::from_pairs(same, y), std::invalid_argument);
+}
+
+TEST_CASE("Projectivity1D (chain of perspectivities)") {
+    const auto charts = std::vector<fun::LineChart<PgPoint>>{
+        {PgPoint({0, 0, 1}), PgPoint({1, 0, 1})},
+        {PgPoint({0, 4, 1}), PgPoint({1, 5, 1})},
+        {PgPoint({-3, 0, 1}), PgPoint({-3, 1, 1})},
+        {PgPoint({2, -1, 1}), PgPoint({5, 1, 2})},
+    };
+    const auto centers = std::vector<PgPoint>{PgPoint({2, 9, 3}), PgPoint({1, 2, 0}),
+                                              PgPoint({-7, 5, 2})};
+    auto chain = fun::Projectivity1D::identity();
+    for (std::size_t i = 0; i != centers.size(); ++i) {
+        const auto step = fun::perspectivity(centers[i], charts[i], charts[i + 1]);
+        // the image of a chart point agrees with projecting it from the center
+        const auto pt = charts[i].point({3, -2});
+        const auto proj = centers[i].meet(pt).meet(charts[i + 1].line());
+        CHECK(charts[i + 1].point(step.apply({3, -2})) == proj);
+        chain = step.compose(chain);
+    }
+
+    for (int64_t u = -4; u <= 4; ++u) {
+        for (int64_t v = -3; v <= 3; ++v) {
+            if (u == 0 && v == 0) continue;
+            auto pt = charts[0].point({u, v});
+            CHECK(charts[0].coords(pt)[0] * v == charts[0].coords(pt)[1] * u);
+            for (std::size_t i = 0; i != centers.size(); ++i) {
+                pt = centers[i].meet(pt).meet(charts[i + 1].line());
+            }
+            CHECK(charts.back().point(chain.apply({u, v})) == pt);
+        }
+    }
+    CHECK_THROWS_AS(fun::perspectivity(PgPoint({1, 0, 1}), charts[0], charts[1]),
+                    std::invalid_argument);
+    CHECK_THROWS_AS(fun::LineChart<PgPoint>(PgPoint({1, 2, 1}), PgPoint({2, 4, 2})),
+                    std::invalid_argument);
+}
+
+TEST_CASE("Projectivity1D (batch apply)") {
+    const auto f = fun::Projectivity1D({3, -7, 2, 5});
+    const auto n = std::size_t{1000};
+    auto u = std::vector<int64_t>(n);
+    auto v = std::vector<int64_t>(n);
+    for (std::size_t i = 0; i != n; ++i) {
+        u[i] = static_cast<int64_t>(i % 37) - 18;
+        v[i] = static_cast<int64_t>(i % 23) - 11;
+    }
+    u[900] = std::numeric_limits<int64_t>::max() / 2;  // forces the wide path in its chunk
+    v[900] = std::numeric_limits<int64_t>::max() / 2;
+    auto out_u = std::vector<int64_t>(n);
+    auto out_v = std::vector<int64_t>(n);
+    f.apply_batch(u.data(), v.data(), n, out_u.data(), out_v.data(), 128);
+    for (std::size_t i = 0; i != n; ++i) {
+        const auto img = f.apply({u[i], v[i]});
+        CHECK(fun::mul_wide(img[0], out_v[i]) == fun::mul_wide(img[1], out_u[i]));
+        CHECK((out_u[i] != 0 || out_v[i] != 0) == (u[i] != 0 || v[i] != 0));
+    }
+    CHECK(out_u[5] == 3 * u[5] - 7 * v[5]);
+}
@@ -0,0 +1,154 @@
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <projgeom/pg_mapped_index.hpp>
+#include <projgeom/pg_object.hpp>
+#include <projgeom/pg_protocol.hpp>
+#include <projgeom/pg_query_service.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef PROJGEOM_HAS_UNIX_SOCKETS
+#    include <sys/socket.h>
+#    include <unistd.h>
+#endif
+
+static auto make_request(fun::QueryOp op, uint32_t id, std::vector<int64_t> words)
+    -> fun::QueryRequest {
+    auto request = fun::QueryRequest{};
+    request.header.op = static_cast<uint16_t>(op);
+    request.header.id = id;
+    request.header.words = static_cast<uint32_t>(words.size());
+    request.words = std::move(words);
+    return request;
+}
+
+TEST_CASE("Query service batch") {
+    auto points = std::vector<PgPoint>{};
+    for (int64_t i = 0; i != 10; ++i) {
+        for (int64_t j = 0; j != 10; ++j) points.emplace_back(PgPoint({i, j, 1}));
+    }
+    const auto dir = std::filesystem::temp_directory_path() / "projgeom_query_service";
+    std::filesystem::create_directories(dir);
+    const auto grid = (dir / "grid.pgi").string();
+    fun::MappedGridIndex::build_objects(grid, points);
+
+    auto service = fun::QueryService{};
+    service.set_points(points);
+    service.set_polygon({PgPoint({0, 0, 1}), PgPoint({4, 0, 1}), PgPoint({4, 4, 1}),
+                         PgPoint({0, 4, 1})});
+    service.set_grid(grid);
+
+    using fun::QueryOp;
+    const auto batch = std::vector<fun::QueryRequest>{
+        make_request(QueryOp::Incident, 1, {1, -1, 0}),     // the diagonal x = y
+        make_request(QueryOp::Incident, 2, {0, 2, -6}),     // y = 3
+        make_request(QueryOp::Meet, 3, {0, 0, 1, 2, 2, 2}),
+        make_request(QueryOp::Nearest, 4, {18, 14, 2, 1}),  // (9, 7)
+        make_request(QueryOp::Collinear, 5, {0, 0, 1, 1, 1, 1, 5, 5, 1}),
+        make_request(QueryOp::Collinear, 6, {0, 0, 1, 1, 1, 1, 5, 4, 1}),
+        make_request(QueryOp::Locate, 7, {2, 2, 1}),
+        make_request(QueryOp::Locate, 8, {8, 0, 2}),
+        make_request(QueryOp::Locate, 9, {9, 9, 1}),
+        make_request(QueryOp::Meet, 10, {1, 2}),            // wrong length
+        make_request(static_cast<QueryOp>(77), 11, {}),     // unknown op
+        make_request(QueryOp::Stats, 12, {}),
+    };
+    const auto responses = service.execute(batch);
+    REQUIRE(responses.size() == batch.size());
+    for (std::size_t i = 0; i != batch.size(); ++i) {
+        CHECK(responses[i].header.id == batch[i].header.id);
+        CHECK(responses[i].header.words == responses[i].words.size());
+    }
+    const auto ok = static_cast<uint16_t>(fun::QueryStatus::Ok);
+    CHECK(responses[0].words == std::vector<int64_t>{0, 11, 22, 33, 44, 55, 66, 77, 88, 99});
+    CHECK(responses[1].words == std::vector<int64_t>{3, 13, 23, 33, 43, 53, 63, 73, 83, 93});
+    CHECK(responses[2].words == std::vector<int64_t>{-1, 1, 0});
+    CHECK(responses[3].words == std::vector<int64_t>{97});
+    CHECK(responses[4].words == std::vector<int64_t>{1});
+    CHECK(responses[5].words == std::vector<int64_t>{0});
+    CHECK(responses[6].words
+          == std::vector<int64_t>{static_cast<int64_t>(fun::Location::Inside)});
+    CHECK(responses[7].words
+          == std::vector<int64_t>{static_cast<int64_t>(fun::Location::Boundary)});
+    CHECK(responses[8].words
+          == std::vector<int64_t>{static_cast<int64_t>(fun::Location::Outside)});
+    for (std::size_t i = 0; i != 9; ++i) CHECK(responses[i].header.status == ok);
+    CHECK(responses[9].header.status == static_cast<uint16_t>(fun::QueryStatus::BadRequest));
+    CHECK(responses[10].header.status == static_cast<uint16_t>(fun::QueryStatus::BadRequest));
+
+    const auto stats = fun::QueryStats::from_words(responses[11].words);
+    CHECK(stats.requests == batch.size());
+    CHECK(stats.batches == 1);
+    CHECK(stats.errors == 2);
+    CHECK(stats.per_op[static_cast<std::size_t>(QueryOp::Incident) - 1] == 2);
+    CHECK(stats.p50_ns <= stats.p99_ns);
+    CHECK(stats.p99_ns <= stats.max_ns);
+    CHECK(service.stats().requests == batch.size());
+
+    auto bare = fun::QueryService{};
+    const auto missing = bare.execute({make_request(QueryOp::Locate, 1, {1, 1, 1}),
+                                       make_request(QueryOp::Nearest, 2, {1, 1, 1, 3}),
+                                       make_request(QueryOp::Incident, 3, {1, -1, 0})});
+    CHECK(missing[0].header.status == static_cast<uint16_t>(fun::QueryStatus::Unavailable));
+    CHECK(missing[1].header.status == static_cast<uint16_t>(fun::QueryStatus::Unavailable));
+    CHECK(missing[2].header.status == static_cast<uint16_t>(fun::QueryStatus::Unavailable));
+    std::filesystem::remove(grid);
+}
+
+TEST_CASE("Query service locate range") {
+    auto service = fun::QueryService{};
+    service.set_polygon({PgPoint({0, 0, 1}), PgPoint({4, 0, 1}), PgPoint({4, 4, 1}),
+                         PgPoint({0, 4, 1})});
+    const auto big = int64_t{1} << 60;
+    const auto responses = service.execute({
+        make_request(fun::QueryOp::Locate, 1, {3 * big, 2 * big, big}),  // (3, 2)
+        make_request(fun::QueryOp::Locate, 2, {2 * big, big, -big}),      // (-2, -1)
+        make_request(fun::QueryOp::Locate, 3, {2, 2, INT64_MIN}),
+        make_request(fun::QueryOp::Locate, 4, {int64_t{1} << 20, 1, 1}),
+    });
+    const auto ok = static_cast<uint16_t>(fun::QueryStatus::Ok);
+    const auto bad = static_cast<uint16_t>(fun::QueryStatus::BadRequest);
+    CHECK(responses[0].header.status == ok);
+    CHECK(responses[0].words
+          == std::vector<int64_t>{static_cast<int64_t>(fun::Location::Inside)});
+    CHECK(responses[1].header.status == ok);
+    CHECK(responses[1].words
+          == std::vector<int64_t>{static_cast<int64_t>(fun::Location::Outside)});
+    CHECK(responses[2].header.status == bad);  // no negation overflow
+    CHECK(responses[3].header.status == bad);
+
+    service.set_polygon({PgPoint({0, 0, big}), PgPoint({4 * big, 0, big}),
+                         PgPoint({0, 4 * big, big})});
+    CHECK_THROWS_AS(service.set_polygon({PgPoint({0, 0, 1}), PgPoint({int64_t{1} << 20, 0, 1}),
+                                         PgPoint({0, 4, 1})}),
+                    std::invalid_argument);
+}
+
+#ifdef PROJGEOM_HAS_UNIX_SOCKETS
+TEST_CASE("Query protocol framing") {
+    int fds[2];
+    REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    auto header = fun::QueryHeader{};
+    header.op = static_cast<uint16_t>(fun::QueryOp::Meet);
+    header.id = 42;
+    header.words = 6;
+    const auto words = std::vector<int64_t>{1, 2, 3, -4, 5, INT64_MIN};
+    CHECK(fun::write_message(fds[0], header, words.data()));
+    auto back = fun::QueryHeader{};
+    auto back_words = std::vector<int64_t>{};
+    REQUIRE(fun::read_message(fds[1], back, back_words));
+    CHECK(back.id == 42);
+    CHECK(back.op == header.op);
+    CHECK(back_words == words);
+
+    const char garbage[16] = "not a message!!";
+    CHECK(::write(fds[0], garbage, sizeof(garbage)) == 16);
+    CHECK_THROWS_AS(fun::read_message(fds[1], back, back_words), std::runtime_error);
+    ::close(fds[0]);
+    CHECK_FALSE(fun::read_message(fds[1], back, back_words));
+    ::close(fds[1]);
+}
+#endif
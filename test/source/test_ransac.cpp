@@ -0,0 +1,70 @@
+#include <doctest/doctest.h>
+
+#include <cmath>
+#include <projgeom/pg_object.hpp>
+#include <projgeom/pg_ransac.hpp>
+#include <random>
+#include <vector>
+
+TEST_CASE("RANSAC (exact incidence, two lines)") {
+    auto points = std::vector<PgPoint>{};
+    for (int64_t x = 0; x != 40; ++x) points.emplace_back(std::array<int64_t, 3>{x, 2 * x + 1, 1});
+    for (int64_t x = 0; x != 25; ++x) points.emplace_back(std::array<int64_t, 3>{x, 60 - x, 1});
+    auto gen = std::mt19937{3};
+    auto coord = std::uniform_int_distribution<int64_t>{-500, 500};
+    for (int i = 0; i != 30; ++i) {
+        points.emplace_back(std::array<int64_t, 3>{coord(gen), coord(gen), 1});
+    }
+
+    auto opts = fun::RansacOptions{};
+    opts.threshold = 0;
+    opts.max_lines = 3;
+    opts.min_inliers = 10;
+    const auto lines = fun::ransac_lines(points, opts);
+    REQUIRE(lines.size() == 2);
+    CHECK(lines[0].line == PgLine({2, -1, 1}));
+    CHECK(lines[0].inliers.size() >= 40);
+    CHECK(lines[1].line == PgLine({1, 1, -60}));
+    CHECK(lines[1].inliers.size() >= 24);  // (20, 41) already went to the first line
+    for (const auto &found : lines) {
+        for (const auto i : found.inliers) CHECK(found.line.incident(points[i]));
+    }
+}
+
+TEST_CASE("RANSAC (distance threshold, noisy line)") {
+    // y = x / 2 + 3 sampled at tenths, jittered by at most 0.3
+    auto gen = std::mt19937{11};
+    auto jitter = std::uniform_int_distribution<int64_t>{-3, 3};
+    auto coord = std::uniform_int_distribution<int64_t>{-2000, 2000};
+    auto points = std::vector<PgPoint>{};
+    for (int64_t x = 0; x != 200; x += 2) {
+        points.emplace_back(std::array<int64_t, 3>{10 * x, 5 * x + 30 + jitter(gen), 10});
+    }
+    for (int i = 0; i != 100; ++i) {
+        points.emplace_back(std::array<int64_t, 3>{coord(gen), coord(gen), 10});
+    }
+
+    auto opts = fun::RansacOptions{};
+    opts.threshold = 0.5;
+    opts.min_inliers = 50;
+    for (const auto sprt : {true, false}) {
+        opts.sprt = sprt;
+        const auto lines = fun::ransac_lines(points, opts);
+        REQUIRE(lines.size() == 1);
+        CHECK(lines[0].inliers.size() >= 100);
+        // every inlier is within the threshold of the detected line
+        const auto &l = lines[0].line.coord;
+        const auto norm = std::sqrt(static_cast<double>(l[0] * l[0] + l[1] * l[1]));
+        for (const auto i : lines[0].inliers) {
+            const auto &p = points[i].coord;
+            const auto dist = std::abs(static_cast<double>(lines[0].line.dot(points[i])))
+                              / (static_cast<double>(p[2]) * norm);
+            CHECK(dist <= 0.5);
+        }
+        CHECK(std::abs(static_cast<double>(l[0]) / static_cast<double>(l[1]) + 0.5) < 0.05);
+        // deterministic for a fixed seed, whatever the thread count
+        const auto again = fun::ransac_lines(points, opts);
+        CHECK(again[0].line == lines[0].line);
+        CHECK(again[0].inliers == lines[0].inliers);
+    }
+}
@@ -0,0 +1,122 @@
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <projgeom/pg_binary_io.hpp>
+#include <projgeom/pg_incidence_join.hpp>
+#include <projgeom/pg_object.hpp>
+#include <projgeom/pg_result_cache.hpp>
+#include <string>
+#include <vector>
+
+static auto cache_dir(const std::string &name) -> std::filesystem::path {
+    const auto dir = std::filesystem::temp_directory_path() / ("projgeom_cache_" + name);
+    std::filesystem::remove_all(dir);
+    return dir;
+}
+
+TEST_CASE("Content keys") {
+    const auto a = std::vector<int64_t>{1, 2, 3};
+    const auto b = std::vector<int64_t>{1, 2, 4};
+    auto key = [](const std::string &op, const std::vector<int64_t> &data) {
+        return fun::ContentKey{}.add(op).add_records(data).value();
+    };
+    CHECK(key("meet", a) == key("meet", a));
+    CHECK(key("meet", a) != key("meet", b));
+    CHECK(key("meet", a) != key("join", a));
+    // buffer boundaries matter
+    CHECK(fun::ContentKey{}.add(std::string("ab")).add(std::string("c")).value()
+          != fun::ContentKey{}.add(std::string("a")).add(std::string("bc")).value());
+    CHECK(fun::ContentKey{}.hex().size() == 16);
+
+    // a difference in the top bit of two words does not cancel out
+    auto x_flipped = [](int64_t x) { return x ^ INT64_MIN; };
+    const auto points = std::vector<PgPoint>{PgPoint({1, 2, 3}), PgPoint({4, 5, 6})};
+    const auto flipped = std::vector<PgPoint>{PgPoint({x_flipped(1), 2, 3}),
+                                              PgPoint({x_flipped(4), 5, 6})};
+    const auto k1 = fun::ContentKey{}.add_objects(points);
+    const auto k2 = fun::ContentKey{}.add_objects(flipped);
+    CHECK(k1.value() != k2.value());
+    CHECK(k1.digest() != k2.digest());
+}
+
+TEST_CASE("Result cache hits skip the computation") {
+    const auto dir = cache_dir("hits");
+    auto cache = fun::ResultCache(dir);
+    auto points = std::vector<PgPoint>{};
+    for (int64_t i = 0; i != 30; ++i) points.emplace_back(PgPoint({i, 3 * i + 1, 1}));
+    const auto lines = std::vector<PgLine>{PgLine({3, -1, 1}), PgLine({1, 0, -4})};
+
+    const auto first = fun::cached_incidence_join(points, lines, &cache);
+    CHECK(cache.misses() == 1);
+    CHECK(first == fun::incidence_join(points, lines));
+    const auto second = fun::cached_incidence_join(points, lines, &cache);
+    CHECK(cache.hits() == 1);
+    CHECK(second == first);
+
+    auto calls = 0;
+    const auto key = fun::ContentKey{}.add(std::string("squares")).add(int64_t{5});
+    auto compute = [&calls]() {
+        ++calls;
+        return std::vector<int64_t>{0, 1, 4, 9, 16};
+    };
+    using fun::RecordKind;
+    CHECK(cache.get_or_compute<int64_t>(key, RecordKind::Points, compute).size() == 5);
+    CHECK(cache.get_or_compute<int64_t>(key, RecordKind::Points, compute).size() == 5);
+    CHECK(calls == 1);
+    const auto hit = cache.lookup<int64_t>(key, RecordKind::Points);
+    REQUIRE(hit.has_value());
+    CHECK(hit->size() == 5);
+    CHECK((*hit)[3] == 9);
+    CHECK_FALSE(cache.lookup<int64_t>(key, RecordKind::Lines).has_value());  // wrong kind
+
+    // a truncated entry is a miss
+    const auto damaged = fun::ContentKey{}.add(std::string("damaged"));
+    cache.store(damaged, RecordKind::Points, std::vector<int64_t>{1, 2, 3});
+    const auto path = dir / (damaged.hex() + ".pgr");
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 4);
+    CHECK_FALSE(cache.lookup<int64_t>(damaged, RecordKind::Points).has_value());
+    CHECK_FALSE(std::filesystem::exists(path));
+
+    // an entry under the right name but for another input is a miss
+    const auto other = fun::ContentKey{}.add(std::string("other"));
+    cache.store(other, RecordKind::Points, std::vector<int64_t>{4, 5, 6});
+    std::filesystem::rename(dir / (other.hex() + ".pgr"), path);
+    CHECK_FALSE(cache.lookup<int64_t>(damaged, RecordKind::Points).has_value());
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("Result cache returns the result when storing fails") {
+    const auto dir = cache_dir("unwritable");
+    auto cache = fun::ResultCache(dir);
+    std::filesystem::remove_all(dir);
+    const auto key = fun::ContentKey{}.add(std::string("lost"));
+    const auto result = cache.get_or_compute<int64_t>(
+        key, fun::RecordKind::Points, []() { return std::vector<int64_t>{1, 2, 3}; });
+    CHECK(result == std::vector<int64_t>{1, 2, 3});
+    CHECK_FALSE(std::filesystem::exists(dir));
+}
+
+TEST_CASE("Result cache evicts least recently used") {
+    const auto dir = cache_dir("lru");
+    const auto entry_bytes = sizeof(fun::FileHeader) + 100 * sizeof(int64_t) + sizeof(uint64_t);
+    auto cache = fun::ResultCache(dir, 3 * entry_bytes);
+    auto key = [](int64_t i) { return fun::ContentKey{}.add(std::string("entry")).add(i); };
+    const auto data = std::vector<int64_t>(100, 7);
+    auto stamp = std::filesystem::file_time_type::clock::now() - std::chrono::hours(1);
+    for (int64_t i = 0; i != 3; ++i) {
+        cache.store(key(i), fun::RecordKind::Points, data);
+        // distinct, increasing access times
+        std::filesystem::last_write_time(dir / (key(i).hex() + ".pgr"),
+                                         stamp + std::chrono::minutes(i));
+    }
+    CHECK(cache.lookup<int64_t>(key(0), fun::RecordKind::Points).has_value());  // now newest
+    cache.store(key(3), fun::RecordKind::Points, data);
+    CHECK(cache.lookup<int64_t>(key(0), fun::RecordKind::Points).has_value());
+    CHECK_FALSE(cache.lookup<int64_t>(key(1), fun::RecordKind::Points).has_value());
+    CHECK(cache.lookup<int64_t>(key(2), fun::RecordKind::Points).has_value());
+    CHECK(cache.lookup<int64_t>(key(3), fun::RecordKind::Points).has_value());
+    cache.clear();
+    CHECK_FALSE(cache.lookup<int64_t>(key(3), fun::RecordKind::Points).has_value());
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,69 @@
+#include <doctest/doctest.h>
+
+#include <projgeom/persp_object.hpp>
+#include <projgeom/pg_canonical.hpp>
+#include <projgeom/pg_object.hpp>
+#include <projgeom/pg_subdivide.hpp>
+#include <set>
+#include <vector>
+
+/**
+ * @brief Twice the signed area of a triangle of affine points
+ *
+ */
+static auto area2(const PgPoint &a, const PgPoint &b, const PgPoint &c) -> double {
+    auto x = [](const PgPoint &p) { return static_cast<double>(p.coord[0]) / p.coord[2]; };
+    auto y = [](const PgPoint &p) { return static_cast<double>(p.coord[1]) / p.coord[2]; };
+    return (x(b) - x(a)) * (y(c) - y(a)) - (x(c) - x(a)) * (y(b) - y(a));
+}
+
+TEST_CASE("Mesh subdivision (Euclid)") {
+    auto mesh = fun::TriMesh<PgPoint>{
+        {PgPoint({0, 0, 1}), PgPoint({4, 0, 1}), PgPoint({4, 4, 1}), PgPoint({0, 8, 2})},
+        {{0, 1, 2}, {0, 2, 3}}};
+    auto engine = fun::MeshSubdivider<PgPoint>{};
+    engine.refine(mesh);
+    CHECK(mesh.vertices.size() == 9);  // 4 + 5 edges, the diagonal only once
+    CHECK(mesh.triangles.size() == 8);
+    CHECK(mesh.vertices[4] == PgPoint({2, 0, 1}));
+    engine.refine_levels(mesh, 2);
+    CHECK(mesh.vertices.size() == 81);
+    CHECK(mesh.triangles.size() == 128);
+
+    // no duplicate vertices, area and orientation preserved
+    auto seen = std::set<std::array<int64_t, 3>>{};
+    for (const auto &v : mesh.vertices) seen.insert(fun::canonical_coord(v.coord));
+    CHECK(seen.size() == mesh.vertices.size());
+    auto total = 0.0;
+    for (const auto &[a, b, c] : mesh.triangles) {
+        const auto t = area2(mesh.vertices[a], mesh.vertices[b], mesh.vertices[c]);
+        CHECK(t > 0);
+        total += t;
+    }
+    CHECK(total == doctest::Approx(32.0));
+    for (const auto &v : mesh.vertices) CHECK(8 % v.coord[2] == 0);  // canonical: z | 2^levels
+
+    // the perspective rule with z = 0 as line at infinity agrees
+    auto start = fun::TriMesh<PgPoint>{
+        {PgPoint({0, 0, 1}), PgPoint({4, 0, 1}), PgPoint({4, 4, 1}), PgPoint({0, 8, 2})},
+        {{0, 1, 2}, {0, 2, 3}}};
+    const auto persp = fun::subdivide(start, 3, fun::PerspMidpoint<PgLine>{PgLine({0, 0, 1})});
+    CHECK(persp.triangles == mesh.triangles);
+    CHECK(persp.vertices == mesh.vertices);
+}
+
+TEST_CASE("Mesh subdivision (perspective plane)") {
+    auto mesh = fun::TriMesh<PerspPoint>{
+        {PerspPoint({0, 0, 1}), PerspPoint({3, 0, 1}), PerspPoint({0, 3, 5})}, {{0, 1, 2}}};
+    const auto mid = fun::PerspMidpoint<PerspLine>{L_INF};
+    const auto refined = fun::subdivide(mesh, 2, mid);
+    CHECK(refined.vertices.size() == 15);
+    CHECK(refined.triangles.size() == 16);
+    // the midpoint m of a and b is on ab, and scaling a or b does not move it
+    const auto &a = mesh.vertices[0];
+    const auto &b = mesh.vertices[1];
+    const auto m = refined.vertices[3];
+    CHECK(a.meet(b).incident(m));
+    CHECK(mid(PerspPoint({0, 0, -3}), b) == m);
+    for (const auto &v : refined.vertices) CHECK(!L_INF.incident(v));
+}
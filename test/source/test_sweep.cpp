@@ -0,0 +1,145 @@
+#include <doctest/doctest.h>
+
+#include <projgeom/pg_canonical.hpp>
+#include <projgeom/pg_object.hpp>
+#include <projgeom/pg_sweep.hpp>
+#include <projgeom/pg_workload.hpp>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using Segment = std::array<PgPoint, 2>;
+
+/**
+ * @brief Reference test for two integer segments (z = 1)
+ *
+ */
+static auto brute_intersect(const Segment &s, const Segment &t) -> bool {
+    const auto o1 = s[0].meet(s[1]).dot(t[0]);
+    const auto o2 = s[0].meet(s[1]).dot(t[1]);
+    const auto o3 = t[0].meet(t[1]).dot(s[0]);
+    const auto o4 = t[0].meet(t[1]).dot(s[1]);
+    auto on = [](const Segment &seg, const PgPoint &pt_p) {
+        const auto &a = seg[0].coord;
+        const auto &b = seg[1].coord;
+        const auto &p = pt_p.coord;
+        return std::min(a[0], b[0]) <= p[0] && p[0] <= std::max(a[0], b[0])
+               && std::min(a[1], b[1]) <= p[1] && p[1] <= std::max(a[1], b[1]);
+    };
+    if (((o1 > 0 && o2 < 0) || (o1 < 0 && o2 > 0)) && ((o3 > 0 && o4 < 0) || (o3 < 0 && o4 > 0))) {
+        return true;
+    }
+    return (o1 == 0 && on(s, t[0])) || (o2 == 0 && on(s, t[1])) || (o3 == 0 && on(t, s[0]))
+           || (o4 == 0 && on(t, s[1]));
+}
+
+static auto brute_pairs(const std::vector<Segment> &segments)
+    -> std::vector<std::pair<std::size_t, std::size_t>> {
+    auto result = std::vector<std::pair<std::size_t, std::size_t>>{};
+    for (std::size_t i = 0; i != segments.size(); ++i) {
+        for (auto j = i + 1; j != segments.size(); ++j) {
+            if (brute_intersect(segments[i], segments[j])) result.emplace_back(i, j);
+        }
+    }
+    return result;
+}
+
+static auto pairs_of(const std::vector<fun::SegmentHit<PgPoint>> &hits)
+    -> std::vector<std::pair<std::size_t, std::size_t>> {
+    auto result = std::vector<std::pair<std::size_t, std::size_t>>{};
+    for (const auto &hit : hits) result.emplace_back(hit.first, hit.second);
+    return result;
+}
+
+TEST_CASE("Segment sweep (degenerate cases)") {
+    const auto segments = std::vector<Segment>{
+        {PgPoint({0, 0, 1}), PgPoint({4, 4, 1})},   // 0
+        {PgPoint({0, 4, 1}), PgPoint({4, 0, 1})},   // 1: crosses 0 at (2, 2)
+        {PgPoint({2, 0, 1}), PgPoint({2, 5, 1})},   // 2: vertical through (2, 2)
+        {PgPoint({4, 4, 1}), PgPoint({6, 4, 1})},   // 3: shares endpoint with 0
+        {PgPoint({5, 4, 1}), PgPoint({8, 4, 1})},   // 4: collinear overlap with 3
+        {PgPoint({7, 4, 1}), PgPoint({7, 4, 1})},   // 5: point on 4
+        {PgPoint({10, 0, 1}), PgPoint({12, 0, 1})}, // 6: isolated
+    };
+    const auto hits = fun::segment_intersections(segments);
+    const auto expected = std::vector<std::pair<std::size_t, std::size_t>>{
+        {0, 1}, {0, 2}, {0, 3}, {1, 2}, {3, 4}, {4, 5}};
+    CHECK(pairs_of(hits) == expected);
+    for (const auto &hit : hits) {
+        if (hit.first == 0 && hit.second == 1) CHECK(hit.point == PgPoint({2, 2, 1}));
+        if (hit.first == 3 && hit.second == 4) CHECK(hit.point == PgPoint({5, 4, 1}));
+        if (hit.first == 0 && hit.second == 3) CHECK(hit.point == PgPoint({4, 4, 1}));
+    }
+}
+
+TEST_CASE("Segment sweep (random, sequential and slabs)") {
+    auto gen = std::mt19937{7};
+    auto coord = std::uniform_int_distribution<int64_t>{0, 12};
+    auto segments = std::vector<Segment>{};
+    for (int i = 0; i != 120; ++i) {
+        segments.push_back({PgPoint({coord(gen), coord(gen), 1}),
+                            PgPoint({coord(gen), coord(gen), 1})});
+    }
+    const auto expected = brute_pairs(segments);
+    const auto sweep = fun::SegmentSweep<PgPoint>(segments);
+    const auto hits = sweep.run();
+    CHECK(pairs_of(hits) == expected);
+    for (const auto &hit : hits) {
+        const auto &s = segments[hit.first];
+        const auto &t = segments[hit.second];
+        CHECK(s[0].meet(s[1]).incident(hit.point));
+        CHECK(t[0].meet(t[1]).incident(hit.point));
+    }
+    const auto slabs = sweep.run_parallel(5);
+    REQUIRE(slabs.size() == hits.size());
+    for (std::size_t i = 0; i != hits.size(); ++i) CHECK(slabs[i].point == hits[i].point);
+}
+
+TEST_CASE("Segment sweep (near-collinear workload)") {
+    // half of the endpoints lie on one line: overlaps, shared points, touching
+    auto spec = fun::WorkloadSpec{};
+    spec.kind = fun::Workload::NearCollinear;
+    spec.count = 400;
+    spec.range = 1024;
+    auto segments = std::vector<Segment>{};
+    const auto coords = fun::generate_coords(spec);
+    for (std::size_t i = 0; i + 1 < coords.size(); i += 2) {
+        // the workload scales integer points by w, so they reduce to z = 1
+        const auto a = fun::canonical_coord(coords[i]);
+        const auto b = fun::canonical_coord(coords[i + 1]);
+        REQUIRE(a[2] == 1);
+        REQUIRE(b[2] == 1);
+        segments.push_back({PgPoint(a), PgPoint(b)});
+    }
+    const auto expected = brute_pairs(segments);
+    CHECK(expected.size() > segments.size());
+    const auto sweep = fun::SegmentSweep<PgPoint>(segments);
+    const auto hits = sweep.run();
+    CHECK(pairs_of(hits) == expected);
+    const auto slabs = sweep.run_parallel(4);
+    REQUIRE(slabs.size() == hits.size());
+    for (std::size_t i = 0; i != hits.size(); ++i) CHECK(slabs[i].point == hits[i].point);
+}
+
+TEST_CASE("Segment sweep (coordinate overflow throws)") {
+    // exact up to 2^14; the crossing point is far larger
+    const auto exact = std::vector<Segment>{{PgPoint({1, 16000, 1}), PgPoint({16383, 3, 1})},
+                                            {PgPoint({7, 5, 1}), PgPoint({16381, 16002, 1})}};
+    const auto hits = fun::segment_intersections(exact);
+    REQUIRE(hits.size() == 1);
+    CHECK(exact[0][0].meet(exact[0][1]).incident(hits[0].point));
+    CHECK(exact[1][0].meet(exact[1][1]).incident(hits[0].point));
+    CHECK(hits[0].point.coord[0] > int64_t{1} << 39);
+
+    // the crossing point swept again: lines fit, their crossing does not
+    const auto again = std::vector<Segment>{{hits[0].point, PgPoint({1, 2, 1})},
+                                            {PgPoint({0, 10000, 1}), PgPoint({16383, 0, 1})}};
+    CHECK_THROWS_AS(fun::segment_intersections(again), std::overflow_error);
+
+    const auto a = (int64_t{1} << 24) + 3;
+    const auto b = (int64_t{1} << 25) + 5;
+    const auto wide = std::vector<Segment>{{PgPoint({3, a, 1}), PgPoint({b, 7, 1})},
+                                           {PgPoint({11, 5, 1}), PgPoint({b - 1, a + 9, 1})}};
+    CHECK_THROWS_AS(fun::segment_intersections(wide), std::overflow_error);
+}
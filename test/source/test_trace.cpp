@@ -0,0 +1,93 @@
+#include <doctest/doctest.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <projgeom/pg_incidence_join.hpp>
+#include <projgeom/pg_object.hpp>
+#include <projgeom/pg_parallel.hpp>
+#include <projgeom/pg_trace.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static auto count_of(const std::string &text, const std::string &needle) -> std::size_t {
+    auto count = std::size_t{0};
+    for (auto pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1)) {
+        ++count;
+    }
+    return count;
+}
+
+TEST_CASE("Trace events") {
+    auto &tracer = fun::Tracer::instance();
+    tracer.clear();
+    { PG_TRACE_SCOPE("test", "disabled"); }
+    for (const auto &thread : tracer.collect()) CHECK(thread.second.empty());
+
+    tracer.enable();
+    fun::parallel_for(64, 1, [](std::size_t begin, std::size_t end) {
+        for (auto i = begin; i != end; ++i) PG_TRACE_CHUNK("test", "chunk", i);
+    }, 4);
+    {
+        PG_TRACE_SCOPE("test", "outer \"quoted\"");
+        auto points = std::vector<PgPoint>{};
+        for (int64_t i = 0; i != 600; ++i) points.emplace_back(PgPoint({i, i, 1}));
+        fun::incidence_join(points, std::vector<PgLine>{PgLine({1, -1, 0})}, 256);
+    }
+    tracer.disable();
+    { PG_TRACE_SCOPE("test", "after"); }
+
+    auto chunks = std::size_t{0};
+    auto tiles = std::size_t{0};
+    for (const auto &thread : tracer.collect()) {
+        for (const auto &event : thread.second) {
+            chunks += std::string(event.stage) == "chunk" ? 1 : 0;
+            tiles += std::string(event.stage) == "tile" ? 1 : 0;
+            CHECK(std::string(event.stage) != "after");
+        }
+    }
+    CHECK(chunks == 64);
+    CHECK(tiles == 3);
+
+    const auto path = (std::filesystem::temp_directory_path() / "projgeom_trace.json").string();
+    tracer.write_json(path);
+    auto text = std::stringstream{};
+    text << std::ifstream(path).rdbuf();
+    const auto json = text.str();
+    CHECK(json.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0) == 0);
+    CHECK(count_of(json, "\"ph\":\"X\"") == 64 + 3 + 2);  // chunks, tiles, outer and run
+    CHECK(count_of(json, "outer \\\"quoted\\\"") == 1);
+    CHECK(count_of(json, "\"args\":{\"chunk\":63}") == 1);
+    std::filesystem::remove(path);
+    tracer.clear();
+}
+
+TEST_CASE("Trace ring keeps the newest events") {
+    auto ring = fun::TraceBuffer(8, 1);
+    for (int64_t i = 0; i != 20; ++i) ring.push(fun::TraceEvent{"test", "ring", i, 0, 0});
+    const auto events = ring.snapshot();
+    REQUIRE(events.size() == 8);
+    CHECK(events.front().chunk == 12);
+    CHECK(events.back().chunk == 19);
+    CHECK(ring.recorded() == 20);
+}
+
+TEST_CASE("Trace rings are reused by new threads") {
+    auto &tracer = fun::Tracer::instance();
+    tracer.enable();
+    // every call spawns fresh threads; their rings go back to the free list on exit
+    for (int round = 0; round != 200; ++round) {
+        fun::parallel_for(4, 1, [](std::size_t begin, std::size_t end) {
+            for (auto i = begin; i != end; ++i) PG_TRACE_CHUNK("test", "reuse", i);
+        }, 4);
+    }
+    tracer.disable();
+    CHECK(tracer.rings() <= 8);
+    auto events = std::size_t{0};
+    for (const auto &thread : tracer.collect()) {
+        for (const auto &event : thread.second) events += std::string(event.stage) == "reuse";
+    }
+    CHECK(events == 800);
+    tracer.clear();
+}
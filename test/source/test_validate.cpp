@@ -0,0 +1,86 @@
+#include <doctest/doctest.h>
+
+#include <array>
+#include <projgeom/pg_object.hpp>
+#include <projgeom/pg_plane.hpp>
+#include <projgeom/pg_validate.hpp>
+#include <random>
+#include <utility>
+#include <vector>
+
+TEST_CASE("Validate incidence claims") {
+    auto gen = std::mt19937{41};
+    auto small = std::uniform_int_distribution<int64_t>{-50, 50};
+    auto large = std::uniform_int_distribution<int64_t>{-(int64_t{1} << 30), int64_t{1} << 30};
+    auto lines = std::vector<PgLine>{};
+    for (std::size_t j = 0; j != 40; ++j) {
+        auto &dist = j % 4 == 0 ? large : small;
+        lines.push_back(PgLine({dist(gen), dist(gen), dist(gen) | 1}));
+    }
+    auto points = std::vector<PgPoint>{};
+    auto claims = std::vector<std::pair<uint32_t, uint32_t>>{};
+    for (std::size_t k = 0; k != 3000; ++k) {
+        const auto j = static_cast<uint32_t>(gen() % lines.size());
+        const auto other = PgLine({small(gen), small(gen), 1});
+        const auto on_line = lines[j].meet(other);  // incident by construction
+        auto pt = on_line;
+        if (k % 3 == 0) pt.coord[2] += 1;  // almost certainly off the line
+        points.push_back(pt);
+        claims.emplace_back(static_cast<uint32_t>(points.size() - 1), j);
+    }
+    claims.emplace_back(uint32_t{999999}, 0);  // no such point
+
+    const auto grouped = fun::IncidenceClaims::group_by_line(claims, lines.size());
+    REQUIRE(grouped.size() == claims.size());
+    for (const auto grain : {std::size_t{1}, std::size_t{64}}) {
+        const auto mask = fun::validate_incidences(points, lines, grouped, grain);
+        auto expected_failures = std::size_t{0};
+        for (std::size_t k = 0; k != grouped.size(); ++k) {
+            const auto &[p, j] = claims[grouped.source[k]];
+            const auto ok = p < points.size() && points[p].incident(lines[j]);
+            expected_failures += ok ? 0 : 1;
+            CHECK(mask.test(k) == !ok);
+        }
+        CHECK(mask.failures() == expected_failures);
+        CHECK(mask.indices().size() == expected_failures);
+    }
+    CHECK(fun::validate_incidences(std::vector<PgPoint>{}, lines, grouped).failures()
+          == grouped.size());
+}
+
+TEST_CASE("Validate incidence claims on unknown lines") {
+    const auto lines = std::vector<PgLine>{PgLine({1, 0, 0}), PgLine({0, 1, 0})};  // x = 0, y = 0
+    const auto points = std::vector<PgPoint>{PgPoint({0, 5, 1}), PgPoint({0, 0, 1})};
+    const auto claims = std::vector<std::pair<uint32_t, uint32_t>>{
+        {0, 0}, {1, 7}, {1, 1}, {0, 2}, {1, 0}};  // lines 7 and 2 do not exist
+    const auto grouped = fun::IncidenceClaims::group_by_line(claims, lines.size());
+    REQUIRE(grouped.size() == claims.size());
+    CHECK(grouped.start.back() == 3);
+    CHECK(grouped.source[3] == 1);  // the trailing bucket keeps input order
+    CHECK(grouped.source[4] == 3);
+    const auto mask = fun::validate_incidences(points, lines, grouped);
+    CHECK(mask.indices() == std::vector<std::size_t>{3, 4});
+}
+
+TEST_CASE("Validate concurrency claims") {
+    auto gen = std::mt19937{43};
+    auto coord = std::uniform_int_distribution<int64_t>{-1000, 1000};
+    auto lines = std::vector<PgLine>{};
+    auto triples = std::vector<std::array<uint32_t, 3>>{};
+    for (uint32_t t = 0; t != 500; ++t) {
+        const auto center = PgPoint({coord(gen), coord(gen), 1});
+        for (int i = 0; i != 3; ++i) {
+            lines.push_back(center.meet(PgPoint({coord(gen), coord(gen), 1})));
+        }
+        if (t % 5 == 0) lines.back().coord[2] += 1;
+        triples.push_back({3 * t, 3 * t + 1, 3 * t + 2});
+    }
+    triples.push_back({0, 1, 100000});
+    const auto mask = fun::validate_concurrencies(lines, triples, 2);
+    for (std::size_t k = 0; k + 1 != triples.size(); ++k) {
+        const auto &[a, b, c] = triples[k];
+        CHECK(mask.test(k) == !fun::coincident(lines[a], lines[b], lines[c]));
+    }
+    CHECK(mask.test(triples.size() - 1));
+    CHECK(mask.failures() >= 100);
+}
@@ -0,0 +1,159 @@
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <projgeom/pg_binary_io.hpp>
+#include <projgeom/pg_canonical.hpp>
+#include <projgeom/pg_conic.hpp>
+#include <projgeom/pg_incidence_join.hpp>
+#include <projgeom/pg_object.hpp>
+#include <projgeom/pg_workload.hpp>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using Coord = std::array<int64_t, 3>;
+
+static auto spec_of(fun::Workload kind, std::size_t count, int64_t range = int64_t{1} << 20)
+    -> fun::WorkloadSpec {
+    auto spec = fun::WorkloadSpec{};
+    spec.kind = kind;
+    spec.count = count;
+    spec.range = range;
+    return spec;
+}
+
+TEST_CASE("Philox4x32-10 known answers") {
+    // Random123 kat_vectors
+    auto zero = fun::Philox4x32(0);
+    CHECK(zero({0, 0, 0, 0})
+          == fun::Philox4x32::Counter{0x6627e8d5U, 0xe169c58dU, 0xbc57ac4cU, 0x9b00dbd8U});
+    auto ones = fun::Philox4x32(0xffffffffffffffffULL);
+    CHECK(ones({0xffffffffU, 0xffffffffU, 0xffffffffU, 0xffffffffU})
+          == fun::Philox4x32::Counter{0x408f276dU, 0x41c83b0eU, 0xa20bc7c6U, 0x6d5451fdU});
+}
+
+TEST_CASE("Workloads are reproducible") {
+    for (const auto kind : {fun::Workload::Uniform, fun::Workload::NearCollinear,
+                            fun::Workload::AtInfinity, fun::Workload::MixedMagnitude,
+                            fun::Workload::Concyclic}) {
+        CHECK(fun::parse_workload(fun::workload_name(kind)) == kind);
+        auto spec = spec_of(kind, 20000);
+        const auto serial = fun::generate_coords(spec, 1);
+        CHECK(fun::generate_coords(spec, 4) == serial);
+
+        // a smaller set is a prefix of a larger one
+        spec.count = 5000;
+        const auto prefix = fun::generate_coords(spec);
+        CHECK(std::equal(prefix.begin(), prefix.end(), serial.begin()));
+
+        spec.seed = 2;
+        CHECK(fun::generate_coords(spec) != prefix);
+        for (const auto &c : serial) CHECK((c[0] != 0 || c[1] != 0 || c[2] != 0));
+    }
+    CHECK_THROWS_AS(fun::parse_workload("gaussian"), std::invalid_argument);
+}
+
+TEST_CASE("Workload bounds") {
+    for (const auto kind : {fun::Workload::Uniform, fun::Workload::NearCollinear,
+                            fun::Workload::AtInfinity, fun::Workload::MixedMagnitude,
+                            fun::Workload::Concyclic}) {
+        // the largest bounds stay clear of int64 overflow in every distribution
+        auto spec = spec_of(kind, 2000);
+        spec.range = fun::MAX_WORKLOAD_BOUND;
+        spec.huge = fun::MAX_WORKLOAD_BOUND;
+        for (const auto &c : fun::generate_coords(spec)) {
+            CHECK((c[0] != 0 || c[1] != 0 || c[2] != 0));
+        }
+        spec.range = fun::MAX_WORKLOAD_BOUND + 1;
+        CHECK_THROWS_AS(fun::generate_coords(spec), std::invalid_argument);
+        spec.range = fun::MAX_WORKLOAD_BOUND;
+        spec.huge = fun::MAX_WORKLOAD_BOUND + 1;
+        CHECK_THROWS_AS(fun::generate_coords(spec), std::invalid_argument);
+        spec.range = INT64_MAX;
+        CHECK_THROWS_AS(fun::generate_coords(spec), std::invalid_argument);
+    }
+}
+
+TEST_CASE("Workload round trip through the binary format") {
+    const auto points = fun::generate_objects<PgPoint>(spec_of(fun::Workload::AtInfinity, 3000));
+    const auto path = (std::filesystem::temp_directory_path() / "projgeom_workload.bin").string();
+    fun::write_objects(path, points);
+    const auto loaded = fun::read_objects<PgPoint>(path);
+    std::filesystem::remove(path);
+    REQUIRE(loaded.size() == points.size());
+    for (std::size_t i = 0; i != points.size(); ++i) CHECK(loaded[i].coord == points[i].coord);
+}
+
+static constexpr auto num_points = std::size_t{4000};
+
+TEST_CASE("Workload at infinity") {
+    auto at_infinity = std::size_t{0};
+    for (const auto &c : fun::generate_coords(spec_of(fun::Workload::AtInfinity, num_points))) {
+        if (c[2] == 0) ++at_infinity;
+    }
+    CHECK(at_infinity > num_points * 2 / 5);
+    CHECK(at_infinity < num_points * 3 / 5);
+}
+
+TEST_CASE("Workload of mixed magnitudes") {
+    auto spec = spec_of(fun::Workload::MixedMagnitude, num_points);
+    auto huge = 0;
+    auto tiny = 0;
+    for (const auto &c : fun::generate_coords(spec)) {
+        CHECK(c[2] > 0);
+        for (const auto v : c) {
+            CHECK(std::llabs(v) <= spec.huge);
+            if (std::llabs(v) >= spec.huge / 2) ++huge;
+            if (std::llabs(v) <= 16) ++tiny;
+        }
+    }
+    CHECK(huge > 1000);
+    CHECK(tiny > 1000);
+}
+
+TEST_CASE("Near-collinear workload") {
+    // the line through two exactly collinear points holds about half of the set
+    const auto points
+        = fun::generate_objects<PgPoint>(spec_of(fun::Workload::NearCollinear, num_points));
+    auto lines = std::vector<PgLine>{};
+    for (std::size_t i = 0; i != 8; ++i) {
+        for (std::size_t j = i + 1; j != 8; ++j) {
+            const auto ln = points[i].meet(points[j]);
+            if (ln.coord != Coord{0, 0, 0}) lines.push_back(ln);
+        }
+    }
+    auto best = std::size_t{0};
+    auto on_line = std::vector<std::size_t>(lines.size());
+    for (const auto &pair : fun::incidence_join(points, lines)) ++on_line[pair.line];
+    for (std::size_t j = 0; j != lines.size(); ++j) {
+        auto brute = std::size_t{0};
+        for (const auto &pt : points) brute += pt.incident(lines[j]) ? 1 : 0;
+        CHECK(on_line[j] == brute);
+        best = std::max(best, brute);
+    }
+    CHECK(best > num_points * 2 / 5);
+    CHECK(best < num_points * 3 / 5);
+}
+
+TEST_CASE("Concyclic workload") {
+    // coordinates below 2^11, where conic_through is exact
+    const auto points
+        = fun::generate_objects<PgPoint>(spec_of(fun::Workload::Concyclic, num_points, 1024));
+    auto distinct = std::array<PgPoint, 5>{points[0], points[0], points[0], points[0],
+                                           points[0]};
+    auto seen = std::set<Coord>{fun::canonical_coord(points[0].coord)};
+    for (const auto &pt : points) {
+        if (seen.size() == 5) break;
+        if (seen.insert(fun::canonical_coord(pt.coord)).second) distinct[seen.size() - 1] = pt;
+    }
+    REQUIRE(seen.size() == 5);
+    const auto conic = fun::conic_through(distinct);
+    CHECK(conic.coef[0] == conic.coef[1]);  // a circle: x^2 and y^2 alike, no xy
+    CHECK(conic.coef[5] == 0);
+    for (const auto &pt : points) CHECK(conic.incident(pt));
+}